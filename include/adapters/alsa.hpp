@@ -1,12 +1,16 @@
 #pragma once
 
 #include <stdio.h>
+#include <sys/poll.h>
 #include <functional>
+#include <mutex>
 #include <string>
 
 #include <alsa/asoundlib.h>
 
 #include "common.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
 #include "config.hpp"
 #include "utils/threading.hpp"
 
@@ -16,8 +20,6 @@ DEFINE_ERROR(alsa_exception);
 DEFINE_CHILD_ERROR(alsa_ctl_interface_error, alsa_exception);
 DEFINE_CHILD_ERROR(alsa_mixer_error, alsa_exception);
 
-// class definition : alsa_ctl_interface {{{
-
 template <typename T>
 void throw_exception(string&& message, int error_code) {
   const char* snd_error = snd_strerror(error_code);
@@ -26,42 +28,122 @@ void throw_exception(string&& message, int error_code) {
   throw T(message.c_str());
 }
 
+// class definition : alsa_card {{{
+
+/**
+ * Shared handles of a sound card
+ *
+ * One mixer with all simple elements registered is loaded per card,
+ * together with a control handle that is opened once a control element
+ * is watched. Their poll descriptors wait in the reactor, and the
+ * watchers of an element are called from the reactor thread only when
+ * that element changed.
+ */
+class alsa_card {
+ public:
+  friend class alsa_mixer;
+  friend class alsa_ctl_interface;
+
+  using watch_id = size_t;
+
+  explicit alsa_card(const logger& logger, reactor& reactor, string name = ALSA_SOUNDCARD);
+  ~alsa_card();
+
+  watch_id watch(string element, callback<>&& on_change);
+  watch_id watch(int numid, callback<>&& on_change);
+  void unwatch(watch_id id);
+
+ protected:
+  struct watcher {
+    string element;
+    int numid;
+    callback<> on_change;
+  };
+
+  static int on_element(snd_mixer_elem_t* elem, unsigned int mask);
+
+  snd_mixer_elem_t* find_element(const string& name) const;
+  snd_ctl_t* control();
+  void add_descriptors(const vector<pollfd>& fds);
+  void on_events();
+
+ private:
+  const logger& m_log;
+  reactor& m_reactor;
+  string m_name;
+
+  snd_mixer_t* m_mixer{nullptr};
+  snd_ctl_t* m_ctl{nullptr};
+  vector<reactor::handler_id> m_handlers;
+
+  mutable std::mutex m_mutex;
+  threading_util::callback_tracker m_callbacks{m_log, "alsa_card"};
+
+  map<watch_id, watcher> m_watchers;
+  watch_id m_nextid{1};
+
+  vector<string> m_changed;
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = alsa_card&>
+  di::injector<T> configure_alsa_card() {
+    auto instance =
+        factory::generic_singleton<alsa_card>(std::cref(configure_logger().create<const logger&>()),
+            std::ref(configure_reactor().create<reactor&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+// }}}
+// class definition : alsa_ctl_interface {{{
+
+/**
+ * Boolean control element, i.e. a headphone jack, read
+ * through the control handle of the shared card
+ */
 class alsa_ctl_interface {
  public:
-  explicit alsa_ctl_interface(int numid);
+  explicit alsa_ctl_interface(alsa_card& card, int numid);
   ~alsa_ctl_interface();
 
   int get_numid();
-  bool wait(int timeout = -1);
+  void watch(callback<>&& on_change);
+  void unwatch();
   bool test_device_plugged();
-  void process_events();
 
  private:
+  alsa_card& m_card;
   int m_numid = 0;
 
-  threading_util::spin_lock m_lock;
-
-  snd_hctl_t* m_hctl = nullptr;
-  snd_hctl_elem_t* m_elem = nullptr;
-
-  snd_ctl_t* m_ctl = nullptr;
-  snd_ctl_elem_info_t* m_info = nullptr;
   snd_ctl_elem_value_t* m_value = nullptr;
-  snd_ctl_elem_id_t* m_id = nullptr;
+
+  alsa_card::watch_id m_watch{0};
+  std::atomic_bool m_dirty{true};
+  bool m_plugged{false};
 };
 
 // }}}
 // class definition : alsa_mixer {{{
 
+/**
+ * Simple mixer element of the shared card
+ *
+ * The volume and mute state are cached and only read
+ * again once an event reported a change of the element
+ */
 class alsa_mixer {
  public:
-  explicit alsa_mixer(string mixer_control_name);
+  explicit alsa_mixer(alsa_card& card, string mixer_control_name);
   ~alsa_mixer();
 
   string get_name();
 
-  bool wait(int timeout = -1);
-  int process_events();
+  void watch(callback<>&& on_change);
+  void unwatch();
 
   int get_volume();
   void set_volume(float percentage);
@@ -69,13 +151,18 @@ class alsa_mixer {
   void toggle_mute();
   bool is_muted();
 
+ protected:
+  snd_mixer_elem_t* element() const;
+  void refresh();
+
  private:
+  alsa_card& m_card;
   string m_name;
 
-  threading_util::spin_lock m_lock;
-
-  snd_mixer_t* m_hardwaremixer = nullptr;
-  snd_mixer_elem_t* m_mixerelement = nullptr;
+  alsa_card::watch_id m_watch{0};
+  std::atomic_bool m_dirty{true};
+  int m_volume{0};
+  bool m_muted{false};
 };
 
 // }}}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
+#include "components/scheduler.hpp"
+
+LEMONBUDDY_NS
+
+namespace net {
+  // types {{{
+
+  /**
+   * Round-trip time and loss over the last probes
+   */
+  struct probe_stats {
+    size_t sent{0};
+    size_t lost{0};
+    chrono::microseconds latency{0};
+
+    int loss() const {
+      return sent ? static_cast<int>(lost * 100 / sent) : 0;
+    }
+  };
+
+  // }}}
+  // class : icmp_prober {{{
+
+  /**
+   * Asynchronous ICMP echo prober
+   *
+   * Echo requests are sent from the scheduler once per interval and the
+   * replies are read from the reactor, so nobody ever waits for them.
+   * Probes without a reply within the timeout count as lost, and the
+   * statistics cover a sliding window of the most recent probes.
+   *
+   * Unprivileged ping sockets are used when the user is allowed to open
+   * them (net.ipv4.ping_group_range), raw sockets otherwise.
+   */
+  class icmp_prober {
+   public:
+    using result_cb = callback<const probe_stats&>;
+
+    explicit icmp_prober(const logger& logger, scheduler& scheduler, reactor& reactor,
+        string address, string interface = "");
+    ~icmp_prober();
+
+    void start(chrono::milliseconds interval, chrono::milliseconds timeout, size_t window,
+        result_cb&& on_result = nullptr);
+    void stop();
+    void reset();
+
+    probe_stats stats() const;
+
+   protected:
+    struct probe {
+      uint16_t seq;
+      scheduler::clock::time_point sent;
+    };
+
+    void tick();
+    void on_reply();
+    void record(bool lost, scheduler::clock::duration rtt = {});
+    probe_stats stats_locked() const;
+
+   private:
+    const logger& m_log;
+    scheduler& m_scheduler;
+    reactor& m_reactor;
+    string m_address;
+
+    int m_socketfd{-1};
+    bool m_raw{false};
+    uint16_t m_id{0};
+    uint16_t m_seq{0};
+
+    scheduler::timer_id m_timer{0};
+    reactor::handler_id m_handler{0};
+
+    mutable std::mutex m_mutex;
+    chrono::milliseconds m_timeout{0};
+    size_t m_window{0};
+    result_cb m_callback;
+    std::deque<probe> m_pending;
+    std::deque<pair<bool, scheduler::clock::duration>> m_results;
+  };
+
+  // }}}
+}
+
+LEMONBUDDY_NS_END
@@ -9,6 +9,8 @@
 #endif
 
 #include "common.hpp"
+#include "components/nl80211.hpp"
+#include "components/rtnetlink.hpp"
 #include "config.hpp"
 
 LEMONBUDDY_NS
@@ -53,10 +55,10 @@ namespace net {
     explicit network(string interface);
     virtual ~network();
 
-    virtual bool query();
+    virtual bool query(bool accumulate = true);
     virtual bool connected() const = 0;
-    virtual bool ping() const;
 
+    int index() const;
     string ip() const;
     string downspeed(int minwidth = 3) const;
     string upspeed(int minwidth = 3) const;
@@ -66,6 +68,9 @@ namespace net {
     string format_speedrate(float bytes_diff, int minwidth) const;
 
     int m_socketfd = 0;
+    rtnetlink& m_netlink{configure_rtnetlink().create<rtnetlink&>()};
+    rtnetlink::watch_id m_watch{0};
+    int m_index{0};
     link_status m_status;
     string m_interface;
   };
@@ -77,7 +82,7 @@ namespace net {
    public:
     explicit wired_network(string interface) : network(interface) {}
 
-    bool query() override;
+    bool query(bool accumulate = true) override;
     bool connected() const override;
     string linkspeed() const;
 
@@ -92,20 +97,24 @@ namespace net {
    public:
     wireless_network(string interface) : network(interface) {}
 
-    bool query() override;
+    bool query(bool accumulate = true) override;
     bool connected() const override;
 
     string essid() const;
     int signal() const;
     int quality() const;
+    string linkspeed() const;
 
    protected:
+    bool query_nl80211();
+    bool query_wext();
     void query_essid(const int& socket_fd);
     void query_quality(const int& socket_fd);
 
    private:
-    shared_ptr<wireless_info> m_info;
+    nl80211& m_nl80211{configure_nl80211().create<nl80211&>()};
     string m_essid;
+    unsigned int m_bitrate{0};
     quality_range m_signalstrength;
     quality_range m_linkquality;
   };
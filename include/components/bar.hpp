@@ -2,8 +2,8 @@
 
 #include "common.hpp"
 #include "components/config.hpp"
+#include "components/display_list.hpp"
 #include "components/logger.hpp"
-#include "components/parser.hpp"
 #include "components/signals.hpp"
 #include "components/types.hpp"
 #include "utils/threading.hpp"
@@ -18,9 +18,11 @@
 LEMONBUDDY_NS
 
 class bar : public xpp::event::sink<evt::button_press, evt::expose, evt::property_notify> {
+  friend class display_list;
+
  public:
   explicit bar(connection& conn, const config& config, const logger& logger,
-      unique_ptr<fontmanager> fontmanager)
+      shared_ptr<fontmanager> fontmanager)
       : m_connection(conn)
       , m_conf(config)
       , m_log(logger)
@@ -28,13 +30,15 @@ class bar : public xpp::event::sink<evt::button_press, evt::expose, evt::propert
 
   ~bar();
 
-  void bootstrap(bool nodraw = false);
+  void bootstrap(bool nodraw = false, string monitor = "", bool tray = true);
+  unique_ptr<bar> mirror() const;
 
   const bar_settings settings() const;
   const tray_settings tray() const;
 
-  void parse(string data, bool force = false);
+  void render(const display_list& contents, bool force = false);
   void flush();
+  void present(const vector<xcb_rectangle_t>& areas);
 
   void handle(const evt::button_press& evt);
   void handle(const evt::expose& evt);
@@ -43,6 +47,7 @@ class bar : public xpp::event::sink<evt::button_press, evt::expose, evt::propert
  protected:
   int center_x();
   int width_inner();
+  int block_x(alignment align);
 
   void on_alignment_change(alignment align);
   void on_attribute_set(attribute attr);
@@ -51,24 +56,34 @@ class bar : public xpp::event::sink<evt::button_press, evt::expose, evt::propert
   void on_action_block_open(mousebtn btn, string cmd);
   void on_action_block_close(mousebtn btn);
   void on_color_change(gc gc_, color color_);
+  void on_color_reset(gc gc_);
   void on_font_change(int index);
   void on_pixel_offset(int px);
+  void on_character_write(uint16_t character);
+  void on_string_write(const char* text, size_t len);
   void on_tray_report(uint16_t slots);
 
-  void draw_background();
+  text_run& current_run(fonttype* font);
+  void layout_actions();
+  vector<text_run> layout_frame();
+
+  vector<xcb_rectangle_t> damaged_areas(const vector<text_run>& frame);
+  static bool same_run(const text_run& a, const text_run& b);
+
+  void set_gc_color(gc gc_, const color& color_);
+
   void draw_border(border border_);
-  void draw_lines(int x, int w);
-  int draw_shift(int x, int chr_width);
-  void draw_character(uint16_t character);
-  void draw_textstring(const char* text, size_t len);
+  void draw_frame(const vector<text_run>& frame, const vector<xcb_rectangle_t>& areas);
+  void draw_run(const text_run& run, int x);
+  void draw_lines(const text_run& run, int x);
 
  private:
   connection& m_connection;
   const config& m_conf;
   const logger& m_log;
-  unique_ptr<fontmanager> m_fontmanager;
+  shared_ptr<fontmanager> m_fontmanager;
 
-  threading_util::spin_lock m_lock;
+  threading_util::futex_lock m_lock;
   throttle_util::throttle_t m_throttler;
 
   xcb_screen_t* m_screen;
@@ -82,12 +97,16 @@ class bar : public xpp::event::sink<evt::button_press, evt::expose, evt::propert
   tray_settings m_tray;
   map<border, border_settings> m_borders;
   map<gc, gcontext> m_gcontexts;
+  map<gc, uint32_t> m_gcvalues;
+  map<gc, color> m_colors;
+  map<alignment, layout_block> m_layout;
+  vector<text_run> m_frame;
   vector<action_block> m_actions;
 
   stateflag m_sinkattached{false};
 
-  string m_prevdata;
-  int m_xpos{0};
+  display_list m_prevcontents;
+  bool m_repaint{true};
   int m_attributes{0};
 
   xcb_font_t m_gcfont{0};
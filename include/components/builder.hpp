@@ -2,6 +2,8 @@
 
 #include "common.hpp"
 #include "components/config.hpp"
+#include "components/display_list.hpp"
+#include "components/parser.hpp"
 #include "components/types.hpp"
 #include "config.hpp"
 #include "drawtypes/label.hpp"
@@ -17,16 +19,20 @@ LEMONBUDDY_NS
 using namespace drawtypes;
 
 class builder {
+  friend class parser<builder>;
+
  public:
   explicit builder(const bar_settings bar, bool lazy = true) : m_bar(bar), m_lazy(lazy) {}
 
   void set_lazy(bool mode);
 
-  string flush();
+  display_list flush();
 
   void append(string text);
+  void append(const display_list& contents);
 
   void node(string str, bool add_space = false);
+  void node(const display_list& contents, bool add_space = false);
   void node(string str, int font_index, bool add_space = false);
   // void node(progressbar_t bar, float perc, bool add_space = false);
   void node(label_t label, bool add_space = false);
@@ -62,13 +68,23 @@ class builder {
   void cmd_close(bool force = false);
 
  protected:
-  void tag_open(char tag, string value);
-  void tag_close(char tag);
+  void on_alignment_change(alignment align);
+  void on_attribute_set(attribute attr);
+  void on_attribute_unset(attribute attr);
+  void on_attribute_toggle(attribute attr);
+  void on_action_block_open(mousebtn btn, string cmd);
+  void on_action_block_close(mousebtn btn);
+  void on_color_change(gc gc_, lemonbuddy::color color_);
+  void on_color_reset(gc gc_);
+  void on_font_change(int index);
+  void on_pixel_offset(int px);
+  void on_character_write(uint16_t character);
+  void on_string_write(const char* text, size_t len);
 
  private:
   const bar_settings m_bar;
 
-  string m_output;
+  display_list m_output;
   bool m_lazy = true;
 
   map<syntaxtag, int> m_counters{
@@ -5,11 +5,12 @@
 #include "common.hpp"
 #include "components/bar.hpp"
 #include "components/config.hpp"
+#include "components/display_list.hpp"
 #include "components/eventloop.hpp"
+#include "components/executor.hpp"
 #include "components/logger.hpp"
 #include "components/signals.hpp"
 #include "config.hpp"
-#include "utils/command.hpp"
 #include "utils/inotify.hpp"
 #include "x11/connection.hpp"
 #include "x11/tray.hpp"
@@ -46,11 +47,14 @@ class controller {
   void wait_for_xevent();
 
   void activate_tray();
+  void bootstrap_mirrors();
   void bootstrap_modules();
 
   void on_mouse_event(string input);
   void on_unrecognized_action(string input);
-  void on_update();
+  void on_update(const dirtymap_t& dirty);
+
+  display_list build_block(alignment align, const vector<module_t>& modules);
 
  private:
   connection& m_connection;
@@ -59,6 +63,7 @@ class controller {
   const config& m_conf;
   unique_ptr<eventloop> m_eventloop;
   unique_ptr<bar> m_bar;
+  vector<unique_ptr<bar>> m_mirrors;
   unique_ptr<traymanager> m_traymanager;
 
   stateflag m_running{false};
@@ -71,9 +76,11 @@ class controller {
   vector<thread> m_threads;
 
   inotify_util::watch_t& m_confwatch;
-  command_util::command_t m_command;
+  executor& m_executor{configure_executor().create<executor&>()};
 
   bool m_writeback = false;
+  display_list m_separator;
+  map<alignment, display_list> m_blocks;
 };
 
 namespace {
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "common.hpp"
+#include "components/parser.hpp"
+#include "components/types.hpp"
+
+LEMONBUDDY_NS
+
+enum class display_opcode {
+  NONE = 0,
+  ALIGNMENT,
+  ATTRIBUTE_SET,
+  ATTRIBUTE_UNSET,
+  ATTRIBUTE_TOGGLE,
+  ACTION_OPEN,
+  ACTION_CLOSE,
+  COLOR,
+  COLOR_RESET,
+  FONT,
+  OFFSET,
+  CHARACTER,
+  TEXT
+};
+
+/**
+ * Single operation in the display list
+ *
+ * The meaning of value depends on the opcode (alignment, attribute,
+ * mouse button, gc, font index, pixels or character). The text holds
+ * the ascii text of TEXT ops and the command of ACTION_OPEN ops.
+ */
+struct display_op {
+  display_op() = default;
+  display_opcode code{display_opcode::NONE};
+  int value{0};
+  lemonbuddy::color color{g_colorempty};
+  string text;
+
+  bool operator==(const display_op& other) const;
+  bool operator!=(const display_op& other) const;
+};
+
+/**
+ * Typed intermediate representation of the bar contents
+ *
+ * Produced by the builder, spliced together by the controller and
+ * consumed directly by the renderer, which avoids the round-trip
+ * through markup strings. The ops map one-to-one to the parser sink
+ * handlers, so a display list can be replayed onto any parser sink
+ * and markup can be recorded into a display list.
+ */
+class display_list {
+  friend class parser<display_list>;
+
+ public:
+  void align(alignment align_);
+  void set_attribute(attribute attr);
+  void unset_attribute(attribute attr);
+  void toggle_attribute(attribute attr);
+  void open_action(mousebtn btn, string cmd);
+  void close_action(mousebtn btn = mousebtn::NONE);
+  void set_color(gc gc_, const lemonbuddy::color& color_);
+  void reset_color(gc gc_);
+  void set_font(int index);
+  void offset(int px);
+  void character(uint16_t character_);
+  void text(const char* text_, size_t len);
+
+  void append(const display_list& other);
+  void clear();
+
+  bool empty() const;
+  size_t size() const;
+  const vector<display_op>& ops() const;
+
+  bool remove_trailing(char chr, size_t count);
+
+  string markup() const;
+
+  bool operator==(const display_list& other) const;
+  bool operator!=(const display_list& other) const;
+
+  /**
+   * Replay the operations onto given parser sink
+   */
+  template <typename Sink>
+  void replay(Sink& sink) const {
+    for (auto&& op : m_ops) {
+      switch (op.code) {
+        case display_opcode::NONE:
+          break;
+        case display_opcode::ALIGNMENT:
+          sink.on_alignment_change(static_cast<alignment>(op.value));
+          break;
+        case display_opcode::ATTRIBUTE_SET:
+          sink.on_attribute_set(static_cast<attribute>(op.value));
+          break;
+        case display_opcode::ATTRIBUTE_UNSET:
+          sink.on_attribute_unset(static_cast<attribute>(op.value));
+          break;
+        case display_opcode::ATTRIBUTE_TOGGLE:
+          sink.on_attribute_toggle(static_cast<attribute>(op.value));
+          break;
+        case display_opcode::ACTION_OPEN:
+          sink.on_action_block_open(static_cast<mousebtn>(op.value), op.text);
+          break;
+        case display_opcode::ACTION_CLOSE:
+          sink.on_action_block_close(static_cast<mousebtn>(op.value));
+          break;
+        case display_opcode::COLOR:
+          sink.on_color_change(static_cast<gc>(op.value), op.color);
+          break;
+        case display_opcode::COLOR_RESET:
+          sink.on_color_reset(static_cast<gc>(op.value));
+          break;
+        case display_opcode::FONT:
+          sink.on_font_change(op.value);
+          break;
+        case display_opcode::OFFSET:
+          sink.on_pixel_offset(op.value);
+          break;
+        case display_opcode::CHARACTER:
+          sink.on_character_write(static_cast<uint16_t>(op.value));
+          break;
+        case display_opcode::TEXT:
+          sink.on_string_write(op.text.data(), op.text.length());
+          break;
+      }
+    }
+  }
+
+ protected:
+  void push(display_op&& op);
+
+  void on_alignment_change(alignment align_);
+  void on_attribute_set(attribute attr);
+  void on_attribute_unset(attribute attr);
+  void on_attribute_toggle(attribute attr);
+  void on_action_block_open(mousebtn btn, string cmd);
+  void on_action_block_close(mousebtn btn);
+  void on_color_change(gc gc_, lemonbuddy::color color_);
+  void on_color_reset(gc gc_);
+  void on_font_change(int index);
+  void on_pixel_offset(int px);
+  void on_character_write(uint16_t character_);
+  void on_string_write(const char* text_, size_t len);
+
+ private:
+  vector<display_op> m_ops;
+};
+
+LEMONBUDDY_NS_END
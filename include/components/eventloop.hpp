@@ -11,9 +11,15 @@ LEMONBUDDY_NS
 using module_t = unique_ptr<modules::module_interface>;
 using modulemap_t = map<alignment, vector<module_t>>;
 
+/**
+ * Dirty state of each module, indexed in the order they appear in the module map
+ */
+using dirtymap_t = vector<bool>;
+
 enum class event_type { NONE = 0, UPDATE, CHECK, INPUT, QUIT };
 struct event {
   int type;
+  int index{-1};  // index of the updated module, or -1 for all modules
   char data[256]{'\0'};
 };
 
@@ -33,7 +39,7 @@ class eventloop {
   void run(chrono::duration<double, std::milli> timeframe, int limit);
   void stop();
 
-  void set_update_cb(callback<>&& cb);
+  void set_update_cb(callback<const dirtymap_t&>&& cb);
   void set_input_db(callback<string>&& cb);
 
   void add_module(const alignment pos, module_t&& module);
@@ -45,6 +51,7 @@ class eventloop {
 
   bool match_event(entry_t evt, event_type type);
   bool compare_events(entry_t evt, entry_t evt2);
+  void mark_dirty(entry_t evt);
   void forward_event(entry_t evt);
 
   void on_update();
@@ -57,9 +64,10 @@ class eventloop {
 
   queue_t m_queue;
   modulemap_t m_modules;
+  dirtymap_t m_dirty;
   stateflag m_running;
 
-  callback<> m_update_cb;
+  callback<const dirtymap_t&> m_update_cb;
   callback<string> m_unrecognized_input_cb;
 };
 
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include "common.hpp"
+#include "components/config.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
+#include "components/scheduler.hpp"
+#include "components/supervisor.hpp"
+#include "utils/io.hpp"
+#include "utils/threading.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Asynchronous shell command executor
+ *
+ * Commands are spawned from the scheduler's worker threads and the
+ * reactor waits for their output and exit, so callers never block on
+ * a child process. A bounded amount of commands run at the same time,
+ * the others are queued, and commands still running when their
+ * deadline passes get terminated.
+ *
+ * The output is split into lines which are passed to the line callback
+ * as they arrive. The exit callback receives the exit status, or 128
+ * plus the signal number if the command was killed, together with the
+ * resources used by the command. Both callbacks are
+ * called from the reactor thread, or from a scheduler worker if the
+ * command could not be spawned.
+ */
+class executor {
+ public:
+  using job_id = size_t;
+  using line_cb = callback<string>;
+  using exit_cb = supervisor::exit_cb;
+
+  explicit executor(const logger& logger, scheduler& scheduler, reactor& reactor,
+      supervisor& supervisor, size_t jobs, chrono::milliseconds timeout, bool direct = true);
+  ~executor();
+
+  job_id run(string cmd, line_cb&& on_line = nullptr, exit_cb&& on_exit = nullptr);
+  job_id run(string cmd, chrono::milliseconds timeout, line_cb&& on_line, exit_cb&& on_exit);
+  job_id run_persistent(string cmd, line_cb&& on_line, exit_cb&& on_exit, bool input = false);
+  void spawn_detached(string cmd);
+  void cancel(job_id id);
+  bool write(job_id id, const string& line);
+
+  bool running(job_id id) const;
+  size_t active() const;
+  size_t queued() const;
+
+ protected:
+  struct job {
+    string cmd;
+    chrono::milliseconds timeout;
+    line_cb on_line;
+    exit_cb on_exit;
+    bool detached{false};
+    bool persistent{false};
+    bool input{false};
+    bool cancelled{false};
+
+    pid_t pid{-1};
+    int infd{-1};
+    int outfd{-1};
+    reactor::handler_id output{0};
+    reactor::handler_id writer{0};
+    scheduler::timer_id spawner{0};
+    scheduler::timer_id deadline{0};
+
+    io_util::line_reader reader;
+    string pending;
+    bool eof{false};
+    bool exited{false};
+    supervisor::child_status result;
+  };
+
+  job_id enqueue(job&& j);
+  void start(job_id id);
+  void spawn(job_id id);
+  void on_output(job_id id);
+  void on_writable(job_id id);
+  void on_exit(job_id id, const supervisor::child_status& result);
+  void on_deadline(job_id id);
+
+  bool takes_slot(const job& j) const;
+  void release(const job& j);
+  void read_output(job& j, vector<string>& lines);
+  bool write_input(job_id id, job& j);
+  void deliver(job_id id, vector<string>&& lines, bool exited);
+
+ private:
+  const logger& m_log;
+  scheduler& m_scheduler;
+  reactor& m_reactor;
+  supervisor& m_supervisor;
+
+  const size_t m_limit;
+  const chrono::milliseconds m_timeout;
+  const bool m_direct;
+
+  mutable std::mutex m_mutex;
+  threading_util::callback_tracker m_callbacks{m_log, "executor"};
+
+  map<job_id, job> m_jobs;
+  std::deque<job_id> m_queue;
+  job_id m_nextid{1};
+  size_t m_active{0};
+  bool m_stopped{false};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = executor&>
+  di::injector<T> configure_executor() {
+    const config& conf{configure_config().create<const config&>()};
+
+    auto jobs = conf.get<int>("settings", "executor-jobs", 4);
+    auto timeout = chrono::milliseconds{conf.get<int>("settings", "executor-timeout-ms", 30000)};
+    auto direct = conf.get<bool>("settings", "executor-direct-exec", true);
+
+    auto instance = factory::generic_singleton<executor>(
+        std::cref(configure_logger().create<const logger&>()),
+        std::ref(configure_scheduler().create<scheduler&>()),
+        std::ref(configure_reactor().create<reactor&>()),
+        std::ref(configure_supervisor().create<supervisor&>()), jobs > 0 ? jobs : 1, timeout,
+        direct);
+
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
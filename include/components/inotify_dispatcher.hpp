@@ -0,0 +1,76 @@
+#pragma once
+
+#include <mutex>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
+#include "utils/inotify.hpp"
+#include "utils/threading.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Shared inotify instance for the modules watching files
+ *
+ * All watches are attached once to a single inotify descriptor that
+ * waits in the reactor. The events are read in batches and dispatched
+ * to the watchers by watch descriptor, so a watcher is called once per
+ * batch with the masks of its events merged.
+ *
+ * The kernel returns the same watch descriptor for every watch on a
+ * given inode, so watchers of the same file share it and only receive
+ * the events they asked for.
+ */
+class inotify_dispatcher {
+ public:
+  using watch_id = size_t;
+  using event_cb = callback<const inotify_event&>;
+
+  explicit inotify_dispatcher(const logger& logger, reactor& reactor);
+  ~inotify_dispatcher();
+
+  watch_id add(const string& path, uint32_t mask, event_cb&& on_event);
+  void remove(watch_id id);
+
+  size_t size() const;
+
+ protected:
+  struct watcher {
+    int wd;
+    uint32_t mask;
+    string path;
+    event_cb on_event;
+  };
+
+  void on_events();
+  void notify(map<watch_id, inotify_event> events);
+
+ private:
+  const logger& m_log;
+  reactor& m_reactor;
+
+  int m_fd{-1};
+  reactor::handler_id m_handler{0};
+
+  mutable std::mutex m_mutex;
+  threading_util::callback_tracker m_callbacks{m_log, "inotify_dispatcher"};
+
+  map<watch_id, watcher> m_watchers;
+  watch_id m_nextid{1};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = inotify_dispatcher&>
+  di::injector<T> configure_inotify_dispatcher() {
+    auto instance = factory::generic_singleton<inotify_dispatcher>(
+        std::cref(configure_logger().create<const logger&>()),
+        std::ref(configure_reactor().create<reactor&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
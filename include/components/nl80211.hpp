@@ -0,0 +1,79 @@
+#pragma once
+
+#include <mutex>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
+#include "utils/netlink.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Shared nl80211 connection for the wireless network modules
+ *
+ * One generic netlink socket is used for the requests, and another one
+ * listens on the mlme and scan multicast groups. The mode and ESSID
+ * of the interfaces are cached until an event reports a change of the
+ * association, so polling only needs to request the station info.
+ *
+ * Without cfg80211 the nl80211 family does not exist, in which case
+ * available() returns false and the callers fall back to wireless
+ * extensions.
+ */
+class nl80211 {
+ public:
+  struct interface_info {
+    uint32_t iftype{0};
+    string ssid;
+  };
+
+  struct station_info {
+    bool has_signal{false};
+    int signal{0};            // dBm
+    unsigned int bitrate{0};  // 100 kbit/s
+  };
+
+  explicit nl80211(const logger& logger, reactor& reactor);
+  ~nl80211();
+
+  bool available() const;
+  bool interface(int ifindex, interface_info& info);
+  bool station(int ifindex, station_info& info);
+
+ protected:
+  bool resolve_family(map<string, uint32_t>& groups);
+  bool request(nlmsghdr* req, const netlink_util::message_cb& on_message);
+  void on_events();
+
+ private:
+  const logger& m_log;
+  reactor& m_reactor;
+
+  int m_requestfd{-1};
+  int m_eventfd{-1};
+  uint16_t m_family{0};
+  reactor::handler_id m_handler{0};
+  vector<char> m_requestbuf;
+  vector<char> m_eventbuf;
+
+  std::mutex m_requestlock;
+  mutable std::mutex m_mutex;
+  map<int, interface_info> m_interfaces;
+  size_t m_generation{0};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = nl80211&>
+  di::injector<T> configure_nl80211() {
+    auto instance =
+        factory::generic_singleton<nl80211>(std::cref(configure_logger().create<const logger&>()),
+            std::ref(configure_reactor().create<reactor&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -1,29 +1,370 @@
 #pragma once
 
 #include "common.hpp"
-#include "components/signals.hpp"
 #include "components/types.hpp"
 
 LEMONBUDDY_NS
 
 DEFINE_ERROR(unrecognized_token);
 
+/**
+ * Markup parser
+ *
+ * The input is walked once without being copied and each token is
+ * reported to the sink using static dispatch. The sink is required
+ * to implement the following handlers:
+ *
+ *   void on_alignment_change(alignment align);
+ *   void on_attribute_set(attribute attr);
+ *   void on_attribute_unset(attribute attr);
+ *   void on_attribute_toggle(attribute attr);
+ *   void on_action_block_open(mousebtn btn, string cmd);
+ *   void on_action_block_close(mousebtn btn);
+ *   void on_color_change(gc gc_, color color_);
+ *   void on_color_reset(gc gc_);
+ *   void on_font_change(int index);
+ *   void on_pixel_offset(int px);
+ *   void on_character_write(uint16_t character);
+ *   void on_string_write(const char* text, size_t len);
+ */
+template <typename Sink>
 class parser {
  public:
-  explicit parser(const bar_settings& bar) : m_bar(bar) {}
-  void operator()(string data);
-  void codeblock(string data);
-  size_t text(string data);
+  explicit parser(const bar_settings& bar, Sink& sink) : m_bar(bar), m_sink(sink) {}
+
+  /**
+   * Parse input data
+   */
+  void operator()(const string& data) {
+    operator()(data.data(), data.length());
+  }
+
+  /**
+   * Parse input data
+   */
+  void operator()(const char* data, size_t len) {
+    const char* end = data + len;
+
+    while (data < end) {
+      if (is_tag_start(data, end)) {
+        auto close = find_unescaped(data + 2, end, '}');
+
+        if (close != end) {
+          codeblock(data + 2, close);
+          data = close + 1;
+          continue;
+        }
+      }
+
+      data += text(data, end);
+    }
+  }
 
  protected:
-  color parse_color(string s, color fallback = color{0});
-  int parse_fontindex(string s);
-  attribute parse_attr(const char s);
-  mousebtn parse_action_btn(string data);
-  string parse_action_cmd(string data);
+  /**
+   * Parse contents in tag blocks, i.e: %{...}
+   */
+  void codeblock(const char* data, const char* end) {
+    while (data < end) {
+      while (data < end && *data == ' ') data++;
+
+      if (data == end)
+        break;
+
+      char tag = *data++;
+
+      const char* value = data;
+      const char* value_end = data;
+      while (value_end < end && *value_end != ' ') value_end++;
+
+      switch (tag) {
+        case 'B':
+          // Ignore tag if it occurs again later in the same block
+          if (contains(data, end, " B"))
+            break;
+          if (is_reset(value, value_end))
+            m_sink.on_color_reset(gc::BG);
+          else
+            m_sink.on_color_change(gc::BG, parse_color(value, value_end, m_bar.background));
+          break;
+
+        case 'F':
+          // Ignore tag if it occurs again later in the same block
+          if (contains(data, end, " F"))
+            break;
+          if (is_reset(value, value_end))
+            m_sink.on_color_reset(gc::FG);
+          else
+            m_sink.on_color_change(gc::FG, parse_color(value, value_end, m_bar.foreground));
+          break;
+
+        case 'U':
+          // Ignore tag if it occurs again later in the same block
+          if (contains(data, end, " U"))
+            break;
+          if (is_reset(value, value_end)) {
+            m_sink.on_color_reset(gc::UL);
+            m_sink.on_color_reset(gc::OL);
+          } else {
+            m_sink.on_color_change(gc::UL, parse_color(value, value_end, m_bar.linecolor));
+            m_sink.on_color_change(gc::OL, parse_color(value, value_end, m_bar.linecolor));
+          }
+          break;
+
+        case 'R':
+          m_sink.on_color_change(gc::BG, m_bar.foreground);
+          m_sink.on_color_change(gc::FG, m_bar.background);
+          break;
+
+        case 'T':
+          if (!contains(data, end, " T"))
+            m_sink.on_font_change(parse_fontindex(value, value_end));
+          break;
+
+        case 'O':
+          m_sink.on_pixel_offset(parse_int(value, value_end));
+          break;
+
+        case 'l':
+          m_sink.on_alignment_change(alignment::LEFT);
+          break;
+
+        case 'c':
+          m_sink.on_alignment_change(alignment::CENTER);
+          break;
+
+        case 'r':
+          m_sink.on_alignment_change(alignment::RIGHT);
+          break;
+
+        case '+':
+          m_sink.on_attribute_set(parse_attr(value, value_end));
+          break;
+
+        case '-':
+          m_sink.on_attribute_unset(parse_attr(value, value_end));
+          break;
+
+        case '!':
+          m_sink.on_attribute_toggle(parse_attr(value, value_end));
+          break;
+
+        case 'A':
+          if (is_action_open(data, end)) {
+            mousebtn btn = parse_action_btn(data, end);
+            m_actions.push_back(static_cast<int>(btn));
+
+            // The command is wrapped in colons, i.e: A1:cmd:
+            const char* cmd = data + (*data != ':' ? 1 : 0);
+            if (cmd < end && *cmd == ':')
+              cmd++;
+            auto cmd_end = find_unescaped(cmd, end, ':');
+
+            m_sink.on_action_block_open(btn, unescape(cmd, cmd_end));
+
+            data = cmd_end < end ? cmd_end + 1 : end;
+            continue;
+          } else if (!m_actions.empty()) {
+            m_sink.on_action_block_close(parse_action_btn(data, end));
+            m_actions.pop_back();
+          }
+          break;
+
+        default:
+          throw unrecognized_token(string{tag});
+      }
+
+      if (data < end)
+        data += value_end > value ? value_end - value : 1;
+    }
+  }
+
+  /**
+   * Parse text strings
+   *
+   * @return Number of bytes consumed
+   */
+  size_t text(const char* data, const char* end) {
+    auto utf = reinterpret_cast<const uint8_t*>(data);
+    size_t avail = end - data;
+
+    if (utf[0] < 0x80) {
+      // grab all consecutive ascii chars up until the next tag
+      size_t n = 1;
+      while (n < avail && utf[n] < 0x80 && !is_tag_start(data + n, end)) n++;
+      m_sink.on_string_write(data, n);
+      return n;
+    }
+
+    size_t len;
+
+    if ((utf[0] & 0xe0) == 0xc0)
+      len = 2;
+    else if ((utf[0] & 0xf0) == 0xe0)
+      len = 3;
+    else if ((utf[0] & 0xf8) == 0xf0)
+      len = 4;
+    else if ((utf[0] & 0xfc) == 0xf8)
+      len = 5;
+    else if ((utf[0] & 0xfe) == 0xfc)
+      len = 6;
+    else {  // invalid utf-8 sequence
+      m_sink.on_character_write(utf[0]);
+      return 1;
+    }
+
+    if (len > avail) {  // truncated utf-8 sequence
+      m_sink.on_character_write(0xfffd);
+      return avail;
+    }
+
+    if (len == 2)
+      m_sink.on_character_write((utf[0] & 0x1f) << 6 | (utf[1] & 0x3f));
+    else if (len == 3)
+      m_sink.on_character_write((utf[0] & 0xf) << 12 | (utf[1] & 0x3f) << 6 | (utf[2] & 0x3f));
+    else  // outside of the basic multilingual plane
+      m_sink.on_character_write(0xfffd);
+
+    return len;
+  }
+
+  /**
+   * Check if a tag block starts at given position
+   */
+  static bool is_tag_start(const char* data, const char* end) {
+    return end - data >= 2 && data[0] == '%' && data[1] == '{';
+  }
+
+  /**
+   * Check if the action tag value opens a new block, i.e: A:cmd: or A1:cmd:
+   */
+  static bool is_action_open(const char* data, const char* end) {
+    if (data < end && *data == ':')
+      return true;
+    return end - data >= 2 && isdigit(data[0]) && data[1] == ':';
+  }
+
+  /**
+   * Find the first occurrence of given character that isn't escaped using a backslash
+   *
+   * @return Pointer to the character or end if not found
+   */
+  static const char* find_unescaped(const char* data, const char* end, char chr) {
+    for (const char* pos = data; pos < end; pos++) {
+      if (*pos == chr && (pos == data || pos[-1] != '\\'))
+        return pos;
+    }
+    return end;
+  }
+
+  /**
+   * Copy range while removing the backslashes used to escape ':', '{' and '}'
+   */
+  static string unescape(const char* data, const char* end) {
+    string result;
+    result.reserve(end - data);
+    for (; data < end; data++) {
+      if (*data == '\\' && data + 1 < end && strchr(":{}", data[1]) != nullptr)
+        data++;
+      result += *data;
+    }
+    return result;
+  }
+
+  /**
+   * Check if the range contains given needle
+   */
+  static bool contains(const char* data, const char* end, const char (&needle)[3]) {
+    for (; end - data >= 2; data++) {
+      if (data[0] == needle[0] && data[1] == needle[1])
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * Parse signed decimal integer, ignoring any trailing characters
+   */
+  static int parse_int(const char* data, const char* end) {
+    bool negative{data < end && *data == '-'};
+    int value{0};
+
+    if (data < end && (*data == '-' || *data == '+'))
+      data++;
+    for (; data < end && isdigit(*data); data++) {
+      value = value * 10 + (*data - '0');
+    }
+
+    return negative ? -value : value;
+  }
+
+  /**
+   * Check if the color value resets to the default color
+   */
+  static bool is_reset(const char* data, const char* end) {
+    return data == end || (end - data == 1 && *data == '-');
+  }
+
+  /**
+   * Parse color value
+   *
+   * A value only containing the alpha channel (#aa) is
+   * applied to the rgb channels of the fallback color
+   */
+  static color parse_color(const char* data, const char* end, color fallback) {
+    if (end - data == 3 && *data == '#') {
+      string rgb{fallback.source()};
+      if (rgb.length() == 4)
+        rgb = {rgb[1], rgb[1], rgb[2], rgb[2], rgb[3], rgb[3]};
+      if (rgb.length() >= 6)
+        return color::parse(string{data, end} + rgb.substr(rgb.length() - 6), fallback);
+    }
+    return color::parse(string{data, end}, fallback);
+  }
+
+  /**
+   * Parse font index, where "-" resets to the default font
+   */
+  static int parse_fontindex(const char* data, const char* end) {
+    if (data == end || (end - data == 1 && *data == '-'))
+      return -1;
+    return parse_int(data, end);
+  }
+
+  /**
+   * Parse line attribute
+   */
+  static attribute parse_attr(const char* data, const char* end) {
+    if (data == end)
+      return attribute::NONE;
+
+    switch (*data) {
+      case 'o':
+        return attribute::o;
+      case 'u':
+        return attribute::u;
+    }
+
+    return attribute::NONE;
+  }
+
+  /**
+   * Parse action button, defaulting to the button of the innermost open action
+   */
+  mousebtn parse_action_btn(const char* data, const char* end) {
+    if (data < end && *data == ':')
+      return mousebtn::LEFT;
+    else if (data < end && isdigit(*data))
+      return static_cast<mousebtn>(*data - '0');
+    else if (!m_actions.empty())
+      return static_cast<mousebtn>(m_actions.back());
+    else
+      return mousebtn::NONE;
+  }
 
  private:
   const bar_settings& m_bar;
+  Sink& m_sink;
   vector<int> m_actions;
 };
 
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <mutex>
+#include <set>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+
+LEMONBUDDY_NS
+
+namespace providers {
+  using clock = chrono::steady_clock;
+
+  // samples {{{
+
+  struct cpu_time {
+    unsigned long long user;
+    unsigned long long nice;
+    unsigned long long system;
+    unsigned long long idle;
+    unsigned long long total;
+  };
+
+  /**
+   * Times spent by each core, read from /proc/stat
+   */
+  struct cpu_sample {
+    vector<cpu_time> cores;
+  };
+
+  /**
+   * Memory statistics in kB, read from /proc/meminfo
+   */
+  struct meminfo_sample {
+    unsigned long long total{0};
+    unsigned long long free{0};
+    unsigned long long available{0};
+  };
+
+  function<bool(cpu_sample&)> cpu_times_reader();
+  function<bool(meminfo_sample&)> meminfo_reader();
+
+  // }}}
+  // class : provider {{{
+
+  /**
+   * Shared reader of a data source
+   *
+   * The source is read at most once per half of the shortest interval
+   * of the subscribers, all requests in between get the same sample.
+   * Samples are immutable, so subscribers can keep the previous one
+   * around to compare it with the next.
+   */
+  template <typename Sample>
+  class provider {
+   public:
+    using sample_t = shared_ptr<const Sample>;
+    using reader_t = function<bool(Sample&)>;
+
+    explicit provider(reader_t&& reader) : m_reader(forward<reader_t>(reader)) {}
+
+    void add(clock::duration interval) {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_intervals.insert(interval);
+    }
+
+    void remove(clock::duration interval) {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      auto it = m_intervals.find(interval);
+      if (it != m_intervals.end())
+        m_intervals.erase(it);
+    }
+
+    /**
+     * Get the latest sample, reading the source unless
+     * the previous sample is recent enough
+     *
+     * Returns nullptr if the source could not be read
+     */
+    sample_t sample() {
+      std::lock_guard<std::mutex> guard(m_mutex);
+
+      auto now = clock::now();
+
+      if (m_sample && !m_intervals.empty() && now - m_time < *m_intervals.begin() / 2)
+        return m_sample;
+
+      auto sample = make_shared<Sample>();
+
+      if (!m_reader(*sample))
+        return nullptr;
+
+      m_sample = move(sample);
+      m_time = now;
+      m_reads++;
+
+      return m_sample;
+    }
+
+    size_t reads() const {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      return m_reads;
+    }
+
+   private:
+    mutable std::mutex m_mutex;
+    reader_t m_reader;
+    std::multiset<clock::duration> m_intervals;
+    sample_t m_sample;
+    clock::time_point m_time;
+    size_t m_reads{0};
+  };
+
+  // }}}
+  // class : subscription {{{
+
+  /**
+   * Handle keeping a provider alive and its interval registered
+   */
+  template <typename Sample>
+  class subscription {
+   public:
+    using sample_t = typename provider<Sample>::sample_t;
+
+    subscription() = default;
+
+    explicit subscription(shared_ptr<provider<Sample>> instance, clock::duration interval)
+        : m_provider(move(instance)), m_interval(interval) {
+      m_provider->add(m_interval);
+    }
+
+    subscription(const subscription&) = delete;
+    subscription& operator=(const subscription&) = delete;
+
+    subscription(subscription&& other) noexcept
+        : m_provider(move(other.m_provider)), m_interval(other.m_interval) {}
+
+    subscription& operator=(subscription&& other) noexcept {
+      if (m_provider)
+        m_provider->remove(m_interval);
+      m_provider = move(other.m_provider);
+      m_interval = other.m_interval;
+      return *this;
+    }
+
+    ~subscription() {
+      if (m_provider)
+        m_provider->remove(m_interval);
+    }
+
+    explicit operator bool() const {
+      return m_provider != nullptr;
+    }
+
+    sample_t sample() const {
+      return m_provider->sample();
+    }
+
+    const provider<Sample>& source() const {
+      return *m_provider;
+    }
+
+   private:
+    shared_ptr<provider<Sample>> m_provider;
+    clock::duration m_interval{0};
+  };
+
+  // }}}
+}
+
+/**
+ * Registry of the data providers shared by the modules
+ *
+ * Providers are keyed by their data source, i.e. "cpu" or "meminfo",
+ * and live as long as there are subscriptions to them
+ */
+class provider_registry {
+ public:
+  explicit provider_registry(const logger& logger) : m_log(logger) {}
+
+  template <typename Sample, typename Interval>
+  providers::subscription<Sample> subscribe(const string& key, Interval interval,
+      typename providers::provider<Sample>::reader_t&& reader) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    // Drop the providers that lost all their subscribers
+    for (auto it = m_providers.begin(); it != m_providers.end();) {
+      if (it->second.expired())
+        it = m_providers.erase(it);
+      else
+        it++;
+    }
+
+    auto instance = std::static_pointer_cast<providers::provider<Sample>>(m_providers[key].lock());
+
+    if (!instance) {
+      m_log.trace("provider_registry: Creating provider '%s'", key);
+      instance = make_shared<providers::provider<Sample>>(move(reader));
+      m_providers[key] = instance;
+    }
+
+    return providers::subscription<Sample>{
+        instance, chrono::duration_cast<providers::clock::duration>(interval)};
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    size_t count{0};
+    for (auto&& p : m_providers) count += p.second.expired() ? 0 : 1;
+    return count;
+  }
+
+ private:
+  const logger& m_log;
+  mutable std::mutex m_mutex;
+  map<string, std::weak_ptr<void>> m_providers;
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = provider_registry&>
+  di::injector<T> configure_provider_registry() {
+    auto instance = factory::generic_singleton<provider_registry>(
+        std::cref(configure_logger().create<const logger&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
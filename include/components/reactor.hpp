@@ -0,0 +1,73 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <condition_variable>
+#include <mutex>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Shared epoll reactor for the file descriptors of all modules
+ *
+ * Handlers are registered together with the descriptor they wait for
+ * and are called from the reactor thread with the returned epoll event
+ * mask as soon as the descriptor becomes ready, so modules only wake up
+ * when there is something to process. The handlers run one at a time
+ * and should therefore never block for long.
+ */
+class reactor {
+ public:
+  using handler_t = callback<uint32_t>;
+  using handler_id = size_t;
+
+  explicit reactor(const logger& logger);
+  ~reactor();
+
+  handler_id add(int fd, uint32_t events, handler_t&& handler);
+  void modify(handler_id id, uint32_t events);
+  void remove(handler_id id);
+
+  size_t size() const;
+
+ protected:
+  struct handler {
+    int fd;
+    handler_t callback;
+    bool running{false};
+    thread::id runner;
+  };
+
+  void dispatch();
+
+ private:
+  const logger& m_log;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_finished;
+
+  map<handler_id, handler> m_handlers;
+  handler_id m_nextid{1};
+
+  int m_epollfd{-1};
+  int m_eventfd{-1};
+
+  thread m_thread;
+  stateflag m_running{true};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = reactor&>
+  di::injector<T> configure_reactor() {
+    auto instance =
+        factory::generic_singleton<reactor>(std::cref(configure_logger().create<const logger&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
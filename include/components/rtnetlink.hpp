@@ -0,0 +1,107 @@
+#pragma once
+
+#include <linux/netlink.h>
+#include <mutex>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
+#include "utils/threading.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Shared rtnetlink connection for the network modules
+ *
+ * One socket subscribed to the link and IPv4 address groups keeps
+ * the state of the watched interfaces up to date, and the watchers
+ * are notified from the reactor thread as soon as their interface
+ * changes state or address. The traffic counters are requested for
+ * a single interface at a time, so polling them does not depend on
+ * the amount of interfaces in the system.
+ */
+class rtnetlink {
+ public:
+  using watch_id = size_t;
+
+  struct link_state {
+    bool valid{false};
+    unsigned int flags{0};
+    unsigned char operstate{0};
+    string ip;
+
+    bool up() const;
+
+    bool operator==(const link_state& other) const {
+      return valid == other.valid && flags == other.flags && operstate == other.operstate &&
+             ip == other.ip;
+    }
+    bool operator!=(const link_state& other) const {
+      return !(*this == other);
+    }
+  };
+
+  struct link_counters {
+    unsigned long long transmitted{0};
+    unsigned long long received{0};
+  };
+
+  using state_cb = callback<const link_state&>;
+
+  explicit rtnetlink(const logger& logger, reactor& reactor);
+  ~rtnetlink();
+
+  watch_id watch(int ifindex, state_cb&& on_change = nullptr);
+  void unwatch(watch_id id);
+
+  link_state state(int ifindex) const;
+  bool counters(int ifindex, link_counters& counters);
+
+  size_t size() const;
+
+ protected:
+  struct watcher {
+    int ifindex;
+    state_cb on_change;
+  };
+
+  void on_events();
+  bool refresh(int ifindex);
+  bool request(nlmsghdr* msg, callback<const nlmsghdr*> on_message);
+  int parse_link(const nlmsghdr* msg, link_state* state, link_counters* counters) const;
+  int parse_address(const nlmsghdr* msg, string& ip) const;
+  void notify(vector<int> changed);
+
+ private:
+  const logger& m_log;
+  reactor& m_reactor;
+
+  int m_eventfd{-1};
+  int m_requestfd{-1};
+  reactor::handler_id m_handler{0};
+  vector<char> m_eventbuf;
+  vector<char> m_requestbuf;
+
+  mutable std::mutex m_mutex;
+  std::mutex m_requestlock;
+  threading_util::callback_tracker m_callbacks{m_log, "rtnetlink"};
+
+  map<int, link_state> m_links;
+  map<watch_id, watcher> m_watchers;
+  watch_id m_nextid{1};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = rtnetlink&>
+  di::injector<T> configure_rtnetlink() {
+    auto instance =
+        factory::generic_singleton<rtnetlink>(std::cref(configure_logger().create<const logger&>()),
+            std::ref(configure_reactor().create<reactor&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "common.hpp"
+#include "components/config.hpp"
+#include "components/logger.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Hierarchical timer wheel
+ *
+ * Deadlines are given in ticks. Each level has 64 slots and an entry is
+ * stored on the level of the most significant 6-bit group in which its
+ * deadline differs from the current tick. When the wheel advances into
+ * a new group, the entries of the matching slot are cascaded down until
+ * they reach the lowest level, where they expire.
+ */
+class timer_wheel {
+ public:
+  static constexpr size_t LEVELS{4};
+  static constexpr size_t SLOT_BITS{6};
+  static constexpr size_t SLOTS{1 << SLOT_BITS};
+
+  explicit timer_wheel(uint64_t current = 0) : m_current(current) {}
+
+  void insert(size_t id, uint64_t deadline);
+  void advance(uint64_t tick, vector<size_t>& expired);
+  bool next_expiry(uint64_t& tick) const;
+
+  uint64_t current() const;
+  size_t size() const;
+
+ protected:
+  struct entry {
+    size_t id;
+    uint64_t deadline;
+  };
+
+  void place(const entry& e);
+  void cascade(vector<entry>& slot);
+  void collect(vector<entry>& slot, vector<size_t>& expired);
+
+ private:
+  uint64_t m_current;
+  size_t m_size{0};
+  vector<entry> m_slots[LEVELS][SLOTS];
+  vector<entry> m_overflow;
+};
+
+/**
+ * Shared scheduler running the periodic work of all modules
+ *
+ * The deadlines are kept in a timer wheel that is driven by a single
+ * timerfd. Expired timers are handed over to a small fixed pool of
+ * worker threads. Deadlines are absolute, so the intervals don't drift,
+ * and timers expiring within the slack window are run together to
+ * keep the amount of wakeups down.
+ */
+class scheduler {
+ public:
+  using clock = chrono::steady_clock;
+  using task_t = callback<>;
+  using timer_id = size_t;
+
+  explicit scheduler(const logger& logger, size_t workers, chrono::milliseconds slack);
+  ~scheduler();
+
+  timer_id every(clock::duration interval, task_t&& task);
+  timer_id once(clock::duration delay, task_t&& task);
+  void cancel(timer_id id);
+
+  size_t thread_count() const;
+  double wakeups_per_second() const;
+
+ protected:
+  static constexpr chrono::seconds STATS_INTERVAL{60};
+
+  struct timer {
+    clock::time_point deadline;
+    clock::duration interval;
+    task_t task;
+    bool running{false};
+    bool cancelled{false};
+    thread::id runner;
+  };
+
+  timer_id add(clock::time_point deadline, clock::duration interval, task_t&& task);
+  uint64_t to_tick(clock::time_point point, bool round_up = false) const;
+
+  void arm();
+  void dispatch();
+  void work();
+
+ private:
+  const logger& m_log;
+  const chrono::milliseconds m_slack;
+  const clock::time_point m_epoch{clock::now()};
+
+  std::mutex m_mutex;
+  std::condition_variable m_queued;
+  std::condition_variable m_finished;
+
+  timer_wheel m_wheel;
+  map<timer_id, timer> m_timers;
+  std::deque<timer_id> m_queue;
+  timer_id m_nextid{1};
+
+  int m_timerfd{-1};
+  int m_eventfd{-1};
+
+  vector<thread> m_threads;
+  stateflag m_running{true};
+  std::atomic<size_t> m_wakeups{0};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = scheduler&>
+  di::injector<T> configure_scheduler() {
+    const config& conf{configure_config().create<const config&>()};
+
+    auto workers = conf.get<int>("settings", "scheduler-workers", 2);
+    auto slack = chrono::milliseconds{conf.get<int>("settings", "scheduler-slack-ms", 50)};
+
+    auto instance = factory::generic_singleton<scheduler>(
+        std::cref(configure_logger().create<const logger&>()), workers > 0 ? workers : 1, slack);
+
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
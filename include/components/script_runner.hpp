@@ -0,0 +1,106 @@
+#pragma once
+
+#include <mutex>
+
+#include "common.hpp"
+#include "components/config.hpp"
+#include "components/executor.hpp"
+#include "components/logger.hpp"
+#include "components/scheduler.hpp"
+#include "utils/threading.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Shared runner for the interval commands of the script modules
+ *
+ * Modules subscribe with their command and interval, and every distinct
+ * pair is run once per period no matter how many modules (or bars)
+ * subscribed to it. The last line of the output is passed to all
+ * subscribers together with the counter used to expand `%counter%`.
+ *
+ * When caching is enabled the last result of a command outlives its
+ * subscribers, so the modules created after a reload get their output
+ * right away instead of waiting for the command to finish.
+ */
+class script_runner {
+ public:
+  using subscription_id = size_t;
+  using output_cb = callback<const string&, int>;
+
+  explicit script_runner(
+      const logger& logger, scheduler& scheduler, executor& executor, bool cache);
+  ~script_runner();
+
+  subscription_id subscribe(
+      const string& cmd, chrono::milliseconds interval, output_cb&& on_output);
+  void unsubscribe(subscription_id id);
+
+  size_t size() const;
+
+ protected:
+  struct result {
+    string output;
+    int counter{0};
+    bool valid{false};
+  };
+
+  struct entry {
+    string cmd;
+    chrono::milliseconds interval;
+    scheduler::timer_id timer{0};
+    executor::job_id job{0};
+    size_t runs{0};
+    map<subscription_id, output_cb> subscribers;
+    string pending;
+    result last;
+  };
+
+  struct subscription {
+    string key;
+    scheduler::timer_id initial{0};
+  };
+
+  static string make_key(const string& cmd, chrono::milliseconds interval);
+
+  void tick(const string& key);
+  void tick_locked(entry& e);
+  void on_line(const string& key, size_t run, string line);
+  void on_exit(const string& key, size_t run, const supervisor::child_status& result);
+  void publish(const string& key, subscription_id only = 0);
+
+ private:
+  const logger& m_log;
+  scheduler& m_scheduler;
+  executor& m_executor;
+  const bool m_cache;
+
+  mutable std::mutex m_mutex;
+  threading_util::callback_tracker m_callbacks{m_log, "script_runner"};
+
+  map<string, entry> m_entries;
+  map<string, result> m_results;
+  map<subscription_id, subscription> m_subscriptions;
+  subscription_id m_nextid{1};
+  bool m_stopped{false};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = script_runner&>
+  di::injector<T> configure_script_runner() {
+    const config& conf{configure_config().create<const config&>()};
+
+    auto instance = factory::generic_singleton<script_runner>(
+        std::cref(configure_logger().create<const logger&>()),
+        std::ref(configure_scheduler().create<scheduler&>()),
+        std::ref(configure_executor().create<executor&>()),
+        conf.get<bool>("settings", "script-cache", false));
+
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <mutex>
+
+#include "common.hpp"
+#include "components/logger.hpp"
+#include "components/reactor.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Child process supervisor
+ *
+ * Waits for the exit of child processes using a pidfd per child that
+ * is registered with the reactor, so exits are pushed instead of being
+ * polled with waitpid. Kernels without pidfd support (< 5.3) fall back
+ * to a signalfd receiving SIGCHLD, which requires the signal to be
+ * blocked in all threads.
+ *
+ * The exit callback is called from the reactor thread together with
+ * the resources used by the child.
+ */
+class supervisor {
+ public:
+  struct child_status {
+    pid_t pid{-1};
+    int status{-1};
+    chrono::microseconds utime{0};
+    chrono::microseconds stime{0};
+    long maxrss{0};
+  };
+
+  using exit_cb = callback<const child_status&>;
+
+  explicit supervisor(const logger& logger, reactor& reactor);
+  ~supervisor();
+
+  void watch(pid_t pid, exit_cb&& handler);
+  void unwatch(pid_t pid);
+
+  size_t size() const;
+
+ protected:
+  struct child {
+    int pidfd{-1};
+    reactor::handler_id handler{0};
+    exit_cb on_exit;
+  };
+
+  void attach_sigchld();
+  void on_pidfd(pid_t pid);
+  void on_sigchld();
+  bool collect(pid_t pid, child_status& result) const;
+
+ private:
+  const logger& m_log;
+  reactor& m_reactor;
+
+  mutable std::mutex m_mutex;
+  map<pid_t, child> m_children;
+
+  int m_signalfd{-1};
+  int m_eventfd{-1};
+  reactor::handler_id m_sighandler{0};
+  reactor::handler_id m_eventhandler{0};
+};
+
+namespace {
+  /**
+   * Configure injection module
+   */
+  template <typename T = supervisor&>
+  di::injector<T> configure_supervisor() {
+    auto instance = factory::generic_singleton<supervisor>(
+        std::cref(configure_logger().create<const logger&>()),
+        std::ref(configure_reactor().create<reactor&>()));
+    return di::make_injector(di::bind<>().to(instance));
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -6,6 +6,8 @@
 
 LEMONBUDDY_NS
 
+struct fonttype;
+
 enum class border { NONE = 0, TOP, BOTTOM, LEFT, RIGHT, ALL };
 enum class alignment { NONE = 0, LEFT, CENTER, RIGHT };
 enum class syntaxtag { NONE = 0, A, B, F, T, U, O, R, o, u };
@@ -111,6 +113,25 @@ struct action_block {
 #endif
 };
 
+struct text_run {
+  text_run() = default;
+  fonttype* font{nullptr};
+  lemonbuddy::color foreground{g_colorblack};
+  lemonbuddy::color background{g_colorwhite};
+  lemonbuddy::color underline{g_colorblack};
+  lemonbuddy::color overline{g_colorblack};
+  int attributes{0};
+  int16_t x{0};
+  int16_t width{0};
+  vector<uint16_t> chars;
+};
+
+struct layout_block {
+  layout_block() = default;
+  vector<text_run> runs;
+  int16_t width{0};
+};
+
 struct wmsettings_bspwm {};
 
 LEMONBUDDY_NS_END
@@ -6,6 +6,7 @@
 #include "drawtypes/progressbar.hpp"
 #include "drawtypes/ramp.hpp"
 #include "modules/meta.hpp"
+#include "utils/file.hpp"
 
 LEMONBUDDY_NS
 
@@ -15,7 +16,7 @@ namespace modules {
     float read() const;
 
    private:
-    string m_path;
+    unique_ptr<file_util::file_reader> m_reader;
   };
 
   class backlight_module : public inotify_module<backlight_module> {
@@ -23,7 +24,6 @@ namespace modules {
     using inotify_module::inotify_module;
 
     void setup();
-    void idle();
     bool on_event(inotify_event* event);
     bool build(builder* builder, string tag) const;
 
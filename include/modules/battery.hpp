@@ -7,28 +7,60 @@
 #include "drawtypes/ramp.hpp"
 #include "modules/meta.hpp"
 #include "utils/file.hpp"
-#include "utils/inotify.hpp"
 #include "utils/string.hpp"
 
 LEMONBUDDY_NS
 
 namespace modules {
   enum class battery_state { NONE = 0, UNKNOWN, CHARGING, DISCHARGING, FULL };
-  class battery_module : public inotify_module<battery_module> {
+
+  /**
+   * Last known properties of a power supply, as reported
+   * by its uevents or its sysfs uevent file
+   *
+   * The energy values are in µWh and µW, or in µAh and µA
+   * if the driver reports the charge instead
+   */
+  struct power_supply {
+    string status;
+    int online{-1};
+    int capacity{-1};
+    bool charge{false};
+    unsigned long long energy_now{0};
+    unsigned long long energy_full{0};
+    unsigned long long power_now{0};
+  };
+
+  /**
+   * Module showing the state of one or more batteries
+   *
+   * The kernel broadcasts a uevent every time the state of a power supply
+   * changes, so the module listens on a NETLINK_KOBJECT_UEVENT socket and
+   * takes the properties straight from the payload. The uevent files in
+   * sysfs are only polled as a fallback, at a long interval.
+   */
+  class battery_module : public event_module<battery_module> {
    public:
-    using inotify_module::inotify_module;
+    using event_module::event_module;
+
+    ~battery_module();
 
     void setup();
     void start();
-    void teardown();
-    bool on_event(inotify_event* event);
+    void attach();
+    bool has_event();
+    bool update();
     string get_format() const;
     bool build(builder* builder, string tag) const;
 
    protected:
-    int current_percentage();
-    battery_state current_state();
-    void subthread();
+    bool apply(const char* data, size_t len, bool from_uevent);
+    void poll();
+    void animate();
+    int current_percentage() const;
+    battery_state current_state(int percentage) const;
+    chrono::seconds current_time(battery_state state) const;
+    bool same_unit() const;
 
    private:
     static constexpr auto FORMAT_CHARGING = "format-charging";
@@ -49,16 +81,19 @@ namespace modules {
     label_t m_label_discharging;
     label_t m_label_full;
 
-    string m_battery;
+    vector<string> m_batteries;
     string m_adapter;
-    string m_path_capacity;
-    string m_path_adapter;
+    map<string, power_supply> m_supplies;
+    vector<unique_ptr<file_util::file_reader>> m_files;
 
-    battery_state m_state = battery_state::UNKNOWN;
-    std::atomic_int m_percentage{0};
+    int m_socketfd{-1};
+    vector<char> m_eventbuf;
 
-    stateflag m_notified{false};
+    std::atomic<battery_state> m_state{battery_state::NONE};
+    std::atomic_int m_percentage{0};
+    chrono::seconds m_time{0};
 
+    interval_t m_pollinterval{0};
     int m_fullat = 100;
   };
 }
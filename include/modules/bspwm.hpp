@@ -4,6 +4,7 @@
 #include "drawtypes/label.hpp"
 #include "modules/meta.hpp"
 #include "utils/bspwm.hpp"
+#include "utils/io.hpp"
 
 LEMONBUDDY_NS
 
@@ -45,6 +46,7 @@ namespace modules {
 
     void setup();
     void stop();
+    void attach();
     bool has_event();
     bool update();
     bool build(builder* builder, string tag) const;
@@ -59,6 +61,9 @@ namespace modules {
     static constexpr auto EVENT_CLICK = "bwm";
 
     bspwm_util::connection_t m_subscriber;
+    reactor::handler_id m_handler{0};
+    io_util::line_reader m_reader;
+    string m_status;
 
     map<bspwm_flag, label_t> m_modelabels;
     map<bspwm_flag, label_t> m_statelabels;
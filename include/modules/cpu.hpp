@@ -2,6 +2,7 @@
 
 #include <istream>
 
+#include "components/provider.hpp"
 #include "config.hpp"
 #include "drawtypes/label.hpp"
 #include "drawtypes/progressbar.hpp"
@@ -11,16 +12,6 @@
 LEMONBUDDY_NS
 
 namespace modules {
-  struct cpu_time {
-    unsigned long long user;
-    unsigned long long nice;
-    unsigned long long system;
-    unsigned long long idle;
-    unsigned long long total;
-  };
-
-  using cpu_time_t = unique_ptr<cpu_time>;
-
   class cpu_module : public timer_module<cpu_module> {
    public:
     using timer_module::timer_module;
@@ -44,8 +35,11 @@ namespace modules {
     ramp_t m_rampload_core;
     label_t m_label;
 
-    vector<cpu_time_t> m_cputimes;
-    vector<cpu_time_t> m_cputimes_prev;
+    provider_registry& m_providers{configure_provider_registry().create<provider_registry&>()};
+    providers::subscription<providers::cpu_sample> m_source;
+
+    shared_ptr<const providers::cpu_sample> m_cputimes;
+    shared_ptr<const providers::cpu_sample> m_cputimes_prev;
 
     float m_total = 0;
     vector<float> m_load;
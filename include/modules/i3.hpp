@@ -46,6 +46,7 @@ namespace modules {
 
     void setup();
     void stop();
+    void attach();
     bool has_event();
     bool update();
     bool build(builder* builder, string tag) const;
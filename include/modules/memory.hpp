@@ -2,6 +2,7 @@
 
 #include <istream>
 
+#include "components/provider.hpp"
 #include "config.hpp"
 #include "drawtypes/label.hpp"
 #include "drawtypes/progressbar.hpp"
@@ -25,6 +26,9 @@ namespace modules {
     static constexpr auto TAG_BAR_USED = "<bar-used>";
     static constexpr auto TAG_BAR_FREE = "<bar-free>";
 
+    provider_registry& m_providers{configure_provider_registry().create<provider_registry&>()};
+    providers::subscription<providers::meminfo_sample> m_source;
+
     label_t m_label;
     progressbar_t m_bar_free;
     map<memtype, progressbar_t> m_bars;
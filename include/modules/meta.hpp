@@ -7,7 +7,10 @@
 #include "common.hpp"
 #include "components/builder.hpp"
 #include "components/config.hpp"
+#include "components/inotify_dispatcher.hpp"
 #include "components/logger.hpp"
+#include "components/reactor.hpp"
+#include "components/scheduler.hpp"
 #include "utils/inotify.hpp"
 #include "utils/string.hpp"
 #include "utils/threading.hpp"
@@ -41,7 +44,7 @@ namespace modules {
     int margin;
     int offset;
 
-    string decorate(builder* builder, string output) {
+    display_list decorate(builder* builder, const display_list& output) {
       if (offset != 0)
         builder->offset(offset);
       if (margin > 0)
@@ -153,7 +156,7 @@ namespace modules {
     virtual void start() = 0;
     virtual void stop() = 0;
     virtual void halt(string error_message) = 0;
-    virtual string contents() = 0;
+    virtual shared_ptr<const display_list> contents() = 0;
 
     virtual bool handle_event(string cmd) = 0;
     virtual bool receive_events() const = 0;
@@ -178,6 +181,8 @@ namespace modules {
 
     ~module() noexcept {
       m_log.trace("%s: Deconstructing", name());
+      m_log.trace("%s: Lock contended %lu times, %lu waits", name(), m_lock.contentions(),
+          m_lock.sleeps());
 
       for (auto&& thread_ : m_threads) {
         if (thread_.joinable()) {
@@ -223,7 +228,22 @@ namespace modules {
 
       wakeup();
 
-      std::lock_guard<threading_util::spin_lock> guard(m_lock);
+      // No timers or handlers get added once the module is disabled
+      vector<scheduler::timer_id> timers;
+      vector<reactor::handler_id> handlers;
+      {
+        std::lock_guard<std::mutex> guard(m_sourcelock);
+        timers.swap(m_timers);
+        handlers.swap(m_handlers);
+      }
+      for (auto&& timer : timers) {
+        m_scheduler.cancel(timer);
+      }
+      for (auto&& handler : handlers) {
+        m_reactor.remove(handler);
+      }
+
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
       {
         CAST_MOD(Impl)->teardown();
 
@@ -245,8 +265,14 @@ namespace modules {
 
     void teardown() {}
 
-    string contents() {
-      return m_cache;
+    /**
+     * Get the last published output
+     *
+     * The snapshot is immutable and replaced as a whole on broadcast,
+     * so it can be read from any thread without locking the module
+     */
+    shared_ptr<const display_list> contents() {
+      return std::atomic_load(&m_cache);
     }
 
     bool handle_event(string cmd) {
@@ -258,12 +284,29 @@ namespace modules {
     }
 
    protected:
+    /**
+     * Build the output and publish it if it changed
+     *
+     * Timers and reactor handlers may broadcast concurrently, so building
+     * into the shared builder and replacing the snapshot is serialized
+     */
     void broadcast() {
       if (!running()) {
         return;
       }
 
-      m_cache = CAST_MOD(Impl)->get_output();
+      {
+        std::lock_guard<std::mutex> guard(m_broadcastlock);
+
+        auto output = CAST_MOD(Impl)->get_output();
+
+        // Nothing to redraw if the output is identical to the published one
+        if (output == *contents())
+          return;
+
+        shared_ptr<const display_list> snapshot{make_shared<display_list>(move(output))};
+        std::atomic_store(&m_cache, move(snapshot));
+      }
 
       if (m_update_callback)
         m_update_callback();
@@ -283,14 +326,47 @@ namespace modules {
       m_sleephandler.notify_all();
     }
 
+    /**
+     * Keep track of a timer created after the module was started, so
+     * that it gets cancelled together with the others on stop
+     */
+    void add_timer(scheduler::timer_id id) {
+      std::unique_lock<std::mutex> guard(m_sourcelock);
+      if (running()) {
+        m_timers.emplace_back(id);
+      } else {
+        guard.unlock();
+        m_scheduler.cancel(id);
+      }
+    }
+
+    /**
+     * Call handler from the reactor thread whenever the descriptor is ready
+     *
+     * @return Handler id, or 0 if the module has been stopped
+     */
+    reactor::handler_id watch_fd(int fd, uint32_t events, reactor::handler_t&& handler) {
+      std::lock_guard<std::mutex> guard(m_sourcelock);
+      if (!running())
+        return 0;
+      m_handlers.emplace_back(m_reactor.add(fd, events, forward<reactor::handler_t>(handler)));
+      return m_handlers.back();
+    }
+
+    void unwatch_fd(reactor::handler_id id) {
+      m_reactor.remove(id);
+      std::lock_guard<std::mutex> guard(m_sourcelock);
+      m_handlers.erase(std::remove(m_handlers.begin(), m_handlers.end(), id), m_handlers.end());
+    }
+
     string get_format() const {
       return DEFAULT_FORMAT;
     }
 
-    string get_output() {
+    display_list get_output() {
       if (!running()) {
         m_log.trace("%s: Module is disabled", name());
-        return "";
+        return {};
       }
 
       auto format_name = CONST_MOD(Impl).get_format();
@@ -323,7 +399,7 @@ namespace modules {
     callback<> m_update_callback;
     callback<> m_stop_callback;
 
-    threading_util::spin_lock m_lock;
+    threading_util::futex_lock m_lock;
 
     const bar_settings m_bar;
     const logger& m_log;
@@ -332,6 +408,14 @@ namespace modules {
     std::mutex m_sleeplock;
     std::condition_variable m_sleephandler;
 
+    scheduler& m_scheduler{configure_scheduler().create<scheduler&>()};
+    vector<scheduler::timer_id> m_timers;
+
+    reactor& m_reactor{configure_reactor().create<reactor&>()};
+    vector<reactor::handler_id> m_handlers;
+    std::mutex m_sourcelock;
+    std::mutex m_broadcastlock;
+
     string m_name;
     unique_ptr<builder> m_builder;
     unique_ptr<module_formatter> m_formatter;
@@ -340,7 +424,7 @@ namespace modules {
 
    private:
     stateflag m_enabled{true};
-    string m_cache;
+    shared_ptr<const display_list> m_cache{make_shared<display_list>()};
   };
 
   // }}}
@@ -372,21 +456,25 @@ namespace modules {
     using module<Impl>::module;
 
     void start() {
-      CAST_MOD(Impl)->m_mainthread = thread(&timer_module::runner, this);
+      auto interval = chrono::duration_cast<scheduler::clock::duration>(m_interval);
+      this->m_timers.emplace_back(this->m_scheduler.every(interval, [this] { runner(); }));
     }
 
    protected:
     interval_t m_interval = 1s;
 
+    /**
+     * Run by the shared scheduler once per interval
+     */
     void runner() {
       try {
-        while (CONST_MOD(Impl).running()) {
-          std::lock_guard<threading_util::spin_lock> guard(this->m_lock);
-          {
-            if (CAST_MOD(Impl)->update())
-              CAST_MOD(Impl)->broadcast();
-          }
-          CAST_MOD(Impl)->sleep(m_interval);
+        if (!CONST_MOD(Impl).running())
+          return;
+
+        std::lock_guard<threading_util::futex_lock> guard(this->m_lock);
+        {
+          if (CAST_MOD(Impl)->update())
+            CAST_MOD(Impl)->broadcast();
         }
       } catch (const module_error& err) {
         CAST_MOD(Impl)->halt(err.what());
@@ -405,25 +493,80 @@ namespace modules {
     using module<Impl>::module;
 
     void start() {
+      this->m_timers.emplace_back(this->m_scheduler.once(0s, [this] { activate(); }));
+    }
+
+    /**
+     * Attach the module to the descriptors it waits for
+     *
+     * Modules that don't override this poll for events in a dedicated thread
+     */
+    void attach() {
       CAST_MOD(Impl)->m_mainthread = thread(&event_module::runner, this);
     }
 
    protected:
-    void runner() {
+    /**
+     * Send the initial broadcast to warmup the cache and attach the module
+     */
+    void activate() {
       try {
-        // Send initial broadcast to warmup cache
-        if (CONST_MOD(Impl).running()) {
+        if (!CONST_MOD(Impl).running())
+          return;
+
+        std::lock_guard<threading_util::futex_lock> guard(this->m_lock);
+        {
           CAST_MOD(Impl)->update();
           CAST_MOD(Impl)->broadcast();
+
+          if (CONST_MOD(Impl).running())
+            CAST_MOD(Impl)->attach();
         }
+      } catch (const module_error& err) {
+        CAST_MOD(Impl)->halt(err.what());
+      } catch (const std::exception& err) {
+        CAST_MOD(Impl)->halt(err.what());
+      }
+    }
+
+    /**
+     * Called when a watched descriptor is ready, from the reactor thread
+     * or from a module timer on the scheduler
+     *
+     * The output is built while holding the lock, so that the labels
+     * can't be modified by another update in the meantime
+     */
+    void on_ready(uint32_t) {
+      try {
+        if (!CONST_MOD(Impl).running())
+          return;
+
+        std::lock_guard<threading_util::futex_lock> guard(this->m_lock);
+
+        if (!CAST_MOD(Impl)->has_event())
+          return;
+        if (!CONST_MOD(Impl).running())
+          return;
+        if (!CAST_MOD(Impl)->update())
+          return;
+
+        CAST_MOD(Impl)->broadcast();
+      } catch (const module_error& err) {
+        CAST_MOD(Impl)->halt(err.what());
+      } catch (const std::exception& err) {
+        CAST_MOD(Impl)->halt(err.what());
+      }
+    }
 
+    void runner() {
+      try {
         while (CONST_MOD(Impl).running()) {
           CAST_MOD(Impl)->idle();
 
           if (!CONST_MOD(Impl).running())
             break;
 
-          std::lock_guard<threading_util::spin_lock> guard(this->m_lock);
+          std::lock_guard<threading_util::futex_lock> guard(this->m_lock);
           {
             if (!CAST_MOD(Impl)->has_event())
               continue;
@@ -453,88 +596,170 @@ namespace modules {
     using module<Impl>::module;
 
     void start() {
-      CAST_MOD(Impl)->m_mainthread = thread(&inotify_module::runner, this);
+      this->m_timers.emplace_back(this->m_scheduler.once(0s, [this] { activate(); }));
+    }
+
+    /**
+     * Remove the watches once the module is disabled, as
+     * removing them waits for the callbacks that take the lock
+     */
+    void stop() {
+      module<Impl>::stop();
+
+      vector<inotify_dispatcher::watch_id> watches;
+      {
+        std::lock_guard<std::mutex> guard(this->m_sourcelock);
+        watches.swap(m_watches);
+      }
+      for (auto&& id : watches) {
+        m_inotify.remove(id);
+      }
     }
 
    protected:
-    void runner() {
+    /**
+     * Send the initial broadcast to warmup the cache and attach the watches
+     */
+    void activate() {
+      if (refresh())
+        attach_watches(false);
+    }
+
+    /**
+     * Update and broadcast the output without an event
+     *
+     * @return False if the module got halted
+     */
+    bool refresh() {
       try {
-        // Send initial broadcast to warmup cache
+        std::lock_guard<threading_util::futex_lock> guard(this->m_lock);
+
         if (CONST_MOD(Impl).running()) {
           CAST_MOD(Impl)->on_event(nullptr);
           CAST_MOD(Impl)->broadcast();
         }
 
-        while (CONST_MOD(Impl).running()) {
-          CAST_MOD(Impl)->poll_events();
-        }
+        return true;
       } catch (const module_error& err) {
         CAST_MOD(Impl)->halt(err.what());
       } catch (const std::exception& err) {
         CAST_MOD(Impl)->halt(err.what());
       }
+
+      return false;
     }
 
-    void watch(string path, int mask = IN_ALL_EVENTS) {
+    /**
+     * Watch path once the module is started
+     *
+     * The watches stay attached while the module reads the files, so
+     * the default mask leaves out the access events it would cause
+     */
+    void watch(string path, int mask = IN_MODIFY) {
       this->m_log.trace("%s: Attach inotify at %s", CONST_MOD(Impl).name(), path);
       m_watchlist.insert(make_pair(path, mask));
     }
 
-    void idle() {
-      CAST_MOD(Impl)->sleep(200ms);
-    }
+    /**
+     * Attach the watches to the shared inotify instance,
+     * retrying later if any of the paths can't be watched yet
+     *
+     * @param reattached Refresh the output once attached, as
+     *                   the files may have changed while unwatched
+     */
+    void attach_watches(bool reattached) {
+      if (!CONST_MOD(Impl).running())
+        return;
 
-    void poll_events() {
-      vector<inotify_util::watch_t> watches;
+      vector<inotify_dispatcher::watch_id> watches;
 
       try {
         for (auto&& w : m_watchlist) {
-          watches.emplace_back(inotify_util::make_watch(w.first));
-          watches.back()->attach(w.second);
+          watches.emplace_back(m_inotify.add(
+              w.first, w.second, [this](const inotify_event& event) { on_ready(event); }));
         }
       } catch (const system_error& e) {
-        watches.clear();
+        for (auto&& id : watches) {
+          m_inotify.remove(id);
+        }
         this->m_log.err(
             "%s: Error while creating inotify watch (what: %s)", CONST_MOD(Impl).name(), e.what());
-        CAST_MOD(Impl)->sleep(0.1s);
+        this->add_timer(this->m_scheduler.once(1s, [=] { attach_watches(reattached); }));
         return;
       }
 
-      while (CONST_MOD(Impl).running()) {
-        std::unique_lock<threading_util::spin_lock> guard(this->m_lock);
-        {
-          for (auto&& w : watches) {
-            this->m_log.trace_x("%s: Poll inotify watch %s", CONST_MOD(Impl).name(), w->path());
+      std::unique_lock<std::mutex> guard(this->m_sourcelock);
 
-            if (w->poll(1000 / watches.size())) {
-              auto event = w->get_event();
+      if (!CONST_MOD(Impl).running()) {
+        guard.unlock();
 
-              for (auto&& w : watches) {
-                try {
-                  w->remove();
-                } catch (const system_error&) {
-                }
-              }
+        for (auto&& id : watches) {
+          m_inotify.remove(id);
+        }
+        return;
+      }
 
-              if (CAST_MOD(Impl)->on_event(event.get()))
-                CAST_MOD(Impl)->broadcast();
+      m_watches = move(watches);
+      guard.unlock();
 
-              CAST_MOD(Impl)->idle();
+      if (reattached)
+        refresh();
+    }
 
-              return;
-            }
+    /**
+     * Scheduler task: replace the watches after the kernel removed one
+     * of them, i.e. because the watched file got deleted and recreated
+     */
+    void reattach_watches() {
+      m_reattach = false;
 
-            if (!CONST_MOD(Impl).running())
-              break;
-          }
-        }
-        guard.unlock();
-        CAST_MOD(Impl)->idle();
+      vector<inotify_dispatcher::watch_id> watches;
+      {
+        std::lock_guard<std::mutex> guard(this->m_sourcelock);
+        watches.swap(m_watches);
+      }
+      for (auto&& id : watches) {
+        m_inotify.remove(id);
+      }
+
+      attach_watches(true);
+    }
+
+    /**
+     * Called from the reactor thread with the events of a watch,
+     * merged per batch read from the inotify instance
+     */
+    void on_ready(const inotify_event& event) {
+      // The file may be gone, so the output is refreshed once it can be watched
+      // again. The watches are replaced outside of the callbacks taking the lock
+      if (event.mask & IN_IGNORED) {
+        if (!m_reattach.exchange(true))
+          this->add_timer(this->m_scheduler.once(0s, [this] { reattach_watches(); }));
+        return;
+      }
+
+      try {
+        std::lock_guard<threading_util::futex_lock> guard(this->m_lock);
+
+        if (!CONST_MOD(Impl).running())
+          return;
+
+        auto event_ = event;
+
+        if (CAST_MOD(Impl)->on_event(&event_))
+          CAST_MOD(Impl)->broadcast();
+      } catch (const module_error& err) {
+        CAST_MOD(Impl)->halt(err.what());
+      } catch (const std::exception& err) {
+        CAST_MOD(Impl)->halt(err.what());
       }
     }
 
    private:
+    inotify_dispatcher& m_inotify{configure_inotify_dispatcher().create<inotify_dispatcher&>()};
     map<string, int> m_watchlist;
+    vector<inotify_dispatcher::watch_id> m_watches;
+    std::atomic_bool m_reattach{false};
   };
 
   // }}}
@@ -21,7 +21,7 @@ namespace modules {
     void setup();
     void teardown();
     inline bool connected() const;
-    void idle();
+    void attach();
     bool has_event();
     bool update();
     string get_format() const;
@@ -29,6 +29,10 @@ namespace modules {
     bool handle_event(string cmd);
     bool receive_events() const;
 
+   protected:
+    void on_wakeup(uint32_t events);
+    void rewatch();
+
    private:
     // static const int PROGRESSBAR_THREAD_SYNC_COUNT = 10;
     // const chrono::duration<double> PROGRESSBAR_THREAD_INTERVAL = 1s;
@@ -70,6 +74,7 @@ namespace modules {
 
     unique_ptr<mpdconnection> m_mpd;
     unique_ptr<mpdstatus> m_status;
+    reactor::handler_id m_handler{0};
 
     string m_host = "127.0.0.1";
     string m_pass = "";
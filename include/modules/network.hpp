@@ -1,7 +1,9 @@
 #pragma once
 
+#include "adapters/icmp.hpp"
 #include "adapters/net.hpp"
 #include "components/config.hpp"
+#include "components/rtnetlink.hpp"
 #include "drawtypes/animation.hpp"
 #include "drawtypes/animation.hpp"
 #include "drawtypes/label.hpp"
@@ -18,13 +20,17 @@ namespace modules {
     using timer_module::timer_module;
 
     void setup();
+    void start();
+    void stop();
     void teardown();
-    bool update();
+    bool update(bool accumulate = true);
     string get_format() const;
     bool build(builder* builder, string tag) const;
 
    protected:
-    void subthread_routine();
+    void animate();
+    void on_link_change();
+    void on_probe(const net::probe_stats& stats);
 
    private:
     static constexpr auto FORMAT_CONNECTED = "format-connected";
@@ -37,8 +43,13 @@ namespace modules {
     static constexpr auto TAG_LABEL_PACKETLOSS = "<label-packetloss>";
     static constexpr auto TAG_ANIMATION_PACKETLOSS = "<animation-packetloss>";
 
+    rtnetlink& m_netlink{configure_rtnetlink().create<rtnetlink&>()};
+    rtnetlink::watch_id m_watch{0};
+
     net::wired_t m_wired;
     net::wireless_t m_wireless;
+    unique_ptr<net::icmp_prober> m_prober;
+    net::probe_stats m_probe;
 
     ramp_t m_ramp_signal;
     ramp_t m_ramp_quality;
@@ -50,10 +61,10 @@ namespace modules {
 
     int m_signal = 0;
     int m_quality = 0;
-    int m_counter = -1;  // -1 to ignore the first run
 
     string m_interface;
     int m_ping_nth_update = 0;
+    int m_ping_window = 10;
     int m_udspeed_minwidth = 3;
   };
 }
@@ -1,7 +1,8 @@
 #pragma once
 
+#include "components/executor.hpp"
+#include "components/script_runner.hpp"
 #include "modules/meta.hpp"
-#include "utils/command.hpp"
 
 LEMONBUDDY_NS
 
@@ -16,19 +17,31 @@ namespace modules {
 
     void setup();
     void stop();
-    void idle();
-    bool has_event();
+    void attach();
     bool update();
-    string get_output();
+    display_list get_output();
     bool build(builder* builder, string tag) const;
 
    protected:
+    scheduler::clock::duration interval() const;
+    void run();
+    void trigger();
+    void tick();
+    void rerun();
+    void on_line(string line);
+    void on_exit(const supervisor::child_status& result);
+    void on_result(const string& output, int counter);
+
     static constexpr auto TAG_OUTPUT = "<output>";
 
-    command_util::command_t m_command;
+    executor& m_executor{configure_executor().create<executor&>()};
+    executor::job_id m_job{0};
+    script_runner& m_runner{configure_script_runner().create<script_runner&>()};
+    script_runner::subscription_id m_subscription{0};
 
     string m_exec;
     bool m_tail = false;
+    bool m_coprocess = false;
     interval_t m_interval = 0s;
     size_t m_maxlen = 0;
     bool m_ellipsis = true;
@@ -22,11 +22,12 @@ namespace modules {
     using event_module::event_module;
 
     void setup();
-    void teardown();
+    void stop();
+    void attach();
     bool has_event();
     bool update();
     string get_format() const;
-    string get_output();
+    display_list get_output();
     bool build(builder* builder, string tag) const;
     bool handle_event(string cmd);
     bool receive_events() const;
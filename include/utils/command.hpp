@@ -1,7 +1,10 @@
 #pragma once
 
 #include "common.hpp"
+#include <deque>
+
 #include "components/logger.hpp"
+#include "utils/io.hpp"
 #include "utils/threading.hpp"
 
 LEMONBUDDY_NS
@@ -40,7 +43,7 @@ namespace command_util {
    */
   class command {
    public:
-    explicit command(const logger& logger, string cmd);
+    explicit command(const logger& logger, string cmd, bool direct = false);
 
     ~command();
 
@@ -62,6 +65,7 @@ namespace command_util {
     const logger& m_log;
 
     string m_cmd;
+    bool m_direct;
 
     int m_stdout[2];
     int m_stdin[2];
@@ -69,6 +73,8 @@ namespace command_util {
     pid_t m_forkpid;
     int m_forkstatus;
 
+    io_util::line_reader m_reader;
+    std::deque<string> m_lines;
     threading_util::spin_lock m_pipelock;
   };
 
@@ -27,11 +27,44 @@ namespace file_util {
     string m_mode;
   };
 
+  /**
+   * Reader for small files that are read over and over, i.e. on procfs or sysfs
+   *
+   * The file is kept open and read with pread() into a buffer that is
+   * reused between reads, so reading the file doesn't allocate once the
+   * buffer has grown large enough to hold it
+   */
+  class file_reader {
+   public:
+    explicit file_reader(string path, size_t capacity = 256);
+    ~file_reader();
+
+    file_reader(const file_reader&) = delete;
+    file_reader& operator=(const file_reader&) = delete;
+
+    bool read();
+
+    const char* begin() const;
+    const char* end() const;
+    size_t size() const;
+    const string& path() const;
+
+   protected:
+    void close();
+
+   private:
+    string m_path;
+    int m_fd{-1};
+    vector<char> m_buffer;
+    size_t m_size{0};
+  };
+
   bool exists(string filename);
   string get_contents(string filename);
   void set_block(int fd);
   void set_nonblock(int fd);
   bool is_fifo(string filename);
+  const char* parse_uint(const char* pos, const char* end, unsigned long long& value);
 }
 
 LEMONBUDDY_NS_END
@@ -19,6 +19,11 @@ struct inotify_event {
 namespace inotify_util {
   using event_t = inotify_event;
 
+  /**
+   * Size of a buffer that fits at least one event for any file name
+   */
+  constexpr size_t EVENT_BUFFER_SIZE{4096};
+
   class inotify_watch {
    public:
     explicit inotify_watch(string path) : m_path(path) {}
@@ -29,6 +34,7 @@ namespace inotify_util {
     bool poll(int wait_ms = 1000);
     unique_ptr<event_t> get_event();
     const string path() const;
+    int get_file_descriptor() const;
 
    protected:
     string m_path;
@@ -39,6 +45,8 @@ namespace inotify_util {
   using watch_t = unique_ptr<inotify_watch>;
 
   watch_t make_watch(string path);
+
+  void for_each_event(const char* buffer, size_t len, const callback<const ::inotify_event*>& cb);
 }
 
 LEMONBUDDY_NS_END
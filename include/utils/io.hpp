@@ -21,6 +21,49 @@ namespace io_util {
   bool poll_write(int fd, int timeout_ms = 1);
 
   void interrupt_read(int write_fd);
+
+  /**
+   * Buffered line reader
+   *
+   * Reads as much as is available into a ring buffer using a single
+   * syscall and passes the complete lines to the callback. The line
+   * points into the buffer and is only valid during the call, lines
+   * wrapping around the end of the buffer are linearized first.
+   *
+   * Lines longer than the buffer are truncated and the remainder up
+   * to the next newline is discarded, so the memory used is bounded.
+   */
+  class line_reader {
+   public:
+    using line_cb = callback<const char*, size_t>;
+
+    explicit line_reader(size_t max_length = 64 * 1024);
+
+    bool read(int fd, const line_cb& on_line);
+    void flush(const line_cb& on_line);
+    void reset();
+
+    size_t size() const;
+    size_t truncated() const;
+
+   protected:
+    void split(const line_cb& on_line);
+    void emit(size_t length, const line_cb& on_line);
+    void consume(size_t length);
+
+   private:
+    static constexpr int MAX_READS{16};
+
+    size_t m_capacity;
+    vector<char> m_buffer;
+    string m_scratch;
+
+    size_t m_head{0};
+    size_t m_size{0};
+    size_t m_scanned{0};
+    size_t m_truncated{0};
+    bool m_discard{false};
+  };
 }
 
 LEMONBUDDY_NS_END
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <linux/netlink.h>
+#include <algorithm>
+#include <cstring>
+
+#include "common.hpp"
+
+LEMONBUDDY_NS
+
+namespace netlink_util {
+  using message_cb = callback<const nlmsghdr*>;
+  using attribute_cb = callback<const nlattr*>;
+  using property_cb = callback<const string&, const string&>;
+
+  bool request(int fd, nlmsghdr* req, vector<char>& buffer, const message_cb& on_message);
+
+  void put_attribute(nlmsghdr* msg, size_t capacity, uint16_t type, const void* data, size_t len);
+  void for_each_attribute(const void* data, size_t len, const attribute_cb& on_attribute);
+  void for_each_property(const char* data, size_t len, const property_cb& on_property);
+
+  inline uint16_t attribute_type(const nlattr* attr) {
+    return attr->nla_type & NLA_TYPE_MASK;
+  }
+
+  /**
+   * Payload of given attribute
+   */
+  inline const void* attribute_data(const nlattr* attr) {
+    return reinterpret_cast<const char*>(attr) + NLA_HDRLEN;
+  }
+
+  inline size_t attribute_length(const nlattr* attr) {
+    return attr->nla_len - NLA_HDRLEN;
+  }
+
+  /**
+   * Read an integer attribute, truncated to the size of the payload
+   */
+  template <typename T>
+  T attribute_value(const nlattr* attr) {
+    T value{0};
+    memcpy(&value, attribute_data(attr), std::min(sizeof(T), attribute_length(attr)));
+    return value;
+  }
+
+  /**
+   * Visit the attributes nested in given attribute
+   */
+  inline void for_each_nested(const nlattr* attr, const attribute_cb& on_attribute) {
+    for_each_attribute(attribute_data(attr), attribute_length(attr), on_attribute);
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -10,6 +10,9 @@ namespace process_util {
 
   void exec(string cmd);
 
+  bool needs_shell(const string& cmd);
+  pid_t spawn(const string& cmd, int in, int out, int err, bool direct = false);
+
   pid_t wait_for_completion(pid_t process_id, int* status_addr, int waitflags = 0);
   pid_t wait_for_completion(int* status_addr, int waitflags = 0);
   pid_t wait_for_completion(pid_t process_id);
@@ -21,6 +21,8 @@ namespace socket_util {
     string receive(const ssize_t receive_bytes, ssize_t& bytes_received_addr, int flags = 0);
     bool poll(short int events = POLLIN, int timeout_ms = -1);
 
+    int get_file_descriptor() const;
+
    protected:
     int m_fd = -1;
     string m_socketpath;
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <condition_variable>
 #include <mutex>
 
 #include "common.hpp"
+#include "components/logger.hpp"
 #include "utils/mixins.hpp"
 
 LEMONBUDDY_NS
@@ -57,6 +59,81 @@ namespace threading_util {
    protected:
     std::atomic_flag m_locked{false};
   };
+
+  /**
+   * Mutex that sleeps on a futex when it can't be acquired after a
+   * short amount of spinning, suitable for locks that are held while
+   * doing expensive work
+   *
+   * The amount of contended lock calls and the amount of times a
+   * caller had to sleep are counted
+   */
+  class futex_lock : public non_copyable_mixin<futex_lock> {
+   public:
+    futex_lock() = default;
+
+    void lock() noexcept;
+    bool try_lock() noexcept;
+    void unlock() noexcept;
+
+    size_t contentions() const;
+    size_t sleeps() const;
+
+   protected:
+    static constexpr int SPIN_LIMIT{100};
+
+    // 0: unlocked, 1: locked, 2: locked with possible waiters
+    std::atomic<int> m_state{0};
+
+    std::atomic<size_t> m_contentions{0};
+    std::atomic<size_t> m_sleeps{0};
+  };
+
+  /**
+   * Keeps track of the callbacks that an object calls without holding
+   * its lock, so that removing a callback can wait for its calls in
+   * progress on other threads
+   *
+   * A call gets marked with enter() while holding the lock of the object,
+   * together with looking up the callback, and is then made using call()
+   * once the lock is released
+   */
+  class callback_tracker : public non_copyable_mixin<callback_tracker> {
+   public:
+    using id_type = size_t;
+
+    explicit callback_tracker(const logger& logger, string owner);
+
+    void enter(id_type id);
+    void wait(std::unique_lock<std::mutex>& guard, id_type id);
+
+    /**
+     * Make the call marked with enter() and log the exceptions it throws
+     *
+     * Takes the lock of the object once the call has returned
+     */
+    template <typename Function>
+    void call(std::mutex& mutex, id_type id, const Function& function) {
+      try {
+        function();
+      } catch (const std::exception& err) {
+        m_log.err("%s: Uncaught exception in callback (%s)", m_owner, err.what());
+      }
+
+      std::lock_guard<std::mutex> guard(mutex);
+      leave(id);
+    }
+
+   protected:
+    void leave(id_type id);
+
+   private:
+    const logger& m_log;
+    string m_owner;
+
+    std::condition_variable m_left;
+    vector<pair<id_type, thread::id>> m_calls;
+  };
 }
 
 LEMONBUDDY_NS_END
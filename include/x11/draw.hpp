@@ -11,6 +11,8 @@ namespace draw_util {
 
   xcb_void_cookie_t xcb_poly_text_16_patched(xcb_connection_t* conn, xcb_drawable_t d,
       xcb_gcontext_t gc, int16_t x, int16_t y, uint8_t len, uint16_t* str);
+  xcb_void_cookie_t xcb_poly_text_16_patched(xcb_connection_t* conn, xcb_drawable_t d,
+      xcb_gcontext_t gc, int16_t x, int16_t y, const vector<uint16_t>& str);
 }
 
 LEMONBUDDY_NS_END
@@ -14,11 +14,10 @@
 LEMONBUDDY_NS
 
 #define XFT_MAXCHARS (1 << 16)
-extern array<char, XFT_MAXCHARS> xft_widths;
-extern array<wchar_t, XFT_MAXCHARS> xft_chars;
 
 struct fonttype {
   fonttype() {}
+  string name;
   XftFont* xft;
   xcb_font_t ptr;
   int offset_y = 0;
@@ -29,6 +28,16 @@ struct fonttype {
   uint16_t char_max = 0;
   uint16_t char_min = 0;
   vector<xcb_charinfo_t> width_lut;
+
+  /**
+   * Glyph coverage bitmap, built when the font is loaded
+   */
+  vector<bool> coverage;
+
+  /**
+   * Advance width per character, filled lazily for Xft fonts (-1 = not measured)
+   */
+  vector<int16_t> widths;
 };
 
 struct fonttype_deleter {
@@ -57,15 +66,19 @@ class fontmanager {
 
   XftColor xftcolor();
 
-  void allocate_color(XRenderColor color, bool initial_alloc = false);
+  void allocate_color(XRenderColor color);
 
   void set_gcontext_font(gcontext& gc, xcb_font_t font);
 
  protected:
   bool open_xcb_font(font_t& fontptr, string fontname);
 
+  void build_coverage(font_t& font);
+
   bool has_glyph(font_t& font, uint16_t chr);
 
+  int resolve_char(uint16_t chr);
+
  private:
   connection& m_connection;
   const logger& m_logger;
@@ -76,7 +89,13 @@ class fontmanager {
 
   map<int, font_t> m_fonts;
   int m_fontindex = -1;
+
+  /**
+   * Memoized char -> font index lookups, keyed by the preferred font index
+   */
+  map<int, vector<int8_t>> m_fallback;
   XftColor m_xftcolor;
+  bool m_xftallocated{false};
 };
 
 namespace {
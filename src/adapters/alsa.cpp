@@ -1,211 +1,413 @@
+#include <algorithm>
+
 #include "adapters/alsa.hpp"
 
 LEMONBUDDY_NS
 
-// class : alsa_ctl_interface {{{
+// class : alsa_card {{{
 
-alsa_ctl_interface::alsa_ctl_interface(int numid) : m_numid(numid) {
+/**
+ * Load the mixer of given card and wait for its events in the reactor
+ */
+alsa_card::alsa_card(const logger& logger, reactor& reactor, string name)
+    : m_log(logger), m_reactor(reactor), m_name(move(name)) {
   int err = 0;
 
-  snd_ctl_elem_info_alloca(&m_info);
-  snd_ctl_elem_value_alloca(&m_value);
-  snd_ctl_elem_id_alloca(&m_id);
+  if ((err = snd_mixer_open(&m_mixer, 0)) < 0)
+    throw_exception<alsa_mixer_error>("Failed to open hardware mixer", err);
 
-  snd_ctl_elem_id_set_numid(m_id, m_numid);
-  snd_ctl_elem_info_set_id(m_info, m_id);
+  if ((err = snd_mixer_attach(m_mixer, m_name.c_str())) < 0 ||
+      (err = snd_mixer_selem_register(m_mixer, nullptr, nullptr)) < 0 ||
+      (err = snd_mixer_load(m_mixer)) < 0) {
+    snd_mixer_close(m_mixer);
+    throw_exception<alsa_mixer_error>("Failed to load mixer of card '" + m_name + "'", err);
+  }
 
-  if ((err = snd_ctl_open(&m_ctl, ALSA_SOUNDCARD, SND_CTL_NONBLOCK | SND_CTL_READONLY)) < 0)
-    throw_exception<alsa_ctl_interface_error>(
-        "Could not open control '" + string{ALSA_SOUNDCARD} + "'", err);
+  for (auto elem = snd_mixer_first_elem(m_mixer); elem; elem = snd_mixer_elem_next(elem)) {
+    snd_mixer_elem_set_callback(elem, &alsa_card::on_element);
+    snd_mixer_elem_set_callback_private(elem, this);
+  }
 
-  if ((err = snd_ctl_elem_info(m_ctl, m_info)) < 0)
-    throw_exception<alsa_ctl_interface_error>("Could not get control datal", err);
+  vector<pollfd> fds(snd_mixer_poll_descriptors_count(m_mixer));
 
-  snd_ctl_elem_info_get_id(m_info, m_id);
+  if ((err = snd_mixer_poll_descriptors(m_mixer, fds.data(), fds.size())) < 0) {
+    snd_mixer_close(m_mixer);
+    throw_exception<alsa_mixer_error>("Failed to get poll descriptors", err);
+  }
 
-  if ((err = snd_hctl_open(&m_hctl, ALSA_SOUNDCARD, 0)) < 0)
-    throw_exception<alsa_ctl_interface_error>("Failed to open hctl", err);
-  if ((err = snd_hctl_load(m_hctl)) < 0)
-    throw_exception<alsa_ctl_interface_error>("Failed to load hctl", err);
-  if ((m_elem = snd_hctl_find_elem(m_hctl, m_id)) == nullptr)
-    throw alsa_ctl_interface_error(
-        "Could not find control with id " + to_string(snd_ctl_elem_id_get_numid(m_id)));
+  fds.resize(err);
+  add_descriptors(fds);
+}
 
-  if ((err = snd_ctl_subscribe_events(m_ctl, 1)) < 0)
-    throw alsa_ctl_interface_error(
-        "Could not subscribe to events: " + to_string(snd_ctl_elem_id_get_numid(m_id)));
+/**
+ * Stop waiting for events and close the handles
+ */
+alsa_card::~alsa_card() {
+  for (auto&& handler : m_handlers) {
+    m_reactor.remove(handler);
+  }
+  if (m_ctl != nullptr)
+    snd_ctl_close(m_ctl);
+  snd_mixer_close(m_mixer);
 }
 
-alsa_ctl_interface::~alsa_ctl_interface() {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
-  snd_ctl_close(m_ctl);
-  snd_hctl_close(m_hctl);
+/**
+ * Call given callback from the reactor thread whenever
+ * the simple mixer element with given name changes
+ */
+alsa_card::watch_id alsa_card::watch(string element, callback<>&& on_change) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto id = m_nextid++;
+  m_watchers.emplace(id, watcher{move(element), 0, forward<callback<>>(on_change)});
+  return id;
 }
 
-int alsa_ctl_interface::get_numid() {
-  return m_numid;
+/**
+ * Call given callback from the reactor thread whenever
+ * the value of the control element with given id changes
+ */
+alsa_card::watch_id alsa_card::watch(int numid, callback<>&& on_change) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  control();
+  auto id = m_nextid++;
+  m_watchers.emplace(id, watcher{"", numid, forward<callback<>>(on_change)});
+  return id;
 }
 
-bool alsa_ctl_interface::wait(int timeout) {
-  assert(m_ctl);
+/**
+ * Remove watcher
+ *
+ * Once this returns the callback of the watcher won't be called anymore,
+ * so it must not be called while holding a lock the callback takes
+ */
+void alsa_card::unwatch(watch_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
 
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
+  if (m_watchers.erase(id) == 0)
+    return;
 
-  int err = 0;
+  m_callbacks.wait(guard, id);
+}
 
-  if ((err = snd_ctl_wait(m_ctl, timeout)) < 0)
-    throw_exception<alsa_ctl_interface_error>("Failed to wait for events", err);
+/**
+ * Mixer element callback: remember which element changed
+ *
+ * Called by snd_mixer_handle_events, with the lock held
+ */
+int alsa_card::on_element(snd_mixer_elem_t* elem, unsigned int) {
+  auto card = static_cast<alsa_card*>(snd_mixer_elem_get_callback_private(elem));
+  card->m_changed.emplace_back(snd_mixer_selem_get_name(elem));
+  return 0;
+}
 
-  snd_ctl_event_t* event;
-  snd_ctl_event_alloca(&event);
+/**
+ * Find simple element by name
+ *
+ * Requires the lock to be held
+ */
+snd_mixer_elem_t* alsa_card::find_element(const string& name) const {
+  snd_mixer_selem_id_t* id;
+  snd_mixer_selem_id_alloca(&id);
+  snd_mixer_selem_id_set_index(id, 0);
+  snd_mixer_selem_id_set_name(id, name.c_str());
+  return snd_mixer_find_selem(m_mixer, id);
+}
 
-  if ((err = snd_ctl_read(m_ctl, event)) < 0)
-    return false;
-  if (snd_ctl_event_get_type(event) != SND_CTL_EVENT_ELEM)
-    return false;
+/**
+ * Get the control handle, opening it on first use
+ *
+ * Requires the lock to be held
+ */
+snd_ctl_t* alsa_card::control() {
+  if (m_ctl != nullptr)
+    return m_ctl;
 
-  auto mask = snd_ctl_event_elem_get_mask(event);
+  int err = 0;
 
-  return mask & SND_CTL_EVENT_MASK_VALUE;
-}
+  if ((err = snd_ctl_open(&m_ctl, m_name.c_str(), SND_CTL_NONBLOCK | SND_CTL_READONLY)) < 0)
+    throw_exception<alsa_ctl_interface_error>("Could not open control '" + m_name + "'", err);
 
-bool alsa_ctl_interface::test_device_plugged() {
-  assert(m_elem);
-  assert(m_value);
+  vector<pollfd> fds(snd_ctl_poll_descriptors_count(m_ctl));
 
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
+  if ((err = snd_ctl_subscribe_events(m_ctl, 1)) < 0 ||
+      (err = snd_ctl_poll_descriptors(m_ctl, fds.data(), fds.size())) < 0) {
+    snd_ctl_close(m_ctl);
+    m_ctl = nullptr;
+    throw_exception<alsa_ctl_interface_error>("Could not subscribe to control events", err);
+  }
 
-  int err = 0;
-  if ((err = snd_hctl_elem_read(m_elem, m_value)) < 0)
-    throw_exception<alsa_ctl_interface_error>("Could not read control value", err);
-  return snd_ctl_elem_value_get_boolean(m_value, 0);
+  fds.resize(err);
+  add_descriptors(fds);
+
+  return m_ctl;
 }
 
-void alsa_ctl_interface::process_events() {
-  wait(0);
+void alsa_card::add_descriptors(const vector<pollfd>& fds) {
+  for (auto&& fd : fds) {
+    m_handlers.emplace_back(m_reactor.add(fd.fd, fd.events, [this](uint32_t) { on_events(); }));
+  }
 }
 
-// }}}
-// class : alsa_mixer {{{
+/**
+ * Reactor callback: handle the pending mixer and control events
+ * and notify the watchers of the elements that changed
+ */
+void alsa_card::on_events() {
+  vector<pair<watch_id, callback<>>> watchers;
 
-alsa_mixer::alsa_mixer(string mixer_control_name) : m_name(mixer_control_name) {
-  snd_mixer_selem_id_t* mixer_id;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
 
-  snd_mixer_selem_id_alloca(&mixer_id);
+    vector<int> numids;
 
-  int err = 0;
+    m_changed.clear();
 
-  if ((err = snd_mixer_open(&m_hardwaremixer, 1)) < 0)
-    throw_exception<alsa_mixer_error>("Failed to open hardware mixer", err);
-  if ((err = snd_mixer_attach(m_hardwaremixer, ALSA_SOUNDCARD)) < 0)
-    throw_exception<alsa_mixer_error>("Failed to attach hardware mixer control", err);
-  if ((err = snd_mixer_selem_register(m_hardwaremixer, nullptr, nullptr)) < 0)
-    throw_exception<alsa_mixer_error>("Failed to register simple mixer element", err);
-  if ((err = snd_mixer_load(m_hardwaremixer)) < 0)
-    throw_exception<alsa_mixer_error>("Failed to load mixer", err);
+    int err = 0;
+
+    if ((err = snd_mixer_handle_events(m_mixer)) < 0)
+      m_log.err("alsa_card: Failed to process mixer events (%s)", snd_strerror(err));
 
-  snd_mixer_selem_id_set_index(mixer_id, 0);
-  snd_mixer_selem_id_set_name(mixer_id, mixer_control_name.c_str());
+    if (m_ctl != nullptr) {
+      snd_ctl_event_t* event;
+      snd_ctl_event_alloca(&event);
 
-  if ((m_mixerelement = snd_mixer_find_selem(m_hardwaremixer, mixer_id)) == nullptr)
-    throw alsa_mixer_error("Cannot find simple element");
+      while (snd_ctl_read(m_ctl, event) > 0) {
+        if (snd_ctl_event_get_type(event) != SND_CTL_EVENT_ELEM)
+          continue;
+        if (snd_ctl_event_elem_get_mask(event) & SND_CTL_EVENT_MASK_VALUE)
+          numids.emplace_back(snd_ctl_event_elem_get_numid(event));
+      }
+    }
+
+    for (auto&& w : m_watchers) {
+      if (!w.second.on_change)
+        continue;
+      if (w.second.numid == 0 &&
+          find(m_changed.begin(), m_changed.end(), w.second.element) == m_changed.end())
+        continue;
+      if (w.second.numid != 0 &&
+          find(numids.begin(), numids.end(), w.second.numid) == numids.end())
+        continue;
+      watchers.emplace_back(w.first, w.second.on_change);
+      m_callbacks.enter(w.first);
+    }
+  }
+
+  if (watchers.empty())
+    return;
 
-  // log_trace("Successfully initialized mixer: "+ mixer_control_name);
+  for (auto&& w : watchers) {
+    m_callbacks.call(m_mutex, w.first, [&] { w.second(); });
+  }
 }
 
-alsa_mixer::~alsa_mixer() {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
-  snd_mixer_elem_remove(m_mixerelement);
-  snd_mixer_detach(m_hardwaremixer, ALSA_SOUNDCARD);
-  snd_mixer_close(m_hardwaremixer);
+// }}}
+// class : alsa_ctl_interface {{{
+
+alsa_ctl_interface::alsa_ctl_interface(alsa_card& card, int numid)
+    : m_card(card), m_numid(numid) {
+  int err = 0;
+  snd_ctl_elem_info_t* info;
+
+  snd_ctl_elem_info_alloca(&info);
+  snd_ctl_elem_info_set_numid(info, m_numid);
+
+  if ((err = snd_ctl_elem_value_malloc(&m_value)) < 0)
+    throw_exception<alsa_ctl_interface_error>("Could not allocate control value", err);
+
+  snd_ctl_elem_value_set_numid(m_value, m_numid);
+
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
+
+  try {
+    if ((err = snd_ctl_elem_info(m_card.control(), info)) < 0)
+      throw_exception<alsa_ctl_interface_error>(
+          "Could not find control with id " + to_string(m_numid), err);
+  } catch (const alsa_exception&) {
+    snd_ctl_elem_value_free(m_value);
+    throw;
+  }
 }
 
-string alsa_mixer::get_name() {
-  return m_name;
+alsa_ctl_interface::~alsa_ctl_interface() {
+  unwatch();
+  snd_ctl_elem_value_free(m_value);
 }
 
-bool alsa_mixer::wait(int timeout) {
-  assert(m_hardwaremixer);
+int alsa_ctl_interface::get_numid() {
+  return m_numid;
+}
 
-  std::unique_lock<threading_util::spin_lock> guard(m_lock);
+/**
+ * Call given callback from the reactor thread whenever the value changes
+ */
+void alsa_ctl_interface::watch(callback<>&& on_change) {
+  auto cb = forward<callback<>>(on_change);
+  m_watch = m_card.watch(m_numid, [this, cb] {
+    m_dirty = true;
+    if (cb)
+      cb();
+  });
+  m_dirty = true;
+}
 
-  int err = 0;
+/**
+ * Stop watching the control, must not be called
+ * while holding a lock the callback takes
+ */
+void alsa_ctl_interface::unwatch() {
+  alsa_card::watch_id id{0};
+  std::swap(id, m_watch);
+  if (id)
+    m_card.unwatch(id);
+}
 
-  if ((err = snd_mixer_wait(m_hardwaremixer, timeout)) < 0)
-    throw_exception<alsa_mixer_error>("Failed to wait for events", err);
+/**
+ * Test if the jack is plugged, only reading the control
+ * again after a change has been reported
+ */
+bool alsa_ctl_interface::test_device_plugged() {
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
 
-  guard.unlock();
+  if (m_dirty.exchange(false) || !m_watch) {
+    int err = 0;
+    if ((err = snd_ctl_elem_read(m_card.control(), m_value)) < 0)
+      throw_exception<alsa_ctl_interface_error>("Could not read control value", err);
+    m_plugged = snd_ctl_elem_value_get_boolean(m_value, 0);
+  }
 
-  return process_events() > 0;
+  return m_plugged;
 }
 
-int alsa_mixer::process_events() {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
+// }}}
+// class : alsa_mixer {{{
 
-  int num_events = snd_mixer_handle_events(m_hardwaremixer);
+alsa_mixer::alsa_mixer(alsa_card& card, string mixer_control_name)
+    : m_card(card), m_name(move(mixer_control_name)) {
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
 
-  if (num_events < 0)
-    throw_exception<alsa_mixer_error>("Failed to process pending events", num_events);
+  if (element() == nullptr)
+    throw alsa_mixer_error("Cannot find simple element '" + m_name + "'");
+}
 
-  return num_events;
+alsa_mixer::~alsa_mixer() {
+  unwatch();
 }
 
-int alsa_mixer::get_volume() {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
-  long chan_n = 0, vol_total = 0, vol, vol_min, vol_max;
+string alsa_mixer::get_name() {
+  return m_name;
+}
 
-  snd_mixer_selem_get_playback_volume_range(m_mixerelement, &vol_min, &vol_max);
+/**
+ * Call given callback from the reactor thread whenever the element changes
+ */
+void alsa_mixer::watch(callback<>&& on_change) {
+  auto cb = forward<callback<>>(on_change);
+  m_watch = m_card.watch(m_name, [this, cb] {
+    m_dirty = true;
+    if (cb)
+      cb();
+  });
+  m_dirty = true;
+}
 
-  for (int i = 0; i <= SND_MIXER_SCHN_LAST; i++) {
-    if (snd_mixer_selem_has_playback_channel(
-            m_mixerelement, static_cast<snd_mixer_selem_channel_id_t>(i))) {
-      snd_mixer_selem_get_playback_volume(
-          m_mixerelement, static_cast<snd_mixer_selem_channel_id_t>(i), &vol);
-      vol_total += vol;
-      chan_n++;
-    }
-  }
+/**
+ * Stop watching the element, must not be called
+ * while holding a lock the callback takes
+ */
+void alsa_mixer::unwatch() {
+  alsa_card::watch_id id{0};
+  std::swap(id, m_watch);
+  if (id)
+    m_card.unwatch(id);
+}
 
-  return 100.0f * (vol_total / chan_n) / vol_max + 0.5f;
+int alsa_mixer::get_volume() {
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
+  refresh();
+  return m_volume;
 }
 
 void alsa_mixer::set_volume(float percentage) {
   if (is_muted())
     return;
 
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
 
   long vol_min, vol_max;
+  auto elem = element();
+
+  snd_mixer_selem_get_playback_volume_range(elem, &vol_min, &vol_max);
+  snd_mixer_selem_set_playback_volume_all(elem, vol_max * percentage / 100);
 
-  snd_mixer_selem_get_playback_volume_range(m_mixerelement, &vol_min, &vol_max);
-  snd_mixer_selem_set_playback_volume_all(m_mixerelement, vol_max * percentage / 100);
+  m_dirty = true;
 }
 
 void alsa_mixer::set_mute(bool mode) {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
-  snd_mixer_selem_set_playback_switch_all(m_mixerelement, mode);
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
+  snd_mixer_selem_set_playback_switch_all(element(), mode);
+  m_dirty = true;
 }
 
 void alsa_mixer::toggle_mute() {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
   int state;
-  snd_mixer_selem_get_playback_switch(m_mixerelement, SND_MIXER_SCHN_MONO, &state);
-  snd_mixer_selem_set_playback_switch_all(m_mixerelement, !state);
+  auto elem = element();
+  snd_mixer_selem_get_playback_switch(elem, SND_MIXER_SCHN_MONO, &state);
+  snd_mixer_selem_set_playback_switch_all(elem, !state);
+  m_dirty = true;
 }
 
 bool alsa_mixer::is_muted() {
-  std::lock_guard<threading_util::spin_lock> guard(m_lock);
+  std::lock_guard<std::mutex> guard(m_card.m_mutex);
+  refresh();
+  return m_muted;
+}
+
+/**
+ * Requires the lock of the card to be held
+ *
+ * @throws alsa_mixer_error if the element is gone, i.e. the card got unplugged
+ */
+snd_mixer_elem_t* alsa_mixer::element() const {
+  auto elem = m_card.find_element(m_name);
+  if (elem == nullptr)
+    throw alsa_mixer_error("Simple element '" + m_name + "' was removed");
+  return elem;
+}
+
+/**
+ * Read the volume and mute state if the element changed since the last read
+ *
+ * Requires the lock of the card to be held
+ */
+void alsa_mixer::refresh() {
+  if (!m_dirty && m_watch)
+    return;
+
+  long chan_n = 0, vol_total = 0, vol, vol_min, vol_max;
   int state = 0;
+  auto elem = element();
+
+  m_dirty = false;
+
+  snd_mixer_selem_get_playback_volume_range(elem, &vol_min, &vol_max);
+
   for (int i = 0; i <= SND_MIXER_SCHN_LAST; i++) {
-    if (snd_mixer_selem_has_playback_channel(
-            m_mixerelement, static_cast<snd_mixer_selem_channel_id_t>(i))) {
+    auto channel = static_cast<snd_mixer_selem_channel_id_t>(i);
+
+    if (snd_mixer_selem_has_playback_channel(elem, channel)) {
       int state_ = 0;
-      snd_mixer_selem_get_playback_switch(
-          m_mixerelement, static_cast<snd_mixer_selem_channel_id_t>(i), &state_);
+      snd_mixer_selem_get_playback_volume(elem, channel, &vol);
+      snd_mixer_selem_get_playback_switch(elem, channel, &state_);
+      vol_total += vol;
       state = state || state_;
+      chan_n++;
     }
   }
-  return !state;
+
+  m_volume = chan_n && vol_max ? 100.0f * (vol_total / chan_n) / vol_max + 0.5f : 0;
+  m_muted = !state;
 }
 
 // }}}
@@ -0,0 +1,287 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "adapters/icmp.hpp"
+
+LEMONBUDDY_NS
+
+namespace net {
+  /**
+   * Internet checksum of the echo request
+   *
+   * Ping sockets fill it in themselves, raw sockets don't
+   */
+  static uint16_t checksum(const void* data, size_t len) {
+    auto words = static_cast<const uint16_t*>(data);
+    uint32_t sum{0};
+
+    for (; len > 1; len -= 2) sum += *words++;
+    if (len == 1)
+      sum += *reinterpret_cast<const uint8_t*>(words);
+
+    sum = (sum >> 16) + (sum & 0xffff);
+    sum += sum >> 16;
+
+    return static_cast<uint16_t>(~sum);
+  }
+
+  // class : icmp_prober {{{
+
+  /**
+   * Open the socket used to probe given address
+   *
+   * @param interface Send the probes through this interface only
+   */
+  icmp_prober::icmp_prober(const logger& logger, scheduler& scheduler, reactor& reactor,
+      string address, string interface)
+      : m_log(logger), m_scheduler(scheduler), m_reactor(reactor), m_address(move(address)) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+
+    if (inet_pton(AF_INET, m_address.c_str(), &addr.sin_addr) != 1)
+      throw application_error("Invalid address \"" + m_address + "\"");
+
+    const int type{SOCK_NONBLOCK | SOCK_CLOEXEC};
+
+    if ((m_socketfd = socket(AF_INET, SOCK_DGRAM | type, IPPROTO_ICMP)) == -1) {
+      m_raw = true;
+      m_socketfd = socket(AF_INET, SOCK_RAW | type, IPPROTO_ICMP);
+    }
+    if (m_socketfd == -1)
+      throw system_error("Failed to open ICMP socket");
+
+    // The kernel picks the identifier of ping sockets
+    m_id = static_cast<uint16_t>(getpid() ^ reinterpret_cast<uintptr_t>(this));
+
+    if (!interface.empty() &&
+        setsockopt(m_socketfd, SOL_SOCKET, SO_BINDTODEVICE, interface.c_str(),
+            interface.size() + 1) == -1)
+      m_log.warn("icmp_prober: Failed to bind to interface %s (%s)", interface, strerror(errno));
+
+    if (connect(m_socketfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+      close(m_socketfd);
+      throw system_error("Failed to connect ICMP socket to " + m_address);
+    }
+
+    m_log.trace("icmp_prober: Probing %s using a %s socket", m_address, m_raw ? "raw" : "ping");
+  }
+
+  /**
+   * Stop probing and close the socket
+   */
+  icmp_prober::~icmp_prober() {
+    stop();
+    close(m_socketfd);
+  }
+
+  /**
+   * Start sending probes
+   *
+   * The callback is called from the scheduler or the reactor
+   * every time a probe got a reply or was considered lost
+   *
+   * @param window Amount of probes the statistics cover
+   */
+  void icmp_prober::start(chrono::milliseconds interval, chrono::milliseconds timeout,
+      size_t window, result_cb&& on_result) {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_timeout = timeout;
+      m_window = window > 0 ? window : 1;
+      m_callback = forward<result_cb>(on_result);
+    }
+
+    auto handler = m_reactor.add(m_socketfd, EPOLLIN, [this](uint32_t) { on_reply(); });
+    auto timer = m_scheduler.every(
+        chrono::duration_cast<scheduler::clock::duration>(interval), [this] { tick(); });
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_handler = handler;
+    m_timer = timer;
+  }
+
+  /**
+   * Stop sending probes
+   *
+   * Once this returns the callback won't be called anymore, so it
+   * must not be called while holding a lock the callback takes
+   */
+  void icmp_prober::stop() {
+    scheduler::timer_id timer{0};
+    reactor::handler_id handler{0};
+
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      std::swap(timer, m_timer);
+      std::swap(handler, m_handler);
+    }
+
+    if (timer)
+      m_scheduler.cancel(timer);
+    if (handler)
+      m_reactor.remove(handler);
+  }
+
+  /**
+   * Forget the outcome of the previous probes, i.e. after
+   * the link came back up
+   */
+  void icmp_prober::reset() {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_pending.clear();
+    m_results.clear();
+  }
+
+  /**
+   * Get the statistics of the last probes
+   */
+  probe_stats icmp_prober::stats() const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return stats_locked();
+  }
+
+  /**
+   * Scheduler task: expire the unanswered probes and send the next one
+   */
+  void icmp_prober::tick() {
+    result_cb callback;
+    probe_stats stats;
+    bool lost{false};
+
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+
+      auto now = scheduler::clock::now();
+
+      while (!m_pending.empty() && now - m_pending.front().sent >= m_timeout) {
+        m_pending.pop_front();
+        record(true);
+        lost = true;
+      }
+
+      icmphdr request{};
+      request.type = ICMP_ECHO;
+      request.un.echo.id = htons(m_id);
+      request.un.echo.sequence = htons(++m_seq);
+      request.checksum = checksum(&request, sizeof(request));
+
+      // i.e. the network is unreachable while the link is down
+      if (send(m_socketfd, &request, sizeof(request), 0) == -1) {
+        m_log.trace("icmp_prober: Failed to send probe to %s (%s)", m_address, strerror(errno));
+        record(true);
+        lost = true;
+      } else {
+        m_pending.push_back(probe{m_seq, now});
+      }
+
+      if (!lost)
+        return;
+
+      stats = stats_locked();
+      callback = m_callback;
+    }
+
+    if (callback)
+      callback(stats);
+  }
+
+  /**
+   * Reactor callback: match the replies with the pending probes
+   */
+  void icmp_prober::on_reply() {
+    result_cb callback;
+    probe_stats stats;
+    bool replied{false};
+
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+
+      char buffer[1500];
+
+      while (true) {
+        auto len = recv(m_socketfd, buffer, sizeof(buffer), 0);
+        auto now = scheduler::clock::now();
+
+        if (len == -1 && errno == EINTR)
+          continue;
+        else if (len <= 0)
+          break;
+
+        // Raw sockets also receive the IP header
+        size_t offset = m_raw ? (buffer[0] & 0x0f) * 4 : 0;
+
+        if (static_cast<size_t>(len) < offset + sizeof(icmphdr))
+          continue;
+
+        icmphdr reply;
+        memcpy(&reply, buffer + offset, sizeof(reply));
+
+        if (reply.type != ICMP_ECHOREPLY || (m_raw && ntohs(reply.un.echo.id) != m_id))
+          continue;
+
+        auto seq = ntohs(reply.un.echo.sequence);
+        auto it = find_if(
+            m_pending.begin(), m_pending.end(), [&](const probe& p) { return p.seq == seq; });
+
+        // Replies arriving after the timeout were already counted as lost
+        if (it == m_pending.end())
+          continue;
+
+        record(false, now - it->sent);
+        m_pending.erase(it);
+        replied = true;
+      }
+
+      if (!replied)
+        return;
+
+      stats = stats_locked();
+      callback = m_callback;
+    }
+
+    if (callback)
+      callback(stats);
+  }
+
+  /**
+   * Add the outcome of a probe to the window
+   *
+   * Requires the lock to be held
+   */
+  void icmp_prober::record(bool lost, scheduler::clock::duration rtt) {
+    m_results.emplace_back(lost, rtt);
+    while (m_results.size() > m_window) m_results.pop_front();
+  }
+
+  /**
+   * Requires the lock to be held
+   */
+  probe_stats icmp_prober::stats_locked() const {
+    probe_stats stats;
+    scheduler::clock::duration total{0};
+
+    for (auto&& result : m_results) {
+      if (result.first)
+        stats.lost++;
+      else
+        total += result.second;
+    }
+
+    stats.sent = m_results.size();
+
+    if (stats.sent > stats.lost)
+      stats.latency =
+          chrono::duration_cast<chrono::microseconds>(total / (stats.sent - stats.lost));
+
+    return stats;
+  }
+
+  // }}}
+}
+
+LEMONBUDDY_NS_END
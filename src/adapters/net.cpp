@@ -5,6 +5,7 @@
 #include <limits.h>
 #include <linux/ethtool.h>
 #include <linux/if_link.h>
+#include <linux/nl80211.h>
 #include <linux/sockios.h>
 #include <net/if.h>
 #include <netinet/in.h>
@@ -22,8 +23,8 @@
 
 #include "common.hpp"
 #include "config.hpp"
-#include "utils/command.hpp"
 #include "utils/file.hpp"
+#include "utils/math.hpp"
 #include "utils/string.hpp"
 
 LEMONBUDDY_NS
@@ -42,70 +43,56 @@ namespace net {
    * Construct network interface
    */
   network::network(string interface) : m_interface(interface) {
-    if (if_nametoindex(m_interface.c_str()) == 0)
+    if ((m_index = if_nametoindex(m_interface.c_str())) == 0)
       throw network_error("Invalid network interface \"" + m_interface + "\"");
     if ((m_socketfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
       throw network_error("Failed to open socket");
+
+    m_watch = m_netlink.watch(m_index);
   }
 
   /**
    * Destruct network interface
    */
   network::~network() {
+    m_netlink.unwatch(m_watch);
+
     if (m_socketfd != -1)
       close(m_socketfd);
   }
 
   /**
    * Query device driver for information
+   *
+   * The address is kept up to date by the rtnetlink events, only
+   * the traffic counters of the interface are requested
+   *
+   * @param accumulate Request the counters for the next speed rate
    */
-  bool network::query() {
-    struct ifaddrs* ifaddr;
+  bool network::query(bool accumulate) {
+    m_status.ip = m_netlink.state(m_index).ip;
 
-    if (getifaddrs(&ifaddr) == -1)
-      return false;
+    if (!accumulate)
+      return true;
 
-    for (auto ifa = ifaddr; ifa != nullptr; ifa = ifa->ifa_next) {
-      if (m_interface.compare(0, m_interface.length(), ifa->ifa_name) != 0)
-        continue;
-
-      switch (ifa->ifa_addr->sa_family) {
-        case AF_INET:
-          char ip_buffer[NI_MAXHOST];
-          getnameinfo(ifa->ifa_addr, sizeof(sockaddr_in), ip_buffer, NI_MAXHOST, nullptr, 0,
-              NI_NUMERICHOST);
-          m_status.ip = string{ip_buffer};
-          break;
-
-        case AF_PACKET:
-          if (ifa->ifa_data == nullptr)
-            continue;
-          struct rtnl_link_stats* link_state =
-              reinterpret_cast<decltype(link_state)>(ifa->ifa_data);
-          m_status.previous = m_status.current;
-          m_status.current.transmitted = link_state->tx_bytes;
-          m_status.current.received = link_state->rx_bytes;
-          m_status.current.time = chrono::system_clock::now();
-          break;
-      }
-    }
+    rtnetlink::link_counters counters;
+
+    if (!m_netlink.counters(m_index, counters))
+      return false;
 
-    freeifaddrs(ifaddr);
+    m_status.previous = m_status.current;
+    m_status.current.transmitted = counters.transmitted;
+    m_status.current.received = counters.received;
+    m_status.current.time = chrono::system_clock::now();
 
     return true;
   }
 
   /**
-   * Run ping command to test internet connectivity
+   * Get interface index
    */
-  bool network::ping() const {
-    try {
-      auto exec = "ping -c 2 -W 2 -I " + m_interface + " " + string(CONNECTION_TEST_IP);
-      auto ping = command_util::make_command(exec);
-      return ping && ping->exec(true) == EXIT_SUCCESS;
-    } catch (const std::exception& err) {
-      return false;
-    }
+  int network::index() const {
+    return m_index;
   }
 
   /**
@@ -135,8 +122,7 @@ namespace net {
    * Test if the network interface is in a valid state
    */
   bool network::test_interface() const {
-    auto operstate = file_util::get_contents("/sys/class/net/" + m_interface + "/operstate");
-    return operstate.compare(0, 2, "up") == 0;
+    return m_netlink.state(m_index).up();
   }
 
   /**
@@ -166,8 +152,8 @@ namespace net {
   /**
    * Query device driver for information
    */
-  bool wired_network::query() {
-    if (!network::query())
+  bool wired_network::query(bool accumulate) {
+    if (!network::query(accumulate))
       return false;
 
     struct ethtool_cmd ethernet_data;
@@ -220,10 +206,56 @@ namespace net {
    * Query the wireless device for information
    * about the current connection
    */
-  bool wireless_network::query() {
-    if (!network::query())
+  bool wireless_network::query(bool accumulate) {
+    if (!network::query(accumulate))
+      return false;
+    if (m_nl80211.available())
+      return query_nl80211();
+    return query_wext();
+  }
+
+  /**
+   * Query the station info of the access point through nl80211
+   *
+   * The ESSID is cached by the shared nl80211 connection until the
+   * association changes, so this takes a single request per update
+   */
+  bool wireless_network::query_nl80211() {
+    nl80211::interface_info info;
+
+    if (!m_nl80211.interface(m_index, info))
       return false;
 
+    // Ignore interfaces in ad-hoc mode
+    if (info.iftype == NL80211_IFTYPE_ADHOC)
+      return false;
+
+    m_essid = info.ssid;
+    m_bitrate = 0;
+
+    nl80211::station_info station;
+
+    if (m_essid.empty() || !m_nl80211.station(m_index, station))
+      return true;
+
+    m_bitrate = station.bitrate;
+
+    // Same scale as the wireless extensions emulated by cfg80211
+    if (station.has_signal) {
+      auto signal = math_util::cap<int>(station.signal, -110, -40);
+      m_signalstrength.val = math_util::cap<int>(station.signal, -100, -50);
+      m_signalstrength.max = -1;
+      m_linkquality.val = signal + 110;
+      m_linkquality.max = 70;
+    }
+
+    return true;
+  }
+
+  /**
+   * Query the wireless device through the wireless extensions
+   */
+  bool wireless_network::query_wext() {
     auto socket_fd = iw_sockets_open();
 
     if (socket_fd == -1)
@@ -285,6 +317,13 @@ namespace net {
     return m_linkquality.percentage();
   }
 
+  /**
+   * Transmit bitrate reported by last query
+   */
+  string wireless_network::linkspeed() const {
+    return (m_bitrate == 0 ? "???" : to_string(m_bitrate / 10)) + " Mbit/s";
+  }
+
   /**
    * Query for ESSID
    */
@@ -1,4 +1,5 @@
 #include <xcb/xcb_icccm.h>
+#include <algorithm>
 
 #include "components/bar.hpp"
 #include "utils/bspwm.hpp"
@@ -20,22 +21,11 @@ LEMONBUDDY_NS
  * Cleanup signal handlers and destroy the bar window
  */
 bar::~bar() {  // {{{
-  std::lock_guard<threading_util::spin_lock> lck(m_lock);
+  std::lock_guard<threading_util::futex_lock> lck(m_lock);
 
   // Disconnect signal handlers {{{
-  g_signals::parser::alignment_change = nullptr;
-  g_signals::parser::attribute_set = nullptr;
-  g_signals::parser::attribute_unset = nullptr;
-  g_signals::parser::attribute_toggle = nullptr;
-  g_signals::parser::action_block_open = nullptr;
-  g_signals::parser::action_block_close = nullptr;
-  g_signals::parser::color_change = nullptr;
-  g_signals::parser::font_change = nullptr;
-  g_signals::parser::pixel_offset = nullptr;
-  g_signals::parser::ascii_text_write = nullptr;
-  g_signals::parser::unicode_text_write = nullptr;
-  g_signals::parser::string_write = nullptr;
-  g_signals::tray::report_slotcount = nullptr;  // }}}
+  if (m_tray.align != alignment::NONE)
+    g_signals::tray::report_slotcount = nullptr;  // }}}
 
   if (m_sinkattached)
     m_connection.detach_sink(this, 1);
@@ -46,8 +36,11 @@ bar::~bar() {  // {{{
  * Create required components
  *
  * This is done outside the constructor due to boost::di noexcept
+ *
+ * @param monitor Output to put the bar on, defaults to the first one defined
+ * @param tray Whether the bar is allowed to host the tray
  */
-void bar::bootstrap(bool nodraw) {  // {{{
+void bar::bootstrap(bool nodraw, string monitor, bool tray) {  // {{{
   // limit the amount of allowed input events to 1 per 60ms
   m_throttler = throttle_util::make_throttler(1, 60ms);
 
@@ -61,7 +54,11 @@ void bar::bootstrap(bool nodraw) {  // {{{
   if (monitors.empty())
     throw application_error("No monitors found");
 
-  auto monitor_name = m_conf.get<string>(bs, "monitor", "");
+  auto monitor_name = monitor;
+  if (monitor_name.empty()) {
+    auto defined = string_util::split(m_conf.get<string>(bs, "monitor", ""), ' ');
+    monitor_name = defined.empty() ? "" : defined.front();
+  }
   if (monitor_name.empty())
     monitor_name = monitors[0]->name;
 
@@ -340,6 +337,7 @@ void bar::bootstrap(bool nodraw) {  // {{{
       XCB_AUX_ADD_PARAM(&mask, &params, graphics_exposures, 0);
       xutils::pack_values(mask, &params, value_list);
       m_gcontexts.emplace(gc(i), gcontext{m_connection, m_connection.generate_id()});
+      m_gcvalues.emplace(gc(i), colors[i - 1]);
       m_connection.create_gc(m_gcontexts.at(gc(i)), m_pixmap, mask, value_list);
     }
   }
@@ -373,13 +371,13 @@ void bar::bootstrap(bool nodraw) {  // {{{
       throw application_error("Unable to load fonts");
   }
 
-  m_fontmanager->allocate_color(m_bar.foreground, true);
+  m_fontmanager->allocate_color(m_bar.foreground);
 
   // }}}
   // Set tray settings {{{
 
   try {
-    auto tray_position = m_conf.get<string>(bs, "tray-position");
+    auto tray_position = tray ? m_conf.get<string>(bs, "tray-position") : "none";
 
     if (tray_position == "left")
       m_tray.align = alignment::LEFT;
@@ -467,26 +465,6 @@ void bar::bootstrap(bool nodraw) {  // {{{
     m_tray.sibling = m_window;
   }
 
-  // }}}
-  // Connect signal handlers {{{
-
-  m_log.trace("bar: Attach parser callbacks");
-
-  // clang-format off
-  g_signals::parser::alignment_change = bind(&bar::on_alignment_change, this, placeholders::_1);
-  g_signals::parser::attribute_set = bind(&bar::on_attribute_set, this, placeholders::_1);
-  g_signals::parser::attribute_unset = bind(&bar::on_attribute_unset, this, placeholders::_1);
-  g_signals::parser::attribute_toggle = bind(&bar::on_attribute_toggle, this, placeholders::_1);
-  g_signals::parser::action_block_open = bind(&bar::on_action_block_open, this, placeholders::_1, placeholders::_2);
-  g_signals::parser::action_block_close = bind(&bar::on_action_block_close, this, placeholders::_1);
-  g_signals::parser::color_change = bind(&bar::on_color_change, this, placeholders::_1, placeholders::_2);
-  g_signals::parser::font_change = bind(&bar::on_font_change, this, placeholders::_1);
-  g_signals::parser::pixel_offset = bind(&bar::on_pixel_offset, this, placeholders::_1);
-  g_signals::parser::ascii_text_write = bind(&bar::draw_character, this, placeholders::_1);
-  g_signals::parser::unicode_text_write = bind(&bar::draw_character, this, placeholders::_1);
-  g_signals::parser::string_write = bind(&bar::draw_textstring, this, placeholders::_1, placeholders::_2);
-  // clang-format on
-
   // }}}
   // Attach event sink to registry {{{
 
@@ -499,6 +477,13 @@ void bar::bootstrap(bool nodraw) {  // {{{
   m_connection.flush();
 }  // }}}
 
+/**
+ * Create another bar sharing the fonts of this one
+ */
+unique_ptr<bar> bar::mirror() const {  // {{{
+  return make_unique<bar>(m_connection, m_conf, m_log, m_fontmanager);
+}  // }}}
+
 /**
  * Get the bar settings container
  */
@@ -514,26 +499,41 @@ const tray_settings bar::tray() const {  // {{{{
 }  // }}}
 
 /**
- * Parse input string and redraw the bar window
+ * Render the display list and redraw the bar window
+ *
+ * The operations are first laid out into text runs
+ * for each alignment block. Once the width of each block is known
+ * the runs are positioned and compared to the ones of the previous
+ * frame, which are retained in the pixmap. Only the areas covered
+ * by runs that changed are repainted and copied to the window.
  *
- * @param data Input string
- * @param force Unless true, do not parse unchanged data
+ * @param contents Display list built by the controller
+ * @param force Unless true, do not render unchanged contents. Also forces a full repaint
  */
-void bar::parse(string data, bool force) {  // {{{
-  std::lock_guard<threading_util::spin_lock> lck(m_lock);
+void bar::render(const display_list& contents, bool force) {  // {{{
+  std::lock_guard<threading_util::futex_lock> lck(m_lock);
   {
-    if (data == m_prevdata && !force)
+    if (contents == m_prevcontents && !force && !m_repaint)
       return;
 
-    m_prevdata = data;
+    m_prevcontents = contents;
 
-    // TODO: move to fontmanager
-    m_xftdraw = XftDrawCreate(xlib::get_display(), m_pixmap, xlib::get_visual(), m_colormap);
+    if (force)
+      m_repaint = true;
 
     m_bar.align = alignment::LEFT;
-    m_xpos = m_borders[border::LEFT].size;
     m_attributes = 0;
 
+    // The font manager may have been left in another state by a bar sharing it
+    m_fontmanager->set_preferred_font(0);
+
+    m_layout.clear();
+    m_colors.clear();
+    m_colors.emplace(gc::BG, m_bar.background);
+    m_colors.emplace(gc::FG, m_bar.foreground);
+    m_colors.emplace(gc::UL, m_bar.linecolor);
+    m_colors.emplace(gc::OL, m_bar.linecolor);
+
 #if DEBUG and DRAW_CLICKABLE_AREA_HINTS
     for (auto&& action : m_actions) {
       m_connection.destroy_window(action.clickable_area);
@@ -542,81 +542,45 @@ void bar::parse(string data, bool force) {  // {{{
 
     m_actions.clear();
 
-    draw_background();
+    contents.replay(*this);
 
-    if (m_tray.align == alignment::LEFT && m_tray.slots)
-      m_xpos += ((m_tray.width + m_tray.spacing) * m_tray.slots) + m_tray.spacing;
+    layout_actions();
 
-    try {
-      parser parser(m_bar);
-      parser(data);
-    } catch (const unrecognized_token& err) {
-      m_log.err("Unrecognized syntax token '%s'", err.what());
-    }
+    auto frame = layout_frame();
+    auto areas = damaged_areas(frame);
 
-    if (m_tray.align == alignment::RIGHT && m_tray.slots)
-      draw_shift(m_xpos, ((m_tray.width + m_tray.spacing) * m_tray.slots) + m_tray.spacing);
+    if (!areas.empty()) {
+      // TODO: move to fontmanager
+      m_xftdraw = XftDrawCreate(xlib::get_display(), m_pixmap, xlib::get_visual(), m_colormap);
 
-    draw_border(border::ALL);
+      draw_frame(frame, areas);
+      present(areas);
 
-    flush();
+      XftDrawDestroy(m_xftdraw);
+    }
 
-    XftDrawDestroy(m_xftdraw);
+    m_frame = move(frame);
+    m_repaint = false;
   }
 }  // }}}
 
 /**
- * Copy the contents of the pixmap's onto the bar window
+ * Copy the contents of the pixmap onto the bar window
  */
 void bar::flush() {  // {{{
-  m_connection.copy_area(
-      m_pixmap, m_window, m_gcontexts.at(gc::FG), 0, 0, 0, 0, m_bar.width, m_bar.height);
-  m_connection.copy_area(
-      m_pixmap, m_window, m_gcontexts.at(gc::BT), 0, 0, 0, 0, m_bar.width, m_bar.height);
-  m_connection.copy_area(
-      m_pixmap, m_window, m_gcontexts.at(gc::BB), 0, 0, 0, 0, m_bar.width, m_bar.height);
-  m_connection.copy_area(
-      m_pixmap, m_window, m_gcontexts.at(gc::BL), 0, 0, 0, 0, m_bar.width, m_bar.height);
-  m_connection.copy_area(
-      m_pixmap, m_window, m_gcontexts.at(gc::BR), 0, 0, 0, 0, m_bar.width, m_bar.height);
-  m_connection.flush();
-
-#if DEBUG and DRAW_CLICKABLE_AREA_HINTS
-  map<alignment, int> hint_num{{
-      {alignment::LEFT, 0}, {alignment::CENTER, 0}, {alignment::RIGHT, 0},
-  }};
-#endif
-
-  for (auto&& action : m_actions) {
-    if (action.active) {
-      m_log.warn("Action block not closed");
-      m_log.warn("action.command = %s", action.command);
-    } else {
-      m_log.trace_x("bar: Action details (button = %i, start_x = %i, end_x = %i, command = '%s')",
-          static_cast<int>(action.button), action.start_x, action.end_x, action.command);
-#if DEBUG and DRAW_CLICKABLE_AREA_HINTS
-      m_log.info("Drawing clickable area hints");
-
-      hint_num[action.align]++;
-
-      auto x = action.start_x;
-      auto y = m_bar.y + hint_num[action.align]++ * DRAW_CLICKABLE_AREA_HINTS_OFFSET_Y;
-      auto w = action.end_x - action.start_x - 2;
-      auto h = m_bar.height - 2;
-
-      const uint32_t mask = XCB_CW_BORDER_PIXEL | XCB_CW_OVERRIDE_REDIRECT;
-      const uint32_t border_color = hint_num[action.align] % 2 ? 0xff0000 : 0x00ff00;
-      const uint32_t values[2]{border_color, true};
-
-      auto scr = m_connection.screen();
+  present({xcb_rectangle_t{0, 0, m_bar.width, m_bar.height}});
+}  // }}}
 
-      action.clickable_area = m_connection.generate_id();
-      m_connection.create_window_checked(scr->root_depth, action.clickable_area, scr->root, x, y, w,
-          h, 1, XCB_WINDOW_CLASS_INPUT_OUTPUT, scr->root_visual, mask, values);
-      m_connection.map_window_checked(action.clickable_area);
-#endif
-    }
+/**
+ * Copy given areas of the pixmap onto the bar window
+ * using one request per area
+ */
+void bar::present(const vector<xcb_rectangle_t>& areas) {  // {{{
+  for (auto&& area : areas) {
+    m_connection.copy_area(m_pixmap, m_window, m_gcontexts.at(gc::FG), area.x, area.y, area.x,
+        area.y, area.width, area.height);
   }
+  m_connection.flush();
 }  // }}}
 
 /**
@@ -625,11 +589,14 @@ void bar::flush() {  // {{{
  * Used to map mouse clicks to bar actions
  */
 void bar::handle(const evt::button_press& evt) {  // {{{
+  if (evt->event != m_window)
+    return;
+
   if (!m_throttler->passthrough(throttle_util::strategy::try_once_or_leave_yolo{})) {
     return;
   }
 
-  std::lock_guard<threading_util::spin_lock> lck(m_lock);
+  std::lock_guard<threading_util::futex_lock> lck(m_lock);
   {
     m_log.trace_x("bar: Received button press event: %i at pos(%i, %i)",
         static_cast<int>(evt->detail), evt->event_x, evt->event_y);
@@ -679,7 +646,8 @@ void bar::handle(const evt::expose& evt) {  // {{{
   if (evt->window != m_window)
     return;
   m_log.trace("bar: Received expose event");
-  flush();
+  present({xcb_rectangle_t{static_cast<int16_t>(evt->x), static_cast<int16_t>(evt->y), evt->width,
+      evt->height}});
 }  // }}}
 
 /**
@@ -698,7 +666,7 @@ void bar::handle(const evt::expose& evt) {  // {{{
  */
 void bar::handle(const evt::property_notify& evt) {  // {{{
   if (evt->window == m_window && evt->atom == WM_STATE) {
-    if (!g_signals::bar::visibility_change)
+    if (!g_signals::bar::visibility_change || m_tray.align == alignment::NONE)
       return;
 
     try {
@@ -739,6 +707,24 @@ int bar::width_inner() {  // {{{
   return w;
 }  // }}}
 
+/**
+ * Get the horizontal start position of given alignment block
+ */
+int bar::block_x(alignment align) {  // {{{
+  int width = m_layout[align].width;
+  int tray_width = 0;
+
+  if (m_tray.align == align && m_tray.slots)
+    tray_width = ((m_tray.width + m_tray.spacing) * m_tray.slots) + m_tray.spacing;
+
+  if (align == alignment::CENTER)
+    return m_borders[border::LEFT].size + (width_inner() - width) / 2;
+  else if (align == alignment::RIGHT)
+    return m_bar.width - m_borders[border::RIGHT].size - tray_width - width;
+  else
+    return m_borders[border::LEFT].size + tray_width;
+}  // }}}
+
 /**
  * Handle alignment update
  */
@@ -747,14 +733,6 @@ void bar::on_alignment_change(alignment align) {  // {{{
     return;
   m_log.trace_x("bar: alignment_change(%i)", static_cast<int>(align));
   m_bar.align = align;
-
-  if (align == alignment::LEFT) {
-    m_xpos = m_borders[border::LEFT].size;
-  } else if (align == alignment::RIGHT) {
-    m_xpos = m_borders[border::RIGHT].size;
-  } else {
-    m_xpos = 0;
-  }
 }  // }}}
 
 /**
@@ -799,13 +777,13 @@ void bar::on_action_block_open(mousebtn btn, string cmd) {  // {{{
   action.active = true;
   action.align = m_bar.align;
   action.button = btn;
-  action.start_x = m_xpos;
-  action.command = string_util::replace_all(cmd, ":", "\\:");
+  action.start_x = m_layout[m_bar.align].width;
+  action.command = move(cmd);
   m_actions.emplace_back(action);
 }  // }}}
 
 /**
- * Handle action block end
+ * Handle action block end, where mousebtn::NONE closes the innermost block
  */
 void bar::on_action_block_close(mousebtn btn) {  // {{{
   m_log.trace_x("bar: action_block_close(%i)", static_cast<int>(btn));
@@ -813,27 +791,11 @@ void bar::on_action_block_close(mousebtn btn) {  // {{{
   for (auto i = m_actions.size(); i > 0; i--) {
     auto& action = m_actions[i - 1];
 
-    if (!action.active || action.button != btn)
+    if (!action.active || (btn != mousebtn::NONE && action.button != btn))
       continue;
 
     action.active = false;
-
-    if (action.align == alignment::LEFT) {
-      action.end_x = m_xpos;
-    } else if (action.align == alignment::CENTER) {
-      int base_x = m_bar.width;
-      base_x -= m_borders[border::RIGHT].size;
-      base_x /= 2;
-      base_x += m_borders[border::LEFT].size;
-
-      int clickable_width = m_xpos - action.start_x;
-      action.start_x = base_x - clickable_width / 2 + action.start_x / 2;
-      action.end_x = action.start_x + clickable_width;
-    } else if (action.align == alignment::RIGHT) {
-      int base_x = m_bar.width - m_borders[border::RIGHT].size;
-      action.start_x = base_x - m_xpos + action.start_x;
-      action.end_x = base_x;
-    }
+    action.end_x = m_layout[action.align].width;
 
     return;
   }
@@ -844,13 +806,20 @@ void bar::on_action_block_close(mousebtn btn) {  // {{{
  */
 void bar::on_color_change(gc gc_, color color_) {  // {{{
   m_log.trace_x("bar: color_change(%i, %s -> %s)", static_cast<int>(gc_), color_.source(), color_);
+  m_colors.at(gc_) = color_;
+}  // }}}
 
-  if (gc_ == gc::FG) {
-    m_fontmanager->allocate_color(color_);
-  }
-
-  const uint32_t value_list[]{color_};
-  m_connection.change_gc(m_gcontexts.at(gc_), XCB_GC_FOREGROUND, value_list);
+/**
+ * Handle color reset
+ */
+void bar::on_color_reset(gc gc_) {  // {{{
+  m_log.trace_x("bar: color_reset(%i)", static_cast<int>(gc_));
+  if (gc_ == gc::BG)
+    m_colors.at(gc_) = m_bar.background;
+  else if (gc_ == gc::FG)
+    m_colors.at(gc_) = m_bar.foreground;
+  else
+    m_colors.at(gc_) = m_bar.linecolor;
 }  // }}}
 
 /**
@@ -866,29 +835,299 @@ void bar::on_font_change(int index) {  // {{{
  */
 void bar::on_pixel_offset(int px) {  // {{{
   m_log.trace_x("bar: pixel_offset(%i)", px);
-  draw_shift(m_xpos, px);
-  m_xpos += px;
+  auto& block = m_layout[m_bar.align];
+  current_run(nullptr).width += px;
+  block.width += px;
 }  // }}}
 
 /**
  * Proess systray report
+ *
+ * Called from the tray thread, so the bar is repainted by the eventloop
+ * instead of rendering here while another bar may use the font manager
  */
 void bar::on_tray_report(uint16_t slots) {  // {{{
-  if (m_tray.slots == slots)
+  {
+    std::lock_guard<threading_util::futex_lock> lck(m_lock);
+
+    if (m_tray.slots == slots)
+      return;
+
+    m_log.trace("bar: tray_report(%lu)", slots);
+    m_tray.slots = slots;
+
+    // Repaint the whole bar on the next render, even if the contents are unchanged
+    m_repaint = true;
+  }
+
+  if (g_signals::bar::redraw)
+    g_signals::bar::redraw();
+}  // }}}
+
+/**
+ * Get the run that subsequent glyphs of given font should be
+ * appended to, starting a new one if the attributes have changed
+ *
+ * A font of nullptr is used for runs that only fill the background
+ */
+text_run& bar::current_run(fonttype* font) {  // {{{
+  auto& block = m_layout[m_bar.align];
+
+  if (!block.runs.empty()) {
+    auto& run = block.runs.back();
+
+    if (run.font == font && run.attributes == m_attributes &&
+        uint32_t(run.foreground) == uint32_t(m_colors.at(gc::FG)) &&
+        uint32_t(run.background) == uint32_t(m_colors.at(gc::BG)) &&
+        uint32_t(run.underline) == uint32_t(m_colors.at(gc::UL)) &&
+        uint32_t(run.overline) == uint32_t(m_colors.at(gc::OL)))
+      return run;
+  }
+
+  text_run run;
+  run.font = font;
+  run.foreground = m_colors.at(gc::FG);
+  run.background = m_colors.at(gc::BG);
+  run.underline = m_colors.at(gc::UL);
+  run.overline = m_colors.at(gc::OL);
+  run.attributes = m_attributes;
+  run.x = block.width;
+  block.runs.emplace_back(move(run));
+
+  return block.runs.back();
+}  // }}}
+
+/**
+ * Add text character to the display list
+ */
+void bar::on_character_write(uint16_t character) {  // {{{
+  auto& font = m_fontmanager->match_char(character);
+
+  if (!font) {
+    m_log.warn("No suitable font found for character at index %i", character);
     return;
+  }
 
-  m_log.trace("bar: tray_report(%lu)", slots);
-  m_tray.slots = slots;
+  auto chr_width = m_fontmanager->char_width(font, character);
+  auto& run = current_run(font.get());
 
-  if (!m_prevdata.empty())
-    parse(m_prevdata, true);
+  run.chars.emplace_back(character);
+  run.width += chr_width;
+
+  m_layout[m_bar.align].width += chr_width;
 }  // }}}
 
 /**
- * Draw background onto the pixmap
+ * Add text string to the display list
+ *
+ * Consecutive characters resolving to the same font are
+ * appended to the same run and measured in one go
  */
-void bar::draw_background() {  // {{{
-  draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::BG), 0, 0, m_bar.width, m_bar.height);
+void bar::on_string_write(const char* text, size_t len) {  // {{{
+  auto& block = m_layout[m_bar.align];
+  text_run* run{nullptr};
+  int16_t run_width{0};
+
+  for (size_t n = 0; n < len; n++) {
+    uint16_t character = text[n];
+    auto& font = m_fontmanager->match_char(character);
+
+    if (!font) {
+      m_log.warn("No suitable font found for character at index %i", character);
+      continue;
+    }
+
+    if (run == nullptr || run->font != font.get()) {
+      if (run != nullptr) {
+        run->width += run_width;
+        block.width += run_width;
+        run_width = 0;
+      }
+      run = &current_run(font.get());
+      run->chars.reserve(run->chars.size() + len - n);
+    }
+
+    run->chars.emplace_back(character);
+    run_width += m_fontmanager->char_width(font, character);
+  }
+
+  if (run != nullptr) {
+    run->width += run_width;
+    block.width += run_width;
+  }
+}  // }}}
+
+/**
+ * Translate the clickable areas from block relative
+ * positions once the size of each block is known
+ */
+void bar::layout_actions() {  // {{{
+#if DEBUG and DRAW_CLICKABLE_AREA_HINTS
+  map<alignment, int> hint_num{{
+      {alignment::LEFT, 0}, {alignment::CENTER, 0}, {alignment::RIGHT, 0},
+  }};
+#endif
+
+  for (auto&& action : m_actions) {
+    if (action.active) {
+      m_log.warn("Action block not closed");
+      m_log.warn("action.command = %s", action.command);
+      continue;
+    }
+
+    auto x = block_x(action.align);
+    action.start_x += x;
+    action.end_x += x;
+
+    m_log.trace_x("bar: Action details (button = %i, start_x = %i, end_x = %i, command = '%s')",
+        static_cast<int>(action.button), action.start_x, action.end_x, action.command);
+
+#if DEBUG and DRAW_CLICKABLE_AREA_HINTS
+    m_log.info("Drawing clickable area hints");
+
+    hint_num[action.align]++;
+
+    auto hint_x = action.start_x;
+    auto hint_y = m_bar.y + hint_num[action.align]++ * DRAW_CLICKABLE_AREA_HINTS_OFFSET_Y;
+    auto hint_w = action.end_x - action.start_x - 2;
+    auto hint_h = m_bar.height - 2;
+
+    const uint32_t mask = XCB_CW_BORDER_PIXEL | XCB_CW_OVERRIDE_REDIRECT;
+    const uint32_t border_color = hint_num[action.align] % 2 ? 0xff0000 : 0x00ff00;
+    const uint32_t values[2]{border_color, true};
+
+    auto scr = m_connection.screen();
+
+    action.clickable_area = m_connection.generate_id();
+    m_connection.create_window_checked(scr->root_depth, action.clickable_area, scr->root, hint_x,
+        hint_y, hint_w, hint_h, 1, XCB_WINDOW_CLASS_INPUT_OUTPUT, scr->root_visual, mask, values);
+    m_connection.map_window_checked(action.clickable_area);
+#endif
+  }
+}  // }}}
+
+/**
+ * Move the runs of each alignment block to their final
+ * position, ordered by their horizontal position
+ */
+vector<text_run> bar::layout_frame() {  // {{{
+  vector<text_run> frame;
+
+  for (auto&& block : m_layout) {
+    auto x = block_x(block.first);
+
+    for (auto&& run : block.second.runs) {
+      run.x += x;
+      frame.emplace_back(move(run));
+    }
+
+    block.second.runs.clear();
+  }
+
+  std::stable_sort(frame.begin(), frame.end(),
+      [](const text_run& a, const text_run& b) { return a.x < b.x; });
+
+  return frame;
+}  // }}}
+
+/**
+ * Get the areas that need to be repainted for given frame
+ *
+ * Runs that are painted identically in both the previous and the
+ * new frame are left untouched. The damaged areas are widened to
+ * cover any retained run they overlap, since antialiased text
+ * can't be painted twice over itself.
+ */
+vector<xcb_rectangle_t> bar::damaged_areas(const vector<text_run>& frame) {  // {{{
+  if (m_repaint)
+    return {xcb_rectangle_t{0, 0, m_bar.width, m_bar.height}};
+
+  vector<pair<int, int>> spans;
+
+  auto collect = [&spans](const vector<text_run>& runs, const vector<text_run>& other) {
+    for (auto&& run : runs) {
+      if (run.width <= 0)
+        continue;
+
+      auto it = std::lower_bound(other.begin(), other.end(), run.x,
+          [](const text_run& r, int16_t x) { return r.x < x; });
+      auto retained = false;
+
+      for (; it != other.end() && it->x == run.x && !retained; it++) {
+        retained = same_run(*it, run);
+      }
+
+      if (!retained)
+        spans.emplace_back(run.x, run.x + run.width);
+    }
+  };
+
+  collect(frame, m_frame);
+  collect(m_frame, frame);
+
+  if (spans.empty())
+    return {};
+
+  for (auto&& span : spans) {
+    for (auto&& run : frame) {
+      if (run.width > 0 && run.x < span.second && run.x + run.width > span.first) {
+        span.first = std::min<int>(span.first, run.x);
+        span.second = std::max<int>(span.second, run.x + run.width);
+      }
+    }
+  }
+
+  std::sort(spans.begin(), spans.end());
+
+  vector<xcb_rectangle_t> areas;
+  int start{spans[0].first};
+  int end{spans[0].second};
+
+  auto add_area = [&](int x1, int x2) {
+    x1 = math_util::cap<int>(x1, 0, m_bar.width);
+    x2 = math_util::cap<int>(x2, 0, m_bar.width);
+    if (x2 > x1)
+      areas.emplace_back(xcb_rectangle_t{static_cast<int16_t>(x1), 0,
+          static_cast<uint16_t>(x2 - x1), m_bar.height});
+  };
+
+  for (auto&& span : spans) {
+    if (span.first > end) {
+      add_area(start, end);
+      start = span.first;
+    }
+    end = std::max(end, span.second);
+  }
+
+  add_area(start, end);
+
+  return areas;
+}  // }}}
+
+/**
+ * Check if two runs would produce the same pixels
+ */
+bool bar::same_run(const text_run& a, const text_run& b) {  // {{{
+  return a.font == b.font && a.x == b.x && a.width == b.width && a.attributes == b.attributes &&
+         uint32_t(a.foreground) == uint32_t(b.foreground) &&
+         uint32_t(a.background) == uint32_t(b.background) &&
+         uint32_t(a.underline) == uint32_t(b.underline) &&
+         uint32_t(a.overline) == uint32_t(b.overline) && a.chars == b.chars;
+}  // }}}
+
+/**
+ * Change the foreground value of given gcontext unless
+ * it already has the requested color
+ */
+void bar::set_gc_color(gc gc_, const color& color_) {  // {{{
+  uint32_t value{color_};
+
+  if (m_gcvalues[gc_] == value)
+    return;
+
+  const uint32_t value_list[]{value};
+  m_connection.change_gc(m_gcontexts.at(gc_), XCB_GC_FOREGROUND, value_list);
+  m_gcvalues[gc_] = value;
 }  // }}}
 
 /**
@@ -942,106 +1181,87 @@ void bar::draw_border(border border_) {  // {{{
 }  // }}}
 
 /**
- * Draw over- and underline onto the pixmap
+ * Repaint given areas of the pixmap
+ *
+ * The areas are cleared and every run overlapping them is
+ * painted again, followed by the borders
  */
-void bar::draw_lines(int x, int w) {  // {{{
-  if (!m_bar.lineheight)
-    return;
+void bar::draw_frame(const vector<text_run>& frame, const vector<xcb_rectangle_t>& areas) {  // {{{
+  set_gc_color(gc::BG, m_bar.background);
 
-  if (m_attributes & static_cast<int>(attribute::o))
-    draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::OL), x, m_borders[border::TOP].size,
-        w, m_bar.lineheight);
-
-  if (m_attributes & static_cast<int>(attribute::u))
-    draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::UL), x,
-        m_bar.height - m_borders[border::BOTTOM].size - m_bar.lineheight, w, m_bar.lineheight);
-}  // }}}
-
-/**
- * Shift the contents of the pixmap horizontally
- */
-int bar::draw_shift(int x, int chr_width) {  // {{{
-  int delta = chr_width;
-
-  if (m_bar.align == alignment::CENTER) {
-    int base_x = m_bar.width;
-    base_x -= m_borders[border::RIGHT].size;
-    base_x /= 2;
-    base_x += m_borders[border::LEFT].size;
-    m_connection.copy_area(m_pixmap, m_pixmap, m_gcontexts.at(gc::FG), base_x - x / 2, 0,
-        base_x - (x + chr_width) / 2, 0, x, m_bar.height);
-    x = base_x - (x + chr_width) / 2 + x;
-    delta /= 2;
-  } else if (m_bar.align == alignment::RIGHT) {
-    m_connection.copy_area(m_pixmap, m_pixmap, m_gcontexts.at(gc::FG), m_bar.width - x, 0,
-        m_bar.width - x - chr_width, 0, x, m_bar.height);
-    x = m_bar.width - chr_width - m_borders[border::RIGHT].size;
+  for (auto&& area : areas) {
+    draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::BG), area.x, area.y, area.width,
+        area.height);
   }
 
-  draw_util::fill(
-      m_connection, m_pixmap, m_gcontexts.at(gc::BG), x, 0, m_bar.width - x, m_bar.height);
-
-  // Translate pos of clickable areas
-  if (m_bar.align != alignment::LEFT)
-    for (auto&& action : m_actions) {
-      if (action.active || action.align != m_bar.align)
-        continue;
-      action.start_x -= delta;
-      action.end_x -= delta;
+  for (auto&& run : frame) {
+    for (auto&& area : areas) {
+      if (run.x < area.x + area.width && run.x + run.width > area.x) {
+        draw_run(run, run.x);
+        break;
+      }
     }
+  }
 
-  return x;
+  draw_border(border::ALL);
 }  // }}}
 
 /**
- * Draw text character
+ * Paint text run at given position
+ *
+ * The whole run is sent as a single text request followed
+ * by one fill for each of the enabled line attributes
  */
-void bar::draw_character(uint16_t character) {  // {{{
-  // TODO: cache
-  auto& font = m_fontmanager->match_char(character);
+void bar::draw_run(const text_run& run, int x) {  // {{{
+  if (run.width > 0 && uint32_t(run.background) != uint32_t(m_bar.background)) {
+    set_gc_color(gc::BG, run.background);
+    draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::BG), x, 0, run.width, m_bar.height);
+  }
 
-  if (!font) {
-    m_log.warn("No suitable font found for character at index %i", character);
+  if (run.font == nullptr)
     return;
-  }
+
+  auto font = run.font;
 
   if (font->ptr && font->ptr != m_gcfont) {
     m_gcfont = font->ptr;
     m_fontmanager->set_gcontext_font(m_gcontexts.at(gc::FG), m_gcfont);
   }
 
-  // TODO: cache
-  auto chr_width = m_fontmanager->char_width(font, character);
-
-  // Avoid odd glyph width's for center-aligned text
-  // since it breaks the positioning of clickable area's
-  if (m_bar.align == alignment::CENTER && chr_width % 2)
-    chr_width++;
+  set_gc_color(gc::FG, run.foreground);
 
-  auto x = draw_shift(m_xpos, chr_width);
   auto y = m_bar.vertical_mid + font->height / 2 - font->descent + font->offset_y;
 
-  // m_log.trace("Draw char(%c, width: %i) at pos(%i,%i)", character, chr_width, x, y);
-
   if (font->xft != nullptr) {
+    m_fontmanager->allocate_color(run.foreground);
     auto color = m_fontmanager->xftcolor();
-    XftDrawString16(m_xftdraw, &color, font->xft, x, y, &character, 1);
+    XftDrawString16(m_xftdraw, &color, font->xft, x, y, run.chars.data(), run.chars.size());
   } else {
-    character = (character >> 8) | (character << 8);
     draw_util::xcb_poly_text_16_patched(
-        m_connection, m_pixmap, m_gcontexts.at(gc::FG), x, y, 1, &character);
+        m_connection, m_pixmap, m_gcontexts.at(gc::FG), x, y, run.chars);
   }
 
-  draw_lines(x, chr_width);
-  m_xpos += chr_width;
+  draw_lines(run, x);
 }  // }}}
 
 /**
- * Draw text string
+ * Draw over- and underline onto the pixmap
  */
-void bar::draw_textstring(const char* text, size_t len) {  // {{{
-  for (size_t n = 0; n < len; n++) {
-    draw_character(text[n]);
+void bar::draw_lines(const text_run& run, int x) {  // {{{
+  if (!m_bar.lineheight)
+    return;
+
+  if (run.attributes & static_cast<int>(attribute::o)) {
+    set_gc_color(gc::OL, run.overline);
+    draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::OL), x, m_borders[border::TOP].size,
+        run.width, m_bar.lineheight);
+  }
+
+  if (run.attributes & static_cast<int>(attribute::u)) {
+    set_gc_color(gc::UL, run.underline);
+    draw_util::fill(m_connection, m_pixmap, m_gcontexts.at(gc::UL), x,
+        m_bar.height - m_borders[border::BOTTOM].size - m_bar.lineheight, run.width,
+        m_bar.lineheight);
   }
 }  // }}}
 
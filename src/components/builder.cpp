@@ -8,7 +8,11 @@ void builder::set_lazy(bool mode) {
   m_lazy = mode;
 }
 
-string builder::flush() {
+/**
+ * Get the generated display list and reset the builder,
+ * closing any open tags unless running in non-lazy mode
+ */
+display_list builder::flush() {
   if (m_lazy) {
     while (m_counters[syntaxtag::A] > 0) cmd_close(true);
     while (m_counters[syntaxtag::B] > 0) background_close(true);
@@ -19,7 +23,7 @@ string builder::flush() {
     while (m_counters[syntaxtag::o] > 0) overline_close(true);
   }
 
-  string output = m_output.data();
+  display_list output{move(m_output)};
 
   // reset values
   m_output.clear();
@@ -27,95 +31,62 @@ string builder::flush() {
   for (auto& value : m_colors) value.second = "";
   m_fontindex = 1;
 
-  return string_util::replace_all(output, string{BUILDER_SPACE_TOKEN}, " ");
+  return output;
 }
 
+/**
+ * Append markup without keeping track of the tags it contains
+ */
 void builder::append(string text) {
-  string str(text);
-  auto len = str.length();
-  if (len > 2 && str[0] == '"' && str[len - 1] == '"')
-    m_output += str.substr(1, len - 2);
-  else
-    m_output += str;
+  auto len = text.length();
+  if (len > 2 && text[0] == '"' && text[len - 1] == '"')
+    text = text.substr(1, len - 2);
+
+  try {
+    parser<display_list> markup(m_bar, m_output);
+    markup(text);
+  } catch (const unrecognized_token&) {
+    // The rest of the input is dropped, like the renderer used to do
+  }
+}
+
+/**
+ * Append the contents of a previously built display list
+ */
+void builder::append(const display_list& contents) {
+  m_output.append(contents);
 }
 
+/**
+ * Append text node
+ *
+ * Any markup in the text is tokenized once and mapped to the builder
+ * methods so that the opened tags get closed when flushing
+ */
 void builder::node(string str, bool add_space) {
-  string::size_type n, m;
-  string s(str);
-
-  while (true) {
-    if (s.empty()) {
-      break;
-
-    } else if ((n = s.find("%{F-}")) == 0) {
-      color_close(!m_lazy);
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{F#")) == 0 && (m = s.find("}")) != string::npos) {
-      if (m - n - 4 == 2)
-        color_alpha(s.substr(n + 3, m - 3));
-      else
-        color(s.substr(n + 3, m - 3));
-      s.erase(n, m + 1);
-
-    } else if ((n = s.find("%{B-}")) == 0) {
-      background_close(!m_lazy);
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{B#")) == 0 && (m = s.find("}")) != string::npos) {
-      background(s.substr(n + 3, m - 3));
-      s.erase(n, m + 1);
-
-    } else if ((n = s.find("%{T-}")) == 0) {
-      font_close(!m_lazy);
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{T")) == 0 && (m = s.find("}")) != string::npos) {
-      font(std::atoi(s.substr(n + 3, m - 3).c_str()));
-      s.erase(n, m + 1);
-
-    } else if ((n = s.find("%{U-}")) == 0) {
-      line_color_close(!m_lazy);
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{U#")) == 0 && (m = s.find("}")) != string::npos) {
-      line_color(s.substr(n + 3, m - 3));
-      s.erase(n, m + 1);
-
-    } else if ((n = s.find("%{+u}")) == 0) {
-      underline();
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{+o}")) == 0) {
-      overline();
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{-u}")) == 0) {
-      underline_close(true);
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{-o}")) == 0) {
-      overline_close(true);
-      s.erase(0, 5);
-
-    } else if ((n = s.find("%{A}")) == 0) {
-      cmd_close(true);
-      s.erase(0, 4);
-
-    } else if ((n = s.find("%{")) == 0 && (m = s.find("}")) != string::npos) {
-      append(s.substr(n, m + 1));
-      s.erase(n, m + 1);
-
-    } else if ((n = s.find("%{")) > 0) {
-      append(s.substr(0, n));
-      s.erase(0, n);
-
-    } else
-      break;
+  auto len = str.length();
+  if (len > 2 && str[0] == '"' && str[len - 1] == '"')
+    str = str.substr(1, len - 2);
+  if (str.find(BUILDER_SPACE_TOKEN) != string::npos)
+    str = string_util::replace_all(str, BUILDER_SPACE_TOKEN, " ");
+
+  try {
+    parser<builder> markup(m_bar, *this);
+    markup(str);
+  } catch (const unrecognized_token&) {
+    // The rest of the input is dropped, like the renderer used to do
   }
 
-  if (!s.empty())
-    append(s);
+  if (add_space)
+    space();
+}
+
+/**
+ * Append the contents of a previously built display list
+ */
+void builder::node(const display_list& contents, bool add_space) {
+  m_output.append(contents);
+
   if (add_space)
     space();
 }
@@ -194,7 +165,7 @@ void builder::node(label_t label, bool add_space) {
 
 void builder::offset(int pixels) {
   if (pixels != 0)
-    tag_open('O', std::to_string(pixels));
+    m_output.offset(pixels);
 }
 
 void builder::space(int width) {
@@ -203,7 +174,7 @@ void builder::space(int width) {
   if (width <= 0)
     return;
   string str(width, ' ');
-  append(str);
+  m_output.text(str.data(), str.length());
 }
 
 void builder::remove_trailing_space(int width) {
@@ -211,14 +182,12 @@ void builder::remove_trailing_space(int width) {
     width = m_bar.spacing;
   if (width <= 0)
     return;
-  string::size_type spacing = width;
-  string str(spacing, ' ');
-  if (m_output.length() >= spacing && m_output.substr(m_output.length() - spacing) == str)
-    m_output = m_output.substr(0, m_output.length() - spacing);
+  m_output.remove_trailing(' ', width);
 }
 
 void builder::invert() {
-  tag_open('R', "");
+  m_output.set_color(gc::BG, m_bar.foreground);
+  m_output.set_color(gc::FG, m_bar.background);
 }
 
 void builder::font(int index) {
@@ -231,7 +200,7 @@ void builder::font(int index) {
 
   m_counters[syntaxtag::T]++;
   m_fontindex = index;
-  tag_open('T', std::to_string(index));
+  m_output.set_font(index);
 }
 
 void builder::font_close(bool force) {
@@ -240,7 +209,7 @@ void builder::font_close(bool force) {
 
   m_counters[syntaxtag::T]--;
   m_fontindex = 1;
-  tag_close('T');
+  m_output.set_font(-1);
 }
 
 void builder::background(string color) {
@@ -261,7 +230,7 @@ void builder::background(string color) {
 
   m_counters[syntaxtag::B]++;
   m_colors[syntaxtag::B] = color;
-  tag_open('B', color);
+  m_output.set_color(gc::BG, lemonbuddy::color::parse(color, m_bar.background));
 }
 
 void builder::background_close(bool force) {
@@ -270,7 +239,7 @@ void builder::background_close(bool force) {
 
   m_counters[syntaxtag::B]--;
   m_colors[syntaxtag::B] = "";
-  tag_close('B');
+  m_output.reset_color(gc::BG);
 }
 
 void builder::color(string color_) {
@@ -292,7 +261,7 @@ void builder::color(string color_) {
 
   m_counters[syntaxtag::F]++;
   m_colors[syntaxtag::F] = color;
-  tag_open('F', color);
+  m_output.set_color(gc::FG, lemonbuddy::color::parse(color, m_bar.foreground));
 }
 
 void builder::color_alpha(string alpha_) {
@@ -320,7 +289,7 @@ void builder::color_close(bool force) {
 
   m_counters[syntaxtag::F]--;
   m_colors[syntaxtag::F] = "";
-  tag_close('F');
+  m_output.reset_color(gc::FG);
 }
 
 void builder::line_color(string color) {
@@ -333,7 +302,8 @@ void builder::line_color(string color) {
 
   m_counters[syntaxtag::U]++;
   m_colors[syntaxtag::U] = color;
-  tag_open('U', color);
+  m_output.set_color(gc::UL, lemonbuddy::color::parse(color, m_bar.linecolor));
+  m_output.set_color(gc::OL, lemonbuddy::color::parse(color, m_bar.linecolor));
 }
 
 void builder::line_color_close(bool force) {
@@ -342,7 +312,8 @@ void builder::line_color_close(bool force) {
 
   m_counters[syntaxtag::U]--;
   m_colors[syntaxtag::U] = "";
-  tag_close('U');
+  m_output.reset_color(gc::UL);
+  m_output.reset_color(gc::OL);
 }
 
 void builder::overline(string color) {
@@ -352,7 +323,7 @@ void builder::overline(string color) {
     return;
 
   m_counters[syntaxtag::o]++;
-  append("%{+o}");
+  m_output.set_attribute(attribute::o);
 }
 
 void builder::overline_close(bool force) {
@@ -360,7 +331,7 @@ void builder::overline_close(bool force) {
     return;
 
   m_counters[syntaxtag::o]--;
-  append("%{-o}");
+  m_output.unset_attribute(attribute::o);
 }
 
 void builder::underline(string color) {
@@ -370,7 +341,7 @@ void builder::underline(string color) {
     return;
 
   m_counters[syntaxtag::u]++;
-  append("%{+u}");
+  m_output.set_attribute(attribute::u);
 }
 
 void builder::underline_close(bool force) {
@@ -378,38 +349,93 @@ void builder::underline_close(bool force) {
     return;
 
   m_counters[syntaxtag::u]--;
-  append("%{-u}");
+  m_output.unset_attribute(attribute::u);
 }
 
 void builder::cmd(mousebtn index, string action, bool condition) {
-  int button = static_cast<int>(index);
-
   if (!condition || action.empty())
     return;
 
-  action = string_util::replace_all(action, ":", "\\:");
-  action = string_util::replace_all(action, "$", "\\$");
-  action = string_util::replace_all(action, "}", "\\}");
-  action = string_util::replace_all(action, "{", "\\{");
-  action = string_util::replace_all(action, "%", "\x0025");
-
-  append("%{A" + std::to_string(button) + ":" + action + ":}");
+  m_output.open_action(index, action);
   m_counters[syntaxtag::A]++;
 }
 
 void builder::cmd_close(bool force) {
   if (m_counters[syntaxtag::A] > 0 || force)
-    append("%{A}");
+    m_output.close_action();
   if (m_counters[syntaxtag::A] > 0)
     m_counters[syntaxtag::A]--;
 }
 
-void builder::tag_open(char tag, string value) {
-  append("%{" + string({tag}) + value + "}");
+// Parser sink handlers used to track tags found in text nodes {{{
+
+void builder::on_alignment_change(alignment align) {
+  m_output.align(align);
+}
+
+void builder::on_attribute_set(attribute attr) {
+  if (attr == attribute::u)
+    underline();
+  else if (attr == attribute::o)
+    overline();
+}
+
+void builder::on_attribute_unset(attribute attr) {
+  if (attr == attribute::u)
+    underline_close(true);
+  else if (attr == attribute::o)
+    overline_close(true);
+}
+
+void builder::on_attribute_toggle(attribute attr) {
+  m_output.toggle_attribute(attr);
+}
+
+void builder::on_action_block_open(mousebtn btn, string cmd) {
+  this->cmd(btn, cmd);
+}
+
+void builder::on_action_block_close(mousebtn) {
+  cmd_close(true);
+}
+
+void builder::on_color_change(gc gc_, lemonbuddy::color color_) {
+  if (gc_ == gc::BG)
+    background(color_.source());
+  else if (gc_ == gc::FG)
+    color(color_.source());
+  else if (gc_ == gc::UL)
+    line_color(color_.source());
 }
 
-void builder::tag_close(char tag) {
-  append("%{" + string({tag}) + "-}");
+void builder::on_color_reset(gc gc_) {
+  if (gc_ == gc::BG)
+    background_close(!m_lazy);
+  else if (gc_ == gc::FG)
+    color_close(!m_lazy);
+  else if (gc_ == gc::UL)
+    line_color_close(!m_lazy);
 }
 
+void builder::on_font_change(int index) {
+  if (index <= 0)
+    font_close(!m_lazy);
+  else
+    font(index);
+}
+
+void builder::on_pixel_offset(int px) {
+  offset(px);
+}
+
+void builder::on_character_write(uint16_t character) {
+  m_output.character(character);
+}
+
+void builder::on_string_write(const char* text, size_t len) {
+  m_output.text(text, len);
+}
+
+// }}}
+
 LEMONBUDDY_NS_END
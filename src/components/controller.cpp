@@ -1,6 +1,7 @@
 #include <mutex>
 
 #include "components/controller.hpp"
+#include "components/builder.hpp"
 #include "components/signals.hpp"
 #include "modules/backlight.hpp"
 #include "modules/battery.hpp"
@@ -14,7 +15,6 @@
 #include "modules/text.hpp"
 #include "modules/unsupported.hpp"
 #include "modules/xbacklight.hpp"
-#include "utils/process.hpp"
 #include "utils/string.hpp"
 
 #if ENABLE_I3
@@ -40,11 +40,7 @@ using namespace modules;
  */
 controller::~controller() {
   g_signals::bar::action_click = nullptr;
-
-  if (m_command) {
-    m_log.info("Terminating running shell command");
-    m_command->terminate();
-  }
+  g_signals::bar::redraw = nullptr;
 
   if (m_eventloop) {
     m_log.info("Deconstructing eventloop");
@@ -55,6 +51,7 @@ controller::~controller() {
 
   if (m_bar) {
     m_log.info("Deconstructing bar");
+    m_mirrors.clear();
     m_bar.reset();
   }
 
@@ -73,10 +70,6 @@ controller::~controller() {
     }
   }
 
-  m_log.info("Waiting for spawned processes");
-  while (process_util::notify_childprocess())
-    ;
-
   m_connection.flush();
 }
 
@@ -115,8 +108,20 @@ void controller::bootstrap(bool writeback, bool dump_wmname) {
     return;
   }
 
+  if (!m_writeback)
+    bootstrap_mirrors();
+
+  // Tokenize the separator once instead of on every update
+  builder separator{m_bar->settings(), false};
+  separator.append(m_bar->settings().separator);
+  m_separator = separator.flush();
+
   m_log.trace("controller: Attach eventloop callbacks");
-  m_eventloop->set_update_cb(bind(&controller::on_update, this));
+  m_eventloop->set_update_cb(bind(&controller::on_update, this, placeholders::_1));
+
+  // The bars share their font manager, so they are only rendered from the eventloop
+  eventloop::entry_t redraw{static_cast<int>(event_type::UPDATE)};
+  g_signals::bar::redraw = bind(&eventloop::enqueue, m_eventloop.get(), redraw);
 
   if (!m_writeback) {
     g_signals::bar::action_click = bind(&controller::on_mouse_event, this, placeholders::_1);
@@ -326,6 +331,31 @@ void controller::activate_tray() {
   }
 }
 
+/**
+ * Create a copy of the bar on each additional monitor
+ *
+ * The copies share the modules and fonts of the first bar,
+ * so the contents are only built once and drawn on every bar
+ */
+void controller::bootstrap_mirrors() {
+  auto monitors = string_util::split(m_conf.get<string>(m_conf.bar_section(), "monitor", ""), ' ');
+  auto primary = m_bar->settings().monitor->name;
+
+  for (auto&& monitor : monitors) {
+    if (monitor.empty() || monitor == primary)
+      continue;
+
+    try {
+      m_log.trace("controller: Setup bar on monitor %s", monitor);
+      auto mirror = m_bar->mirror();
+      mirror->bootstrap(false, monitor, false);
+      m_mirrors.emplace_back(move(mirror));
+    } catch (const std::exception& err) {
+      m_log.err("Failed to setup bar on monitor %s (%s)", monitor, err.what());
+    }
+  }
+}
+
 /**
  * Create and initialize bar modules
  */
@@ -390,8 +420,11 @@ void controller::bootstrap_modules() {
         else
           throw application_error("Unknown module: " + module_name);
 
-        module->set_update_cb(bind(&eventloop::enqueue, m_eventloop.get(),
-            eventloop::entry_t{static_cast<int>(event_type::UPDATE)}));
+        // The modules are indexed in the order they appear in the module map
+        eventloop::entry_t update{static_cast<int>(event_type::UPDATE)};
+        update.index = module_count;
+
+        module->set_update_cb(bind(&eventloop::enqueue, m_eventloop.get(), update));
         module->set_stop_cb(bind(&eventloop::enqueue, m_eventloop.get(),
             eventloop::entry_t{static_cast<int>(event_type::CHECK)}));
 
@@ -425,93 +458,94 @@ void controller::on_mouse_event(string input) {
 }
 
 /**
- * TODO: docstring
+ * Forward the action to the shell without waiting for it to finish
  */
 void controller::on_unrecognized_action(string input) {
   try {
-    if (m_command) {
-      m_log.warn("Terminating previous shell command");
-      m_command->terminate();
-    }
-
     m_log.info("Executing shell command: %s", input);
-
-    m_command = command_util::make_command(input);
-    m_command->exec();
-    m_command.reset();
+    m_executor.spawn_detached(input);
   } catch (const application_error& err) {
     m_log.err("controller: Error while forwarding input to shell -> %s", err.what());
   }
 }
 
 /**
- * TODO: docstring
+ * Splice the module contents together and pass them on to the
+ * renderer, or print them as markup when running in writeback mode
+ *
+ * The contents of alignment blocks without any dirty modules
+ * are reused from the previous update
  */
-void controller::on_update() {
-  string contents{""};
-  string separator{m_bar->settings().separator};
+void controller::on_update(const dirtymap_t& dirty) {
+  display_list contents;
+  size_t index = 0;
 
   string padding_left(m_bar->settings().padding_left, ' ');
-  string padding_right(m_bar->settings().padding_right, ' ');
-
-  auto margin_left = m_bar->settings().module_margin_left;
-  auto margin_right = m_bar->settings().module_margin_right;
 
   for (const auto& block : m_eventloop->modules()) {
-    string block_contents;
-    bool is_left = false;
-    bool is_center = false;
-    bool is_right = false;
+    auto& block_contents = m_blocks[block.first];
+    auto first = dirty.begin() + index;
+    auto last = first + block.second.size();
+
+    index += block.second.size();
+
+    if (find(first, last, true) != last)
+      block_contents = build_block(block.first, block.second);
+
+    if (block_contents.empty())
+      continue;
+
+    contents.align(block.first);
 
     if (block.first == alignment::LEFT)
-      is_left = true;
-    else if (block.first == alignment::CENTER)
-      is_center = true;
-    else if (block.first == alignment::RIGHT)
-      is_right = true;
+      contents.text(padding_left.data(), padding_left.length());
 
-    for (const auto& module : block.second) {
-      auto module_contents = module->contents();
+    // Color and font changes that cancel out across
+    // module boundaries are merged when appending
+    contents.append(block_contents);
+  }
 
-      if (module_contents.empty())
-        continue;
+  if (m_writeback) {
+    std::cout << contents.markup() << std::endl;
+  } else {
+    m_bar->render(contents);
+    for (auto&& mirror : m_mirrors) mirror->render(contents);
+  }
+}
 
-      if (!block_contents.empty() && !separator.empty())
-        block_contents += separator;
+/**
+ * Splice the contents of the modules in given alignment block together
+ */
+display_list controller::build_block(alignment align, const vector<module_t>& modules) {
+  display_list block_contents;
 
-      if (!(is_left && module == block.second.front()))
-        block_contents += string(margin_left, ' ');
+  string padding_right(m_bar->settings().padding_right, ' ');
 
-      block_contents += module->contents();
+  string margin_left(m_bar->settings().module_margin_left, ' ');
+  string margin_right(m_bar->settings().module_margin_right, ' ');
 
-      if (!(is_right && module == block.second.back()))
-        block_contents += string(margin_right, ' ');
-    }
+  for (const auto& module : modules) {
+    auto module_contents = module->contents();
 
-    if (block_contents.empty())
+    if (module_contents->empty())
       continue;
 
-    if (is_left) {
-      contents += "%{l}";
-      contents += padding_left;
-    } else if (is_center) {
-      contents += "%{c}";
-    } else if (is_right) {
-      contents += "%{r}";
-      block_contents += padding_right;
-    }
+    if (!block_contents.empty() && !m_separator.empty())
+      block_contents.append(m_separator);
 
-    block_contents = string_util::replace_all(block_contents, "B-}%{B#", "B#");
-    block_contents = string_util::replace_all(block_contents, "F-}%{F#", "F#");
-    block_contents = string_util::replace_all(block_contents, "T-}%{T", "T");
-    contents += string_util::replace_all(block_contents, "}%{", " ");
-  }
+    if (!(align == alignment::LEFT && module == modules.front()))
+      block_contents.text(margin_left.data(), margin_left.length());
 
-  if (m_writeback) {
-    std::cout << contents << std::endl;
-  } else {
-    m_bar->parse(contents);
+    block_contents.append(*module_contents);
+
+    if (!(align == alignment::RIGHT && module == modules.back()))
+      block_contents.text(margin_right.data(), margin_right.length());
   }
+
+  if (!block_contents.empty() && align == alignment::RIGHT)
+    block_contents.text(padding_right.data(), padding_right.length());
+
+  return block_contents;
 }
 
 LEMONBUDDY_NS_END
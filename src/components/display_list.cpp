@@ -0,0 +1,351 @@
+#include "components/display_list.hpp"
+
+LEMONBUDDY_NS
+
+bool display_op::operator==(const display_op& other) const {
+  return code == other.code && value == other.value && text == other.text &&
+         uint32_t(color) == uint32_t(other.color);
+}
+
+bool display_op::operator!=(const display_op& other) const {
+  return !(*this == other);
+}
+
+void display_list::align(alignment align_) {
+  display_op op;
+  op.code = display_opcode::ALIGNMENT;
+  op.value = static_cast<int>(align_);
+  push(move(op));
+}
+
+void display_list::set_attribute(attribute attr) {
+  display_op op;
+  op.code = display_opcode::ATTRIBUTE_SET;
+  op.value = static_cast<int>(attr);
+  push(move(op));
+}
+
+void display_list::unset_attribute(attribute attr) {
+  display_op op;
+  op.code = display_opcode::ATTRIBUTE_UNSET;
+  op.value = static_cast<int>(attr);
+  push(move(op));
+}
+
+void display_list::toggle_attribute(attribute attr) {
+  display_op op;
+  op.code = display_opcode::ATTRIBUTE_TOGGLE;
+  op.value = static_cast<int>(attr);
+  push(move(op));
+}
+
+void display_list::open_action(mousebtn btn, string cmd) {
+  display_op op;
+  op.code = display_opcode::ACTION_OPEN;
+  op.value = static_cast<int>(btn);
+  op.text = move(cmd);
+  push(move(op));
+}
+
+/**
+ * Close action block, where mousebtn::NONE closes the innermost block
+ */
+void display_list::close_action(mousebtn btn) {
+  display_op op;
+  op.code = display_opcode::ACTION_CLOSE;
+  op.value = static_cast<int>(btn);
+  push(move(op));
+}
+
+void display_list::set_color(gc gc_, const lemonbuddy::color& color_) {
+  display_op op;
+  op.code = display_opcode::COLOR;
+  op.value = static_cast<int>(gc_);
+  op.color = color_;
+  push(move(op));
+}
+
+void display_list::reset_color(gc gc_) {
+  display_op op;
+  op.code = display_opcode::COLOR_RESET;
+  op.value = static_cast<int>(gc_);
+  push(move(op));
+}
+
+void display_list::set_font(int index) {
+  display_op op;
+  op.code = display_opcode::FONT;
+  op.value = index;
+  push(move(op));
+}
+
+void display_list::offset(int px) {
+  display_op op;
+  op.code = display_opcode::OFFSET;
+  op.value = px;
+  push(move(op));
+}
+
+void display_list::character(uint16_t character_) {
+  display_op op;
+  op.code = display_opcode::CHARACTER;
+  op.value = character_;
+  push(move(op));
+}
+
+/**
+ * Add ascii text, merged with the preceding text op
+ */
+void display_list::text(const char* text_, size_t len) {
+  if (len == 0)
+    return;
+
+  if (!m_ops.empty() && m_ops.back().code == display_opcode::TEXT) {
+    m_ops.back().text.append(text_, len);
+    return;
+  }
+
+  display_op op;
+  op.code = display_opcode::TEXT;
+  op.text.assign(text_, len);
+  m_ops.emplace_back(move(op));
+}
+
+/**
+ * Append the operations of another display list
+ */
+void display_list::append(const display_list& other) {
+  for (auto&& op : other.m_ops) {
+    if (op.code == display_opcode::TEXT)
+      text(op.text.data(), op.text.length());
+    else
+      push(display_op{op});
+  }
+}
+
+void display_list::clear() {
+  m_ops.clear();
+}
+
+bool display_list::empty() const {
+  return m_ops.empty();
+}
+
+size_t display_list::size() const {
+  return m_ops.size();
+}
+
+const vector<display_op>& display_list::ops() const {
+  return m_ops;
+}
+
+/**
+ * Remove given amount of trailing characters if the
+ * list ends with a text op containing them
+ *
+ * @return true if the characters were removed
+ */
+bool display_list::remove_trailing(char chr, size_t count) {
+  if (m_ops.empty() || m_ops.back().code != display_opcode::TEXT)
+    return false;
+
+  auto& str = m_ops.back().text;
+
+  if (str.length() < count || str.find_first_not_of(chr, str.length() - count) != string::npos)
+    return false;
+
+  str.erase(str.length() - count);
+
+  if (str.empty())
+    m_ops.pop_back();
+
+  return true;
+}
+
+/**
+ * Serialize the operations into markup
+ */
+string display_list::markup() const {
+  string output;
+
+  auto escape = [](const string& cmd) {
+    string escaped;
+    for (auto&& chr : cmd) {
+      if (chr == ':' || chr == '{' || chr == '}')
+        escaped += '\\';
+      escaped += chr;
+    }
+    return escaped;
+  };
+
+  auto gc_tag = [](int gc_) {
+    switch (static_cast<gc>(gc_)) {
+      case gc::BG:
+        return 'B';
+      case gc::FG:
+        return 'F';
+      default:
+        return 'U';
+    }
+  };
+
+  for (auto&& op : m_ops) {
+    switch (op.code) {
+      case display_opcode::NONE:
+        break;
+      case display_opcode::ALIGNMENT:
+        if (op.value == static_cast<int>(alignment::LEFT))
+          output += "%{l}";
+        else if (op.value == static_cast<int>(alignment::CENTER))
+          output += "%{c}";
+        else if (op.value == static_cast<int>(alignment::RIGHT))
+          output += "%{r}";
+        break;
+      case display_opcode::ATTRIBUTE_SET:
+        output += op.value == static_cast<int>(attribute::o) ? "%{+o}" : "%{+u}";
+        break;
+      case display_opcode::ATTRIBUTE_UNSET:
+        output += op.value == static_cast<int>(attribute::o) ? "%{-o}" : "%{-u}";
+        break;
+      case display_opcode::ATTRIBUTE_TOGGLE:
+        output += op.value == static_cast<int>(attribute::o) ? "%{!o}" : "%{!u}";
+        break;
+      case display_opcode::ACTION_OPEN:
+        output += "%{A" + to_string(op.value) + ":" + escape(op.text) + ":}";
+        break;
+      case display_opcode::ACTION_CLOSE:
+        output += "%{A}";
+        break;
+      case display_opcode::COLOR:
+        // The overline color is always set together with the underline color
+        if (static_cast<gc>(op.value) != gc::OL)
+          output += "%{" + string{gc_tag(op.value)} + op.color.source() + "}";
+        break;
+      case display_opcode::COLOR_RESET:
+        if (static_cast<gc>(op.value) != gc::OL)
+          output += "%{" + string{gc_tag(op.value)} + "-}";
+        break;
+      case display_opcode::FONT:
+        output += op.value > 0 ? "%{T" + to_string(op.value) + "}" : "%{T-}";
+        break;
+      case display_opcode::OFFSET:
+        output += "%{O" + to_string(op.value) + "}";
+        break;
+      case display_opcode::CHARACTER:
+        if (op.value < 0x80) {
+          output += static_cast<char>(op.value);
+        } else if (op.value < 0x800) {
+          output += static_cast<char>(0xc0 | (op.value >> 6));
+          output += static_cast<char>(0x80 | (op.value & 0x3f));
+        } else {
+          output += static_cast<char>(0xe0 | (op.value >> 12));
+          output += static_cast<char>(0x80 | ((op.value >> 6) & 0x3f));
+          output += static_cast<char>(0x80 | (op.value & 0x3f));
+        }
+        break;
+      case display_opcode::TEXT:
+        output += op.text;
+        break;
+    }
+  }
+
+  return output;
+}
+
+bool display_list::operator==(const display_list& other) const {
+  return m_ops == other.m_ops;
+}
+
+bool display_list::operator!=(const display_list& other) const {
+  return !(*this == other);
+}
+
+/**
+ * Add operation, merging it with the previous one when
+ * it would be overridden before anything gets drawn
+ */
+void display_list::push(display_op&& op) {
+  if (!m_ops.empty()) {
+    auto& last = m_ops.back();
+
+    switch (op.code) {
+      case display_opcode::COLOR:
+      case display_opcode::COLOR_RESET:
+        // Look through the preceding color changes, since the line
+        // colors are changed in pairs (underline and overline)
+        for (auto it = m_ops.rbegin(); it != m_ops.rend(); it++) {
+          if (it->code != display_opcode::COLOR && it->code != display_opcode::COLOR_RESET)
+            break;
+          if (it->value == op.value) {
+            *it = move(op);
+            return;
+          }
+        }
+        break;
+      case display_opcode::FONT:
+        if (last.code == display_opcode::FONT) {
+          last = move(op);
+          return;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  m_ops.emplace_back(move(op));
+}
+
+// Parser sink handlers used to record markup {{{
+
+void display_list::on_alignment_change(alignment align_) {
+  align(align_);
+}
+
+void display_list::on_attribute_set(attribute attr) {
+  set_attribute(attr);
+}
+
+void display_list::on_attribute_unset(attribute attr) {
+  unset_attribute(attr);
+}
+
+void display_list::on_attribute_toggle(attribute attr) {
+  toggle_attribute(attr);
+}
+
+void display_list::on_action_block_open(mousebtn btn, string cmd) {
+  open_action(btn, move(cmd));
+}
+
+void display_list::on_action_block_close(mousebtn btn) {
+  close_action(btn);
+}
+
+void display_list::on_color_change(gc gc_, lemonbuddy::color color_) {
+  set_color(gc_, color_);
+}
+
+void display_list::on_color_reset(gc gc_) {
+  reset_color(gc_);
+}
+
+void display_list::on_font_change(int index) {
+  set_font(index);
+}
+
+void display_list::on_pixel_offset(int px) {
+  offset(px);
+}
+
+void display_list::on_character_write(uint16_t character_) {
+  character(character_);
+}
+
+void display_list::on_string_write(const char* text_, size_t len) {
+  text(text_, len);
+}
+
+// }}}
+
+LEMONBUDDY_NS_END
@@ -55,6 +55,8 @@ void eventloop::run(chrono::duration<double, std::milli> timeframe, int limit) {
     }
 
     if (match_event(evt, event_type::UPDATE)) {
+      mark_dirty(evt);
+
       int swallowed = 0;
       while (swallowed++ < limit && m_queue.wait_dequeue_timed(next, timeframe)) {
         if (match_event(next, event_type::QUIT)) {
@@ -62,6 +64,7 @@ void eventloop::run(chrono::duration<double, std::milli> timeframe, int limit) {
           break;
         } else if (compare_events(evt, next)) {
           m_log.trace("eventloop: Swallowing event within timeframe");
+          mark_dirty(next);
           evt = next;
         } else {
           break;
@@ -94,7 +97,7 @@ void eventloop::stop() {
 /**
  * Set callback handler for UPDATE events
  */
-void eventloop::set_update_cb(callback<>&& cb) {
+void eventloop::set_update_cb(callback<const dirtymap_t&>&& cb) {
   m_update_cb = forward<decltype(cb)>(cb);
 }
 
@@ -118,6 +121,8 @@ void eventloop::add_module(const alignment pos, module_t&& module) {
     vec.emplace_back(forward<module_t>(module));
     m_modules.insert(it, modulemap_t::value_type(pos, move(vec)));
   }
+
+  m_dirty.push_back(false);
 }
 
 /**
@@ -157,6 +162,16 @@ bool eventloop::compare_events(entry_t evt, entry_t evt2) {
   return evt.type == evt2.type;
 }
 
+/**
+ * Flag the module that triggered given UPDATE event as dirty
+ */
+void eventloop::mark_dirty(entry_t evt) {
+  if (evt.index >= 0 && static_cast<size_t>(evt.index) < m_dirty.size())
+    m_dirty[evt.index] = true;
+  else
+    m_dirty.assign(m_dirty.size(), true);
+}
+
 /**
  * Forward event to handler based on type
  */
@@ -181,10 +196,12 @@ void eventloop::on_update() {
   m_log.trace("eventloop: Received UPDATE event");
 
   if (m_update_cb) {
-    m_update_cb();
+    m_update_cb(m_dirty);
   } else {
     m_log.warn("No callback to handle update");
   }
+
+  m_dirty.assign(m_dirty.size(), false);
 }
 
 /**
@@ -0,0 +1,589 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <csignal>
+
+#include "components/executor.hpp"
+#include "utils/process.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Construct executor
+ *
+ * @param jobs Amount of commands allowed to run at the same time
+ * @param timeout Default deadline, zero disables it
+ * @param direct Execute commands without shell syntax without `sh -c`
+ */
+executor::executor(const logger& logger, scheduler& scheduler, reactor& reactor,
+    supervisor& supervisor, size_t jobs, chrono::milliseconds timeout, bool direct)
+    : m_log(logger)
+    , m_scheduler(scheduler)
+    , m_reactor(reactor)
+    , m_supervisor(supervisor)
+    , m_limit(jobs)
+    , m_timeout(timeout)
+    , m_direct(direct) {}
+
+/**
+ * Stop supervising the commands and terminate the ones still running
+ *
+ * Detached commands are left running
+ */
+executor::~executor() {
+  vector<scheduler::timer_id> timers;
+  vector<reactor::handler_id> handlers;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stopped = true;
+    m_queue.clear();
+    for (auto&& j : m_jobs) {
+      j.second.cancelled = true;
+      j.second.on_line = nullptr;
+      j.second.on_exit = nullptr;
+      timers.emplace_back(j.second.spawner);
+    }
+  }
+
+  // Wait for the spawns in progress before collecting their handlers
+  for (auto&& id : timers) m_scheduler.cancel(id);
+  timers.clear();
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for (auto&& j : m_jobs) {
+      timers.emplace_back(j.second.deadline);
+      handlers.emplace_back(j.second.output);
+      handlers.emplace_back(j.second.writer);
+    }
+  }
+
+  for (auto&& id : timers) m_scheduler.cancel(id);
+  for (auto&& id : handlers) m_reactor.remove(id);
+
+  // The exit handlers call back into the executor, so the
+  // children are unwatched without holding the lock
+  vector<pid_t> children;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for (auto&& j : m_jobs) {
+      if (j.second.pid > 0 && !j.second.exited)
+        children.emplace_back(j.second.pid);
+    }
+  }
+
+  for (auto&& pid : children) m_supervisor.unwatch(pid);
+
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  for (auto&& j : m_jobs) {
+    if (j.second.pid > 0 && !j.second.exited && !j.second.detached) {
+      m_log.trace("executor: Terminating command (pid: %i)", j.second.pid);
+      killpg(j.second.pid, SIGTERM);
+      waitpid(j.second.pid, nullptr, 0);
+    }
+    if (j.second.infd != -1)
+      close(j.second.infd);
+    if (j.second.outfd != -1)
+      close(j.second.outfd);
+  }
+
+  m_jobs.clear();
+}
+
+/**
+ * Run command using the default deadline
+ */
+executor::job_id executor::run(string cmd, line_cb&& on_line, exit_cb&& on_exit) {
+  return run(move(cmd), m_timeout, forward<line_cb>(on_line), forward<exit_cb>(on_exit));
+}
+
+/**
+ * Run command and pass its output and exit status to the callbacks
+ *
+ * @param timeout Terminate the command once it has run this long, zero disables it
+ */
+executor::job_id executor::run(
+    string cmd, chrono::milliseconds timeout, line_cb&& on_line, exit_cb&& on_exit) {
+  job j;
+  j.cmd = move(cmd);
+  j.timeout = timeout;
+  j.on_line = forward<line_cb>(on_line);
+  j.on_exit = forward<exit_cb>(on_exit);
+  return enqueue(move(j));
+}
+
+/**
+ * Run long-lived command, i.e. one that keeps printing its output
+ *
+ * Persistent commands don't count towards the job limit and have no
+ * deadline. With `input` set, lines can be sent to the standard input
+ * of the command using write()
+ */
+executor::job_id executor::run_persistent(
+    string cmd, line_cb&& on_line, exit_cb&& on_exit, bool input) {
+  job j;
+  j.cmd = move(cmd);
+  j.timeout = chrono::milliseconds{0};
+  j.on_line = forward<line_cb>(on_line);
+  j.on_exit = forward<exit_cb>(on_exit);
+  j.persistent = true;
+  j.input = input;
+  return enqueue(move(j));
+}
+
+/**
+ * Run command without waiting for it
+ *
+ * Detached commands don't count towards the job limit,
+ * have no deadline and their output is discarded
+ */
+void executor::spawn_detached(string cmd) {
+  job j;
+  j.cmd = move(cmd);
+  j.timeout = chrono::milliseconds{0};
+  j.detached = true;
+  enqueue(move(j));
+}
+
+/**
+ * Cancel command
+ *
+ * Queued commands are dropped and running ones get terminated. Once
+ * this returns the callbacks of the command will no longer be called,
+ * unless called from within one of them
+ */
+void executor::cancel(job_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+  scheduler::timer_id spawner{0};
+
+  if (it != m_jobs.end()) {
+    auto& j = it->second;
+    j.cancelled = true;
+    j.on_line = nullptr;
+    j.on_exit = nullptr;
+    spawner = j.spawner;
+
+    auto queued = std::find(m_queue.begin(), m_queue.end(), id);
+    if (queued != m_queue.end()) {
+      m_queue.erase(queued);
+      m_jobs.erase(it);
+      return;
+    }
+  }
+
+  m_callbacks.wait(guard, id);
+
+  if (spawner) {
+    guard.unlock();
+    m_scheduler.cancel(spawner);
+    guard.lock();
+  }
+
+  if ((it = m_jobs.find(id)) == m_jobs.end()) {
+    return;
+  } else if (it->second.pid == -1) {
+    // The spawn task got cancelled before it ran
+    release(it->second);
+    m_jobs.erase(it);
+  } else if (!it->second.exited) {
+    m_log.trace("executor: Terminating cancelled command (pid: %i)", it->second.pid);
+    killpg(it->second.pid, SIGTERM);
+  }
+}
+
+/**
+ * Write line to the standard input of a persistent command
+ *
+ * Never blocks. Lines written before the command got spawned are sent
+ * once it runs, and the rest of a line the input couldn't take at once
+ * is sent when it becomes writable. A line is dropped if the command
+ * hasn't read the previous one yet
+ *
+ * @return False if the line could not be written
+ */
+bool executor::write(job_id id, const string& line) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end() || !it->second.input || it->second.cancelled || it->second.exited)
+    return false;
+
+  auto& j = it->second;
+  string data{line.empty() || line.back() != '\n' ? line + "\n" : line};
+
+  if (j.pid == -1) {
+    j.pending += data;
+    return true;
+  } else if (j.infd == -1 || !j.pending.empty()) {
+    return false;
+  }
+
+  j.pending = move(data);
+
+  return write_input(id, j);
+}
+
+/**
+ * Check if the command is queued or running
+ */
+bool executor::running(job_id id) const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto it = m_jobs.find(id);
+  return it != m_jobs.end() && !it->second.cancelled;
+}
+
+/**
+ * Get the amount of commands occupying a job slot
+ */
+size_t executor::active() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_active;
+}
+
+/**
+ * Get the amount of commands waiting for a job slot
+ */
+size_t executor::queued() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_queue.size();
+}
+
+/**
+ * Start the command or queue it if all job slots are taken
+ */
+executor::job_id executor::enqueue(job&& j) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto id = m_nextid++;
+
+  m_jobs.emplace(id, forward<job>(j));
+
+  if (!takes_slot(m_jobs.at(id)) || m_active < m_limit) {
+    start(id);
+  } else {
+    m_log.trace("executor: All job slots taken, queueing command (id: %lu)", id);
+    m_queue.emplace_back(id);
+  }
+
+  return id;
+}
+
+/**
+ * Take a job slot and hand the command over to the scheduler
+ *
+ * Requires the lock to be held
+ */
+void executor::start(job_id id) {
+  auto& j = m_jobs.at(id);
+
+  if (takes_slot(j))
+    m_active++;
+
+  j.spawner = m_scheduler.once(chrono::milliseconds{0}, [this, id] { spawn(id); });
+}
+
+/**
+ * Fork and execute the command, then let the reactor wait for its output and exit
+ */
+void executor::spawn(job_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end()) {
+    return;
+  } else if (it->second.cancelled || m_stopped) {
+    release(it->second);
+    m_jobs.erase(it);
+    return;
+  }
+
+  string cmd{it->second.cmd};
+  bool detached{it->second.detached};
+  bool input{it->second.input};
+
+  guard.unlock();
+
+  int fds[2]{-1, -1};
+  int infds[2]{-1, -1};
+  int devnull{open("/dev/null", O_RDWR | O_CLOEXEC)};
+  pid_t pid{-1};
+
+  // The command gets its own process group, so that
+  // the deadline reaches the processes it spawns
+  if (devnull == -1) {
+    m_log.err("executor: Failed to open /dev/null (%s)", strerror(errno));
+  } else if (!detached && pipe2(fds, O_CLOEXEC) == -1) {
+    m_log.err("executor: Failed to create pipe (%s)", strerror(errno));
+  } else if (input && socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, infds) == -1) {
+    m_log.err("executor: Failed to create input socket (%s)", strerror(errno));
+  } else {
+    int in{input ? infds[0] : devnull};
+    int out{detached ? devnull : fds[1]};
+    if ((pid = process_util::spawn(cmd, in, out, out, m_direct)) == -1)
+      m_log.err("executor: Failed to spawn '%s' (%s)", cmd, strerror(errno));
+  }
+
+  if (fds[1] != -1)
+    close(fds[1]);
+  if (infds[0] != -1)
+    close(infds[0]);
+  if (devnull != -1)
+    close(devnull);
+
+  guard.lock();
+
+  auto& j = m_jobs.at(id);
+
+  if (pid == -1) {
+    if (fds[0] != -1)
+      close(fds[0]);
+    if (infds[1] != -1)
+      close(infds[1]);
+    j.exited = true;
+    j.result.status = 127;
+    guard.unlock();
+    return deliver(id, {}, true);
+  }
+
+  m_log.trace("executor: Spawned command (pid: %i): %s", pid, cmd);
+
+  j.pid = pid;
+  j.infd = infds[1];
+  j.outfd = fds[0];
+
+  // Send the lines written while the command was being spawned
+  if (!j.pending.empty())
+    write_input(id, j);
+
+  m_supervisor.watch(
+      pid, [this, id](const supervisor::child_status& result) { on_exit(id, result); });
+
+  if (j.outfd != -1) {
+    fcntl(j.outfd, F_SETFL, fcntl(j.outfd, F_GETFL) | O_NONBLOCK);
+    j.output = m_reactor.add(j.outfd, EPOLLIN, [this, id](uint32_t) { on_output(id); });
+  }
+
+  if (j.timeout.count() > 0)
+    j.deadline = m_scheduler.once(j.timeout, [this, id] { on_deadline(id); });
+
+  j.spawner = 0;
+}
+
+/**
+ * Reactor handler: read the available output
+ */
+void executor::on_output(job_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end())
+    return;
+
+  auto& j = it->second;
+  vector<string> lines;
+
+  read_output(j, lines);
+
+  if (!j.eof) {
+    guard.unlock();
+    return deliver(id, move(lines), false);
+  }
+
+  m_reactor.remove(j.output);
+  close(j.outfd);
+  j.output = 0;
+  j.outfd = -1;
+
+  bool exited{j.exited};
+  guard.unlock();
+  deliver(id, move(lines), exited);
+}
+
+/**
+ * Reactor handler: send the rest of the pending input
+ */
+void executor::on_writable(job_id id) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end())
+    return;
+
+  auto& j = it->second;
+
+  if (!write_input(id, j) || j.pending.empty()) {
+    m_reactor.remove(j.writer);
+    j.writer = 0;
+  }
+}
+
+/**
+ * Supervisor callback: the command has exited and got reaped
+ */
+void executor::on_exit(job_id id, const supervisor::child_status& result) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end())
+    return;
+
+  auto& j = it->second;
+  j.exited = true;
+  j.result = result;
+
+  // Processes spawned by the command may keep the output open,
+  // so only what has been written so far is taken into account
+  vector<string> lines;
+  if (j.outfd != -1)
+    read_output(j, lines);
+
+  guard.unlock();
+  deliver(id, move(lines), true);
+}
+
+/**
+ * Scheduler task: terminate the command once its deadline has passed
+ */
+void executor::on_deadline(job_id id) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end() || it->second.pid == -1 || it->second.exited)
+    return;
+
+  m_log.warn("executor: Command exceeded its deadline, terminating: %s", it->second.cmd);
+  killpg(it->second.pid, SIGTERM);
+}
+
+/**
+ * Check if the command counts towards the job limit
+ */
+bool executor::takes_slot(const job& j) const {
+  return !j.detached && !j.persistent;
+}
+
+/**
+ * Give back the job slot and start the next queued command
+ *
+ * Requires the lock to be held
+ */
+void executor::release(const job& j) {
+  if (!takes_slot(j))
+    return;
+
+  m_active--;
+
+  while (!m_stopped && !m_queue.empty() && m_active < m_limit) {
+    auto id = m_queue.front();
+    m_queue.pop_front();
+    start(id);
+  }
+}
+
+/**
+ * Read the pending output and collect the complete lines
+ *
+ * Requires the lock to be held
+ */
+void executor::read_output(job& j, vector<string>& lines) {
+  if (!j.reader.read(j.outfd, [&](const char* line, size_t len) { lines.emplace_back(line, len); }))
+    j.eof = true;
+}
+
+/**
+ * Send as much of the pending input as the command takes without blocking
+ *
+ * What is left gets sent once the reactor reports the input as writable,
+ * so that the command never receives a partial line followed by another.
+ * Requires the lock to be held
+ *
+ * @return False if the input is closed
+ */
+bool executor::write_input(job_id id, job& j) {
+  while (!j.pending.empty()) {
+    // The input is a socket so that a closed input doesn't raise SIGPIPE
+    auto bytes = send(j.infd, j.pending.c_str(), j.pending.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if (bytes == -1 && errno == EINTR) {
+      continue;
+    } else if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (bytes == -1) {
+      m_log.trace("executor: Failed to write to command (%s)", strerror(errno));
+      j.pending.clear();
+      return false;
+    }
+
+    j.pending.erase(0, bytes);
+  }
+
+  if (!j.pending.empty() && !j.writer)
+    j.writer = m_reactor.add(j.infd, EPOLLOUT, [this, id](uint32_t) { on_writable(id); });
+
+  return true;
+}
+
+/**
+ * Pass the output lines and, once the command has exited, its status to the callbacks
+ */
+void executor::deliver(job_id id, vector<string>&& lines, bool exited) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_jobs.find(id);
+
+  if (it == m_jobs.end())
+    return;
+
+  job finished;
+  line_cb on_line;
+  exit_cb on_exit;
+
+  if (!exited) {
+    on_line = it->second.on_line;
+  } else {
+    finished = move(it->second);
+    m_jobs.erase(it);
+    release(finished);
+
+    finished.reader.flush([&](const char* line, size_t len) { lines.emplace_back(line, len); });
+
+    on_line = move(finished.on_line);
+    on_exit = move(finished.on_exit);
+  }
+
+  m_callbacks.enter(id);
+
+  guard.unlock();
+
+  if (exited) {
+    m_reactor.remove(finished.output);
+    m_reactor.remove(finished.writer);
+    m_scheduler.cancel(finished.deadline);
+
+    if (finished.infd != -1)
+      close(finished.infd);
+    if (finished.outfd != -1)
+      close(finished.outfd);
+  }
+
+  m_callbacks.call(m_mutex, id, [&] {
+    for (auto&& line : lines) {
+      if (on_line)
+        on_line(line);
+    }
+    if (on_exit)
+      on_exit(finished.result);
+  });
+}
+
+LEMONBUDDY_NS_END
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "components/inotify_dispatcher.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Create the inotify instance and wait for events in the reactor
+ */
+inotify_dispatcher::inotify_dispatcher(const logger& logger, reactor& reactor)
+    : m_log(logger), m_reactor(reactor) {
+  if ((m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1)
+    throw system_error("Failed to allocate inotify fd");
+
+  m_handler = m_reactor.add(m_fd, EPOLLIN, [this](uint32_t) { on_events(); });
+}
+
+/**
+ * Stop waiting for events and close the inotify instance,
+ * which removes all watches
+ */
+inotify_dispatcher::~inotify_dispatcher() {
+  m_reactor.remove(m_handler);
+  close(m_fd);
+}
+
+/**
+ * Watch given path for the events in mask
+ *
+ * The callback is called from the reactor thread. It also receives
+ * IN_IGNORED once the kernel removed the watch, after which the
+ * watcher has to be removed and the path added again
+ *
+ * @throws system_error if the path can't be watched
+ */
+inotify_dispatcher::watch_id inotify_dispatcher::add(
+    const string& path, uint32_t mask, event_cb&& on_event) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  // Keep the events other watchers of the same inode asked for
+  auto wd = inotify_add_watch(m_fd, path.c_str(), mask | IN_MASK_ADD);
+
+  if (wd == -1)
+    throw system_error("Failed to attach inotify watch to " + path);
+
+  auto id = m_nextid++;
+  m_watchers.emplace(id, watcher{wd, mask, path, forward<event_cb>(on_event)});
+
+  m_log.trace("inotify_dispatcher: Watching %s (id: %lu, wd: %i)", path, id, wd);
+
+  return id;
+}
+
+/**
+ * Remove watcher
+ *
+ * Once this returns the callback of the watcher won't be called anymore,
+ * so it must not be called while holding a lock the callback takes
+ */
+void inotify_dispatcher::remove(watch_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_watchers.find(id);
+
+  if (it == m_watchers.end())
+    return;
+
+  auto removed = it->second;
+  m_watchers.erase(it);
+
+  if (removed.wd != -1) {
+    uint32_t mask{0};
+
+    for (auto&& w : m_watchers) {
+      if (w.second.wd == removed.wd)
+        mask |= w.second.mask;
+    }
+
+    // Stop receiving the events only the removed watcher asked for
+    if (mask == 0)
+      inotify_rm_watch(m_fd, removed.wd);
+    else if (removed.mask & ~mask)
+      inotify_add_watch(m_fd, removed.path.c_str(), mask);
+  }
+
+  m_callbacks.wait(guard, id);
+}
+
+/**
+ * Get the amount of watchers
+ */
+size_t inotify_dispatcher::size() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_watchers.size();
+}
+
+/**
+ * Reactor callback: read all pending events and merge them per watcher
+ */
+void inotify_dispatcher::on_events() {
+  alignas(::inotify_event) char buffer[inotify_util::EVENT_BUFFER_SIZE];
+  map<watch_id, inotify_event> events;
+
+  while (true) {
+    auto len = read(m_fd, buffer, sizeof(buffer));
+
+    if (len == -1 && errno == EINTR)
+      continue;
+    else if (len <= 0)
+      break;
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    inotify_util::for_each_event(buffer, len, [&](const ::inotify_event* e) {
+      // Events got dropped, so every watcher may have missed something
+      bool overflow{(e->mask & IN_Q_OVERFLOW) == IN_Q_OVERFLOW};
+
+      for (auto&& w : m_watchers) {
+        if (!overflow && w.second.wd != e->wd)
+          continue;
+
+        // The kernel removed the watch, i.e. because the file got deleted,
+        // so the watcher is notified in order to add the path again
+        if (e->mask & IN_IGNORED) {
+          m_log.warn("inotify_dispatcher: Watch on %s was removed", w.second.path);
+          w.second.wd = -1;
+        } else if (!overflow && (e->mask & w.second.mask) == 0) {
+          continue;
+        }
+
+        auto& event = events[w.first];
+        event.filename = e->len ? e->name : w.second.path;
+        event.wd = e->wd;
+        event.cookie = e->cookie;
+        event.is_dir = e->mask & IN_ISDIR;
+        event.mask |= e->mask;
+      }
+    });
+  }
+
+  if (!events.empty())
+    notify(move(events));
+}
+
+/**
+ * Pass the merged events to their watchers
+ *
+ * The callbacks are called without holding the lock
+ */
+void inotify_dispatcher::notify(map<watch_id, inotify_event> events) {
+  vector<pair<watch_id, event_cb>> watchers;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    for (auto&& e : events) {
+      auto w = m_watchers.find(e.first);
+      if (w == m_watchers.end() || !w->second.on_event)
+        continue;
+      watchers.emplace_back(w->first, w->second.on_event);
+      m_callbacks.enter(w->first);
+    }
+  }
+
+  for (auto&& w : watchers) {
+    m_callbacks.call(m_mutex, w.first, [&] { w.second(events[w.first]); });
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -0,0 +1,314 @@
+#include <linux/genetlink.h>
+#include <linux/nl80211.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+
+#include "components/nl80211.hpp"
+
+LEMONBUDDY_NS
+
+namespace {
+  /**
+   * Generic netlink request with room for a few attributes
+   */
+  struct genl_request {
+    nlmsghdr hdr;
+    genlmsghdr genl;
+    char attributes[64];
+
+    genl_request(uint16_t family, uint8_t cmd, uint16_t flags = 0) {
+      memset(this, 0, sizeof(*this));
+      hdr.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+      hdr.nlmsg_type = family;
+      hdr.nlmsg_flags = NLM_F_REQUEST | flags;
+      genl.cmd = cmd;
+      genl.version = 1;
+    }
+
+    void put(uint16_t type, const void* data, size_t len) {
+      netlink_util::put_attribute(&hdr, sizeof(*this), type, data, len);
+    }
+  };
+
+  /**
+   * Visit the attributes of a generic netlink message
+   */
+  void for_each_genl_attribute(
+      const nlmsghdr* msg, const netlink_util::attribute_cb& on_attribute) {
+    if (msg->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN))
+      return;
+    auto payload = reinterpret_cast<const char*>(NLMSG_DATA(msg)) + GENL_HDRLEN;
+    auto len = msg->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    netlink_util::for_each_attribute(payload, len, on_attribute);
+  }
+}
+
+/**
+ * Open the sockets, resolve the nl80211 family and
+ * subscribe to the association events
+ */
+nl80211::nl80211(const logger& logger, reactor& reactor)
+    : m_log(logger), m_reactor(reactor), m_requestbuf(32768), m_eventbuf(8192) {
+  const int type{SOCK_RAW | SOCK_CLOEXEC};
+  map<string, uint32_t> groups;
+
+  if ((m_requestfd = socket(AF_NETLINK, type, NETLINK_GENERIC)) == -1) {
+    m_log.warn("nl80211: Failed to open generic netlink socket (%s)", strerror(errno));
+    return;
+  }
+
+  // Never keep the callers waiting for a reply that got lost
+  timeval timeout{1, 0};
+  setsockopt(m_requestfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  if (!resolve_family(groups)) {
+    m_log.trace("nl80211: Family not available, falling back to wireless extensions");
+    return;
+  }
+
+  if ((m_eventfd = socket(AF_NETLINK, type | SOCK_NONBLOCK, NETLINK_GENERIC)) == -1) {
+    m_log.warn("nl80211: Failed to open event socket (%s)", strerror(errno));
+    return;
+  }
+
+  for (auto&& name : {NL80211_MULTICAST_GROUP_MLME, NL80211_MULTICAST_GROUP_SCAN}) {
+    auto group = groups.find(name);
+
+    if (group == groups.end())
+      continue;
+    if (setsockopt(m_eventfd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group->second,
+            sizeof(group->second)) == -1)
+      m_log.warn("nl80211: Failed to join multicast group %s (%s)", name, strerror(errno));
+  }
+
+  m_handler = m_reactor.add(m_eventfd, EPOLLIN, [this](uint32_t) { on_events(); });
+}
+
+/**
+ * Stop waiting for events and close the sockets
+ */
+nl80211::~nl80211() {
+  if (m_handler)
+    m_reactor.remove(m_handler);
+  if (m_eventfd != -1)
+    close(m_eventfd);
+  if (m_requestfd != -1)
+    close(m_requestfd);
+}
+
+/**
+ * Test if the kernel speaks nl80211
+ */
+bool nl80211::available() const {
+  return m_family != 0;
+}
+
+/**
+ * Get the mode and ESSID of given interface
+ *
+ * The result is cached until an event reports a change
+ */
+bool nl80211::interface(int ifindex, interface_info& info) {
+  size_t generation;
+
+  if (!available())
+    return false;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto it = m_interfaces.find(ifindex);
+
+    if (it != m_interfaces.end()) {
+      info = it->second;
+      return true;
+    }
+
+    generation = m_generation;
+  }
+
+  genl_request req{m_family, NL80211_CMD_GET_INTERFACE};
+  uint32_t index = ifindex;
+  req.put(NL80211_ATTR_IFINDEX, &index, sizeof(index));
+
+  interface_info result;
+  bool found{false};
+
+  auto replied = request(&req.hdr, [&](const nlmsghdr* msg) {
+    for_each_genl_attribute(msg, [&](const nlattr* attr) {
+      switch (netlink_util::attribute_type(attr)) {
+        case NL80211_ATTR_IFTYPE:
+          result.iftype = netlink_util::attribute_value<uint32_t>(attr);
+          found = true;
+          break;
+        case NL80211_ATTR_SSID:
+          result.ssid.assign(static_cast<const char*>(netlink_util::attribute_data(attr)),
+              netlink_util::attribute_length(attr));
+          break;
+      }
+    });
+  });
+
+  if (!replied || !found)
+    return false;
+
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  // Don't cache what an event made stale in the meantime
+  if (generation == m_generation)
+    m_interfaces[ifindex] = result;
+
+  info = move(result);
+
+  return true;
+}
+
+/**
+ * Request the signal and bitrate of the access point given interface
+ * is associated with, using a single NL80211_CMD_GET_STATION
+ */
+bool nl80211::station(int ifindex, station_info& info) {
+  if (!available())
+    return false;
+
+  genl_request req{m_family, NL80211_CMD_GET_STATION, NLM_F_DUMP};
+  uint32_t index = ifindex;
+  req.put(NL80211_ATTR_IFINDEX, &index, sizeof(index));
+
+  bool found{false};
+
+  auto replied = request(&req.hdr, [&](const nlmsghdr* msg) {
+    // Interfaces in station mode only know the access point
+    if (found)
+      return;
+
+    for_each_genl_attribute(msg, [&](const nlattr* attr) {
+      if (netlink_util::attribute_type(attr) != NL80211_ATTR_STA_INFO)
+        return;
+
+      found = true;
+
+      netlink_util::for_each_nested(attr, [&](const nlattr* sta) {
+        switch (netlink_util::attribute_type(sta)) {
+          case NL80211_STA_INFO_SIGNAL:
+            info.signal = netlink_util::attribute_value<int8_t>(sta);
+            info.has_signal = true;
+            break;
+          case NL80211_STA_INFO_TX_BITRATE:
+            netlink_util::for_each_nested(sta, [&](const nlattr* rate) {
+              auto type = netlink_util::attribute_type(rate);
+              if (type == NL80211_RATE_INFO_BITRATE32)
+                info.bitrate = netlink_util::attribute_value<uint32_t>(rate);
+              else if (type == NL80211_RATE_INFO_BITRATE && info.bitrate == 0)
+                info.bitrate = netlink_util::attribute_value<uint16_t>(rate);
+            });
+            break;
+        }
+      });
+    });
+  });
+
+  return replied && found;
+}
+
+/**
+ * Look up the id of the nl80211 family and its multicast groups
+ */
+bool nl80211::resolve_family(map<string, uint32_t>& groups) {
+  genl_request req{GENL_ID_CTRL, CTRL_CMD_GETFAMILY};
+  req.put(CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME, sizeof(NL80211_GENL_NAME));
+
+  uint16_t family{0};
+
+  auto replied = request(&req.hdr, [&](const nlmsghdr* msg) {
+    for_each_genl_attribute(msg, [&](const nlattr* attr) {
+      auto type = netlink_util::attribute_type(attr);
+
+      if (type == CTRL_ATTR_FAMILY_ID) {
+        family = netlink_util::attribute_value<uint16_t>(attr);
+      } else if (type == CTRL_ATTR_MCAST_GROUPS) {
+        netlink_util::for_each_nested(attr, [&](const nlattr* entry) {
+          string name;
+          uint32_t id{0};
+
+          netlink_util::for_each_nested(entry, [&](const nlattr* field) {
+            auto type = netlink_util::attribute_type(field);
+            auto data = static_cast<const char*>(netlink_util::attribute_data(field));
+            if (type == CTRL_ATTR_MCAST_GRP_NAME)
+              name.assign(data, strnlen(data, netlink_util::attribute_length(field)));
+            else if (type == CTRL_ATTR_MCAST_GRP_ID)
+              id = netlink_util::attribute_value<uint32_t>(field);
+          });
+
+          if (!name.empty())
+            groups[name] = id;
+        });
+      }
+    });
+  });
+
+  m_family = replied ? family : 0;
+
+  return m_family != 0;
+}
+
+/**
+ * Send request and pass the messages of the reply to given callback
+ */
+bool nl80211::request(nlmsghdr* req, const netlink_util::message_cb& on_message) {
+  std::lock_guard<std::mutex> guard(m_requestlock);
+
+  if (netlink_util::request(m_requestfd, req, m_requestbuf, on_message))
+    return true;
+
+  m_log.trace("nl80211: Request failed (%s)", strerror(errno));
+
+  return false;
+}
+
+/**
+ * Reactor callback: forget the cached state of the interfaces
+ * whose association changed
+ */
+void nl80211::on_events() {
+  while (true) {
+    auto len = recv(m_eventfd, m_eventbuf.data(), m_eventbuf.size(), 0);
+
+    if (len == -1 && errno == EINTR) {
+      continue;
+    } else if (len == -1 && errno == ENOBUFS) {
+      // Events got dropped, so nothing cached can be trusted
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_interfaces.clear();
+      m_generation++;
+      continue;
+    } else if (len <= 0) {
+      break;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto msg = reinterpret_cast<const nlmsghdr*>(m_eventbuf.data());
+
+    for (; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+      if (msg->nlmsg_type != m_family)
+        continue;
+
+      for_each_genl_attribute(msg, [&](const nlattr* attr) {
+        if (netlink_util::attribute_type(attr) != NL80211_ATTR_IFINDEX)
+          return;
+
+        auto ifindex = netlink_util::attribute_value<uint32_t>(attr);
+
+        m_log.trace("nl80211: Event %i on interface %i",
+            reinterpret_cast<const genlmsghdr*>(NLMSG_DATA(msg))->cmd, ifindex);
+
+        m_interfaces.erase(ifindex);
+        m_generation++;
+      });
+    }
+  }
+}
+
+LEMONBUDDY_NS_END
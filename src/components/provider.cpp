@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstring>
+
+#include "components/provider.hpp"
+#include "config.hpp"
+#include "utils/file.hpp"
+
+LEMONBUDDY_NS
+
+namespace providers {
+  /**
+   * Create reader for the times spent by each core
+   */
+  function<bool(cpu_sample&)> cpu_times_reader() {
+    auto reader = make_shared<file_util::file_reader>(PATH_CPU_INFO, 4096);
+    auto cores = make_shared<size_t>(0);
+
+    return [reader, cores](cpu_sample& sample) {
+      if (!reader->read())
+        return false;
+
+      sample.cores.reserve(*cores);
+
+      for (auto pos = reader->begin(), end = reader->end(); pos < end;) {
+        auto eol = std::find(pos, end, '\n');
+
+        if (eol - pos < 4 || strncmp(pos, "cpu", 3) != 0)
+          break;
+
+        // skip line with accumulated value
+        if (pos[3] == ' ') {
+          pos = eol + 1;
+          continue;
+        }
+
+        unsigned long long index;
+        auto values = file_util::parse_uint(pos + 3, eol, index);
+
+        cpu_time core;
+
+        if (values != nullptr && (values = file_util::parse_uint(values, eol, core.user)) &&
+            (values = file_util::parse_uint(values, eol, core.nice)) &&
+            (values = file_util::parse_uint(values, eol, core.system)) &&
+            (values = file_util::parse_uint(values, eol, core.idle))) {
+          core.total = core.user + core.nice + core.system + core.idle;
+          sample.cores.emplace_back(core);
+        }
+
+        pos = eol + 1;
+      }
+
+      *cores = sample.cores.size();
+
+      return !sample.cores.empty();
+    };
+  }
+
+  /**
+   * Create reader for the memory statistics
+   */
+  function<bool(meminfo_sample&)> meminfo_reader() {
+    auto reader = make_shared<file_util::file_reader>(PATH_MEMORY_INFO, 4096);
+
+    return [reader](meminfo_sample& sample) {
+      if (!reader->read())
+        return false;
+
+      const auto key = [](const char* pos, const char* end, const char* name) {
+        auto len = strlen(name);
+        return static_cast<size_t>(end - pos) > len && strncmp(pos, name, len) == 0 &&
+               pos[len] == ':';
+      };
+
+      for (auto pos = reader->begin(), end = reader->end(); pos < end;) {
+        auto eol = std::find(pos, end, '\n');
+        auto sep = std::find(pos, eol, ':');
+
+        if (key(pos, eol, "MemTotal"))
+          file_util::parse_uint(sep + 1, eol, sample.total);
+        else if (key(pos, eol, "MemFree"))
+          file_util::parse_uint(sep + 1, eol, sample.free);
+        else if (key(pos, eol, "MemAvailable"))
+          file_util::parse_uint(sep + 1, eol, sample.available);
+
+        pos = eol + 1;
+      }
+
+      return sample.total > 0;
+    };
+  }
+
+}
+
+LEMONBUDDY_NS_END
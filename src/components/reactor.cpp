@@ -0,0 +1,195 @@
+#include <sys/eventfd.h>
+
+#include "components/reactor.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Construct reactor and start the dispatch thread
+ */
+reactor::reactor(const logger& logger) : m_log(logger) {
+  if ((m_epollfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    throw system_error("Failed to create epoll instance");
+  if ((m_eventfd = eventfd(0, EFD_CLOEXEC)) == -1)
+    throw system_error("Failed to create eventfd");
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = 0;
+
+  if (epoll_ctl(m_epollfd, EPOLL_CTL_ADD, m_eventfd, &event) == -1)
+    throw system_error("Failed to add eventfd to epoll instance");
+
+  m_thread = thread(&reactor::dispatch, this);
+}
+
+/**
+ * Stop and join the dispatch thread
+ */
+reactor::~reactor() {
+  m_running = false;
+
+  uint64_t value{1};
+  if (write(m_eventfd, &value, sizeof(value)) == -1)
+    m_log.err("reactor: Failed to notify dispatch thread (%s)", strerror(errno));
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+  close(m_eventfd);
+  close(m_epollfd);
+}
+
+/**
+ * Register handler for given file descriptor
+ *
+ * @param events Epoll event mask, i.e: EPOLLIN
+ */
+reactor::handler_id reactor::add(int fd, uint32_t events, handler_t&& callback) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto id = m_nextid++;
+
+  epoll_event event{};
+  event.events = events;
+  event.data.u64 = id;
+
+  if (epoll_ctl(m_epollfd, EPOLL_CTL_ADD, fd, &event) == -1)
+    throw system_error("Failed to add file descriptor " + to_string(fd) + " to epoll instance");
+
+  // Drop the handlers whose descriptor got closed without removing them
+  // first, they would otherwise remove the registration of the reused number
+  for (auto it = m_handlers.begin(); it != m_handlers.end();) {
+    if (it->second.fd != fd) {
+      it++;
+    } else if (it->second.running) {
+      it->second.fd = -1;
+      it++;
+    } else {
+      it = m_handlers.erase(it);
+    }
+  }
+
+  auto& h = m_handlers[id];
+  h.fd = fd;
+  h.callback = forward<handler_t>(callback);
+
+  m_log.trace("reactor: Added handler for fd %i (id: %lu)", fd, id);
+
+  return id;
+}
+
+/**
+ * Change the event mask of given handler
+ */
+void reactor::modify(handler_id id, uint32_t events) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto it = m_handlers.find(id);
+
+  if (it == m_handlers.end())
+    return;
+
+  epoll_event event{};
+  event.events = events;
+  event.data.u64 = id;
+
+  if (epoll_ctl(m_epollfd, EPOLL_CTL_MOD, it->second.fd, &event) == -1)
+    throw system_error("Failed to modify epoll event mask");
+}
+
+/**
+ * Remove handler
+ *
+ * The descriptor is allowed to be closed already. If the handler is
+ * currently running this blocks until it returns, unless called from
+ * within the handler itself
+ */
+void reactor::remove(handler_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_handlers.find(id);
+
+  if (it == m_handlers.end())
+    return;
+
+  // Closed descriptors are removed from the epoll set automatically
+  if (epoll_ctl(m_epollfd, EPOLL_CTL_DEL, it->second.fd, nullptr) == -1 && errno != EBADF &&
+      errno != ENOENT)
+    m_log.err("reactor: Failed to remove fd %i (%s)", it->second.fd, strerror(errno));
+
+  m_log.trace("reactor: Removed handler for fd %i (id: %lu)", it->second.fd, id);
+
+  if (!it->second.running) {
+    m_handlers.erase(it);
+  } else if (it->second.runner != this_thread::get_id()) {
+    it->second.fd = -1;
+    m_finished.wait(guard, [&] { return m_handlers.find(id) == m_handlers.end(); });
+  } else {
+    it->second.fd = -1;
+  }
+}
+
+/**
+ * Get the amount of registered handlers
+ */
+size_t reactor::size() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_handlers.size();
+}
+
+/**
+ * Dispatch thread: wait for the descriptors to become ready and call their handlers
+ */
+void reactor::dispatch() {
+  epoll_event events[32];
+
+  while (m_running) {
+    int count = epoll_wait(m_epollfd, events, 32, -1);
+
+    if (count == -1) {
+      if (errno == EINTR)
+        continue;
+      m_log.err("reactor: Failed to wait for events (%s)", strerror(errno));
+      break;
+    }
+
+    for (int i = 0; i < count && m_running; i++) {
+      auto id = events[i].data.u64;
+
+      if (id == 0)
+        continue;
+
+      std::unique_lock<std::mutex> guard(m_mutex);
+
+      auto it = m_handlers.find(id);
+
+      // Skip handlers removed while processing the previous events
+      if (it == m_handlers.end() || it->second.fd == -1)
+        continue;
+
+      auto& h = it->second;
+      h.running = true;
+      h.runner = this_thread::get_id();
+
+      guard.unlock();
+
+      try {
+        h.callback(events[i].events);
+      } catch (const std::exception& err) {
+        m_log.err("reactor: Uncaught exception in handler (%s)", err.what());
+      }
+
+      guard.lock();
+
+      h.running = false;
+
+      if (h.fd == -1) {
+        m_handlers.erase(it);
+        m_finished.notify_all();
+      }
+    }
+  }
+}
+
+LEMONBUDDY_NS_END
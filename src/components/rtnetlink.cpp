@@ -0,0 +1,401 @@
+#include <arpa/inet.h>
+#include <linux/if.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "components/rtnetlink.hpp"
+#include "utils/netlink.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Test if the link is operational, i.e. ready to pass packets
+ */
+bool rtnetlink::link_state::up() const {
+  return valid && operstate == IF_OPER_UP;
+}
+
+/**
+ * Open the event and request sockets and wait for events in the reactor
+ */
+rtnetlink::rtnetlink(const logger& logger, reactor& reactor)
+    : m_log(logger), m_reactor(reactor), m_eventbuf(32768), m_requestbuf(32768) {
+  const int type{SOCK_RAW | SOCK_CLOEXEC};
+
+  if ((m_eventfd = socket(AF_NETLINK, type | SOCK_NONBLOCK, NETLINK_ROUTE)) == -1)
+    throw system_error("Failed to open rtnetlink socket");
+
+  sockaddr_nl addr{};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+
+  if (bind(m_eventfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+    close(m_eventfd);
+    throw system_error("Failed to subscribe to rtnetlink events");
+  }
+
+  if ((m_requestfd = socket(AF_NETLINK, type, NETLINK_ROUTE)) == -1) {
+    close(m_eventfd);
+    throw system_error("Failed to open rtnetlink socket");
+  }
+
+  // Never keep the callers waiting for a reply that got lost
+  timeval timeout{1, 0};
+  setsockopt(m_requestfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  m_handler = m_reactor.add(m_eventfd, EPOLLIN, [this](uint32_t) { on_events(); });
+}
+
+/**
+ * Stop waiting for events and close the sockets
+ */
+rtnetlink::~rtnetlink() {
+  m_reactor.remove(m_handler);
+  close(m_requestfd);
+  close(m_eventfd);
+}
+
+/**
+ * Keep track of the state of given interface
+ *
+ * The callback is called from the reactor thread whenever the
+ * operational state, the flags or the address of the interface change
+ */
+rtnetlink::watch_id rtnetlink::watch(int ifindex, state_cb&& on_change) {
+  watch_id id;
+  bool known;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    id = m_nextid++;
+    m_watchers.emplace(id, watcher{ifindex, forward<state_cb>(on_change)});
+
+    // Start tracking the events of the interface before asking for its state
+    known = m_links.find(ifindex) != m_links.end();
+    m_links[ifindex];
+  }
+
+  m_log.trace("rtnetlink: Watching interface %i (id: %lu)", ifindex, id);
+
+  if (!known)
+    refresh(ifindex);
+
+  return id;
+}
+
+/**
+ * Remove watcher
+ *
+ * Once this returns the callback of the watcher won't be called anymore,
+ * so it must not be called while holding a lock the callback takes
+ */
+void rtnetlink::unwatch(watch_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_watchers.find(id);
+
+  if (it == m_watchers.end())
+    return;
+
+  auto ifindex = it->second.ifindex;
+  m_watchers.erase(it);
+
+  // Forget the state of the interfaces nobody is watching anymore
+  if (find_if(m_watchers.begin(), m_watchers.end(), [&](const auto& w) {
+        return w.second.ifindex == ifindex;
+      }) == m_watchers.end())
+    m_links.erase(ifindex);
+
+  m_callbacks.wait(guard, id);
+}
+
+/**
+ * Get the last known state of given interface
+ */
+rtnetlink::link_state rtnetlink::state(int ifindex) const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto it = m_links.find(ifindex);
+  return it != m_links.end() ? it->second : link_state{};
+}
+
+/**
+ * Request the traffic counters of given interface
+ */
+bool rtnetlink::counters(int ifindex, link_counters& counters) {
+  struct {
+    nlmsghdr hdr;
+    ifinfomsg ifi;
+  } req{};
+
+  req.hdr.nlmsg_len = sizeof(req);
+  req.hdr.nlmsg_type = RTM_GETLINK;
+  req.hdr.nlmsg_flags = NLM_F_REQUEST;
+  req.ifi.ifi_family = AF_UNSPEC;
+  req.ifi.ifi_index = ifindex;
+
+  bool found{false};
+
+  auto replied = request(&req.hdr, [&](const nlmsghdr* msg) {
+    found = parse_link(msg, nullptr, &counters) == ifindex || found;
+  });
+
+  return replied && found;
+}
+
+/**
+ * Get the amount of watchers
+ */
+size_t rtnetlink::size() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_watchers.size();
+}
+
+/**
+ * Reactor callback: apply the changes to the watched interfaces
+ */
+void rtnetlink::on_events() {
+  vector<int> changed;
+  vector<int> stale;
+  bool overflow{false};
+
+  while (true) {
+    auto len = recv(m_eventfd, m_eventbuf.data(), m_eventbuf.size(), 0);
+
+    if (len == -1 && errno == EINTR) {
+      continue;
+    } else if (len == -1 && errno == ENOBUFS) {
+      overflow = true;
+      continue;
+    } else if (len <= 0) {
+      break;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto msg = reinterpret_cast<const nlmsghdr*>(m_eventbuf.data());
+
+    for (; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+      link_state update;
+      string ip;
+      int ifindex;
+
+      if ((ifindex = parse_link(msg, &update, nullptr)) != 0) {
+        auto it = m_links.find(ifindex);
+
+        if (it == m_links.end())
+          continue;
+
+        update.ip = update.valid ? it->second.ip : "";
+
+        if (update != it->second) {
+          it->second = move(update);
+          changed.emplace_back(ifindex);
+        }
+      } else if ((ifindex = parse_address(msg, ip)) != 0) {
+        auto it = m_links.find(ifindex);
+
+        if (it == m_links.end())
+          continue;
+
+        if (msg->nlmsg_type == RTM_NEWADDR && it->second.ip != ip) {
+          it->second.ip = move(ip);
+          changed.emplace_back(ifindex);
+        } else if (msg->nlmsg_type == RTM_DELADDR && it->second.ip == ip &&
+                   find(stale.begin(), stale.end(), ifindex) == stale.end()) {
+          // The interface may still have another address
+          stale.emplace_back(ifindex);
+        }
+      }
+    }
+  }
+
+  // Events got dropped, so the state has to be requested again
+  if (overflow) {
+    m_log.warn("rtnetlink: Event queue overflowed, refreshing interface state");
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    stale.clear();
+    for (auto&& link : m_links) stale.emplace_back(link.first);
+  }
+
+  for (auto&& ifindex : stale) {
+    if (refresh(ifindex))
+      changed.emplace_back(ifindex);
+  }
+
+  if (!changed.empty())
+    notify(move(changed));
+}
+
+/**
+ * Request the state and the address of given interface
+ *
+ * @return True if the state changed
+ */
+bool rtnetlink::refresh(int ifindex) {
+  struct {
+    nlmsghdr hdr;
+    ifinfomsg ifi;
+  } link_req{};
+
+  link_req.hdr.nlmsg_len = sizeof(link_req);
+  link_req.hdr.nlmsg_type = RTM_GETLINK;
+  link_req.hdr.nlmsg_flags = NLM_F_REQUEST;
+  link_req.ifi.ifi_family = AF_UNSPEC;
+  link_req.ifi.ifi_index = ifindex;
+
+  struct {
+    nlmsghdr hdr;
+    ifaddrmsg ifa;
+  } addr_req{};
+
+  addr_req.hdr.nlmsg_len = sizeof(addr_req);
+  addr_req.hdr.nlmsg_type = RTM_GETADDR;
+  addr_req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  addr_req.ifa.ifa_family = AF_INET;
+
+  link_state state;
+
+  request(&link_req.hdr, [&](const nlmsghdr* msg) { parse_link(msg, &state, nullptr); });
+
+  // The kernel dumps the addresses of all interfaces
+  request(&addr_req.hdr, [&](const nlmsghdr* msg) {
+    string ip;
+    if (parse_address(msg, ip) == ifindex && state.ip.empty())
+      state.ip = move(ip);
+  });
+
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto link = m_links.find(ifindex);
+
+  // Nobody is watching the interface anymore
+  if (link == m_links.end() || link->second == state)
+    return false;
+
+  link->second = move(state);
+
+  return true;
+}
+
+/**
+ * Send request and pass the messages of the reply to given callback
+ */
+bool rtnetlink::request(nlmsghdr* req, callback<const nlmsghdr*> on_message) {
+  std::lock_guard<std::mutex> guard(m_requestlock);
+
+  if (netlink_util::request(m_requestfd, req, m_requestbuf, on_message))
+    return true;
+
+  m_log.trace("rtnetlink: Request failed (%s)", strerror(errno));
+
+  return false;
+}
+
+/**
+ * Read the state and counters from a link message
+ *
+ * @return Index of the interface, or 0 if it's not a link message
+ */
+int rtnetlink::parse_link(const nlmsghdr* msg, link_state* state, link_counters* counters) const {
+  if (msg->nlmsg_type != RTM_NEWLINK && msg->nlmsg_type != RTM_DELLINK)
+    return 0;
+
+  auto ifi = reinterpret_cast<const ifinfomsg*>(NLMSG_DATA(msg));
+  auto len = static_cast<int>(IFLA_PAYLOAD(msg));
+  bool has_stats64{false};
+
+  if (state != nullptr) {
+    state->valid = msg->nlmsg_type == RTM_NEWLINK;
+    state->flags = ifi->ifi_flags;
+  }
+
+  for (auto rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+    if (rta->rta_type == IFLA_OPERSTATE && state != nullptr) {
+      state->operstate = *reinterpret_cast<const uint8_t*>(RTA_DATA(rta));
+    } else if (rta->rta_type == IFLA_STATS64 && counters != nullptr) {
+      rtnl_link_stats64 stats{};
+      memcpy(&stats, RTA_DATA(rta), std::min<size_t>(sizeof(stats), RTA_PAYLOAD(rta)));
+      counters->transmitted = stats.tx_bytes;
+      counters->received = stats.rx_bytes;
+      has_stats64 = true;
+    } else if (rta->rta_type == IFLA_STATS && counters != nullptr && !has_stats64) {
+      rtnl_link_stats stats{};
+      memcpy(&stats, RTA_DATA(rta), std::min<size_t>(sizeof(stats), RTA_PAYLOAD(rta)));
+      counters->transmitted = stats.tx_bytes;
+      counters->received = stats.rx_bytes;
+    }
+  }
+
+  return ifi->ifi_index;
+}
+
+/**
+ * Read the IPv4 address from an address message
+ *
+ * @return Index of the interface, or 0 if it's not an IPv4 address message
+ */
+int rtnetlink::parse_address(const nlmsghdr* msg, string& ip) const {
+  if (msg->nlmsg_type != RTM_NEWADDR && msg->nlmsg_type != RTM_DELADDR)
+    return 0;
+
+  auto ifa = reinterpret_cast<const ifaddrmsg*>(NLMSG_DATA(msg));
+  auto len = static_cast<int>(IFA_PAYLOAD(msg));
+
+  if (ifa->ifa_family != AF_INET)
+    return 0;
+
+  const void* address{nullptr};
+
+  // IFA_LOCAL differs from IFA_ADDRESS on point-to-point links, where
+  // the latter is the address of the other end
+  for (auto rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+    if (rta->rta_type == IFA_LOCAL)
+      address = RTA_DATA(rta);
+    else if (rta->rta_type == IFA_ADDRESS && address == nullptr)
+      address = RTA_DATA(rta);
+  }
+
+  char buffer[INET_ADDRSTRLEN];
+
+  if (address == nullptr || inet_ntop(AF_INET, address, buffer, sizeof(buffer)) == nullptr)
+    return 0;
+
+  ip = buffer;
+
+  return ifa->ifa_index;
+}
+
+/**
+ * Pass the state of the changed interfaces to their watchers
+ *
+ * The callbacks are called without holding the lock
+ */
+void rtnetlink::notify(vector<int> changed) {
+  vector<pair<watch_id, watcher>> watchers;
+  map<int, link_state> states;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    for (auto&& w : m_watchers) {
+      if (!w.second.on_change ||
+          find(changed.begin(), changed.end(), w.second.ifindex) == changed.end())
+        continue;
+      watchers.emplace_back(w);
+      states[w.second.ifindex] = m_links[w.second.ifindex];
+      m_callbacks.enter(w.first);
+    }
+  }
+
+  for (auto&& w : watchers) {
+    m_callbacks.call(m_mutex, w.first, [&] { w.second.on_change(states[w.second.ifindex]); });
+  }
+}
+
+LEMONBUDDY_NS_END
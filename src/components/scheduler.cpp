@@ -0,0 +1,416 @@
+#include <sys/eventfd.h>
+#include <sys/poll.h>
+#include <sys/timerfd.h>
+
+#include "components/scheduler.hpp"
+
+LEMONBUDDY_NS
+
+// timer_wheel {{{
+
+constexpr size_t timer_wheel::LEVELS;
+constexpr size_t timer_wheel::SLOT_BITS;
+constexpr size_t timer_wheel::SLOTS;
+
+/**
+ * Add entry with given deadline
+ *
+ * Deadlines that have already passed expire on the next advance
+ */
+void timer_wheel::insert(size_t id, uint64_t deadline) {
+  place(entry{id, deadline});
+  m_size++;
+}
+
+/**
+ * Advance the wheel up to given tick and collect the ids of all expired entries
+ */
+void timer_wheel::advance(uint64_t tick, vector<size_t>& expired) {
+  const uint64_t mask{SLOTS - 1};
+
+  collect(m_slots[0][m_current & mask], expired);
+
+  while (m_current < tick) {
+    uint64_t next;
+
+    // Skip ahead, the slots in between are empty
+    if (!next_expiry(next) || next > tick) {
+      m_current = tick;
+      break;
+    }
+
+    m_current = std::max(next, m_current + 1);
+
+    if ((m_current & ((uint64_t{1} << (SLOT_BITS * LEVELS)) - 1)) == 0)
+      cascade(m_overflow);
+
+    for (size_t level = LEVELS - 1; level > 0; level--) {
+      auto shift = SLOT_BITS * level;
+      if ((m_current & ((uint64_t{1} << shift) - 1)) == 0)
+        cascade(m_slots[level][(m_current >> shift) & mask]);
+    }
+
+    collect(m_slots[0][m_current & mask], expired);
+  }
+}
+
+/**
+ * Get the tick at which the wheel needs to be advanced next
+ *
+ * For entries on the higher levels this is the tick at which
+ * they get cascaded, which is never later than their deadline
+ *
+ * @return false if the wheel is empty
+ */
+bool timer_wheel::next_expiry(uint64_t& tick) const {
+  const uint64_t mask{SLOTS - 1};
+
+  if (m_size == 0)
+    return false;
+
+  for (auto slot = m_current & mask; slot < SLOTS; slot++) {
+    if (!m_slots[0][slot].empty()) {
+      tick = (m_current & ~mask) | slot;
+      return true;
+    }
+  }
+
+  for (size_t level = 1; level < LEVELS; level++) {
+    auto shift = SLOT_BITS * level;
+
+    for (auto slot = ((m_current >> shift) & mask) + 1; slot < SLOTS; slot++) {
+      if (!m_slots[level][slot].empty()) {
+        tick = ((m_current >> (shift + SLOT_BITS)) << (shift + SLOT_BITS)) | (slot << shift);
+        return true;
+      }
+    }
+  }
+
+  tick = ((m_current >> (SLOT_BITS * LEVELS)) + 1) << (SLOT_BITS * LEVELS);
+  return true;
+}
+
+/**
+ * Get the current tick
+ */
+uint64_t timer_wheel::current() const {
+  return m_current;
+}
+
+/**
+ * Get the amount of entries in the wheel
+ */
+size_t timer_wheel::size() const {
+  return m_size;
+}
+
+/**
+ * Store entry on the level matching its distance to the current tick
+ */
+void timer_wheel::place(const entry& e) {
+  auto diff = e.deadline > m_current ? e.deadline ^ m_current : 0;
+  size_t level{0};
+
+  while (level < LEVELS && (diff >> (SLOT_BITS * (level + 1))) != 0) level++;
+
+  if (level == LEVELS)
+    m_overflow.emplace_back(e);
+  else if (diff == 0)
+    m_slots[0][m_current & (SLOTS - 1)].emplace_back(e);
+  else
+    m_slots[level][(e.deadline >> (SLOT_BITS * level)) & (SLOTS - 1)].emplace_back(e);
+}
+
+/**
+ * Move the entries of given slot to the lower levels
+ */
+void timer_wheel::cascade(vector<entry>& slot) {
+  vector<entry> entries;
+  entries.swap(slot);
+
+  for (auto&& e : entries) {
+    place(e);
+  }
+}
+
+/**
+ * Expire all entries in given slot
+ */
+void timer_wheel::collect(vector<entry>& slot, vector<size_t>& expired) {
+  for (auto&& e : slot) {
+    expired.emplace_back(e.id);
+  }
+
+  m_size -= slot.size();
+  slot.clear();
+}
+
+// }}}
+// scheduler {{{
+
+constexpr chrono::seconds scheduler::STATS_INTERVAL;
+
+/**
+ * Construct scheduler and start the timer and worker threads
+ */
+scheduler::scheduler(const logger& logger, size_t workers, chrono::milliseconds slack)
+    : m_log(logger), m_slack(slack) {
+  if ((m_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) == -1)
+    throw system_error("Failed to create timerfd");
+  if ((m_eventfd = eventfd(0, EFD_CLOEXEC)) == -1)
+    throw system_error("Failed to create eventfd");
+
+  m_threads.emplace_back(&scheduler::dispatch, this);
+
+  for (size_t i = 0; i < workers; i++) {
+    m_threads.emplace_back(&scheduler::work, this);
+  }
+
+  m_log.trace("scheduler: Started %lu threads (slack: %lims)", m_threads.size(), slack.count());
+}
+
+/**
+ * Stop and join the threads
+ */
+scheduler::~scheduler() {
+  m_running = false;
+
+  uint64_t value{1};
+  if (write(m_eventfd, &value, sizeof(value)) == -1)
+    m_log.err("scheduler: Failed to notify timer thread (%s)", strerror(errno));
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_queued.notify_all();
+  }
+
+  for (auto&& thread_ : m_threads) {
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  m_log.info("scheduler: %lu threads, %.2f wakeups/s", thread_count(), wakeups_per_second());
+
+  close(m_timerfd);
+  close(m_eventfd);
+}
+
+/**
+ * Run task periodically, starting right away
+ */
+scheduler::timer_id scheduler::every(clock::duration interval, task_t&& task) {
+  if (interval <= clock::duration::zero())
+    throw application_error("Timer interval needs to be positive");
+  return add(clock::now(), interval, forward<task_t>(task));
+}
+
+/**
+ * Run task once after given delay
+ */
+scheduler::timer_id scheduler::once(clock::duration delay, task_t&& task) {
+  return add(clock::now() + delay, clock::duration::zero(), forward<task_t>(task));
+}
+
+/**
+ * Cancel timer
+ *
+ * If the task is currently running this blocks until it returns,
+ * unless called from within the task itself
+ */
+void scheduler::cancel(timer_id id) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_timers.find(id);
+
+  if (it == m_timers.end()) {
+    return;
+  } else if (!it->second.running) {
+    m_timers.erase(it);
+    return;
+  }
+
+  it->second.cancelled = true;
+
+  if (it->second.runner != this_thread::get_id())
+    m_finished.wait(guard, [&] { return m_timers.find(id) == m_timers.end(); });
+}
+
+/**
+ * Get the amount of threads owned by the scheduler
+ */
+size_t scheduler::thread_count() const {
+  return m_threads.size();
+}
+
+/**
+ * Get the average amount of times per second the timer thread woke up
+ */
+double scheduler::wakeups_per_second() const {
+  chrono::duration<double> uptime{clock::now() - m_epoch};
+  return uptime.count() > 0 ? m_wakeups / uptime.count() : 0;
+}
+
+/**
+ * Add timer and rearm the timerfd in case it's the next one to expire
+ */
+scheduler::timer_id scheduler::add(
+    clock::time_point deadline, clock::duration interval, task_t&& task) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto id = m_nextid++;
+  auto& t = m_timers[id];
+
+  t.deadline = deadline;
+  t.interval = interval;
+  t.task = forward<task_t>(task);
+
+  m_wheel.insert(id, to_tick(deadline, true));
+  arm();
+
+  return id;
+}
+
+/**
+ * Convert time point to wheel ticks (milliseconds since the scheduler was created)
+ */
+uint64_t scheduler::to_tick(clock::time_point point, bool round_up) const {
+  if (point <= m_epoch)
+    return 0;
+
+  auto us = chrono::duration_cast<chrono::microseconds>(point - m_epoch).count();
+  return (us + (round_up ? 999 : 0)) / 1000;
+}
+
+/**
+ * Set the timerfd to expire when the wheel needs to be advanced next
+ *
+ * Assumes that the steady clock is CLOCK_MONOTONIC, which is
+ * the case for all supported standard libraries on Linux
+ */
+void scheduler::arm() {
+  itimerspec spec{};
+  uint64_t tick;
+
+  if (m_wheel.next_expiry(tick)) {
+    auto expiry = (m_epoch + chrono::milliseconds{tick}).time_since_epoch();
+    auto ns = std::max<int64_t>(1, chrono::duration_cast<chrono::nanoseconds>(expiry).count());
+    spec.it_value.tv_sec = ns / 1000000000;
+    spec.it_value.tv_nsec = ns % 1000000000;
+  }
+
+  if (timerfd_settime(m_timerfd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1)
+    m_log.err("scheduler: Failed to arm timerfd (%s)", strerror(errno));
+}
+
+/**
+ * Timer thread: wait for the timerfd to expire and queue the timers
+ * that are due within the slack window
+ *
+ * The amount of threads and wakeups is reported once per STATS_INTERVAL,
+ * on a wakeup that happens anyway, so that an idle scheduler stays idle
+ */
+void scheduler::dispatch() {
+  pollfd fds[2]{{m_timerfd, POLLIN, 0}, {m_eventfd, POLLIN, 0}};
+  uint64_t value;
+  vector<size_t> expired;
+  auto reported = m_epoch;
+  size_t reported_wakeups{0};
+
+  while (m_running) {
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR)
+        continue;
+      m_log.err("scheduler: Failed to poll timerfd (%s)", strerror(errno));
+      break;
+    }
+
+    if (!m_running)
+      break;
+
+    // The expiration count gets reset if the timer is rearmed in the meantime
+    if (fds[0].revents & POLLIN && read(m_timerfd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+      m_log.err("scheduler: Failed to read timerfd (%s)", strerror(errno));
+
+    auto wakeups = ++m_wakeups;
+    auto now = clock::now();
+
+    if (now - reported >= STATS_INTERVAL) {
+      chrono::duration<double> elapsed{now - reported};
+      m_log.trace("scheduler: %lu threads, %.2f wakeups/s", thread_count(),
+          (wakeups - reported_wakeups) / elapsed.count());
+      reported = now;
+      reported_wakeups = wakeups;
+    }
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    {
+      expired.clear();
+      m_wheel.advance(to_tick(clock::now() + m_slack), expired);
+
+      for (auto&& id : expired) {
+        if (m_timers.find(id) != m_timers.end())
+          m_queue.emplace_back(id);
+      }
+
+      if (!m_queue.empty())
+        m_queued.notify_all();
+
+      arm();
+    }
+  }
+}
+
+/**
+ * Worker thread: run queued timers and reschedule the periodic ones
+ */
+void scheduler::work() {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  while (true) {
+    m_queued.wait(guard, [&] { return !m_running || !m_queue.empty(); });
+
+    if (!m_running)
+      break;
+
+    auto it = m_timers.find(m_queue.front());
+    m_queue.pop_front();
+
+    if (it == m_timers.end())
+      continue;
+
+    auto& t = it->second;
+    t.running = true;
+    t.runner = this_thread::get_id();
+
+    guard.unlock();
+
+    try {
+      t.task();
+    } catch (const std::exception& err) {
+      m_log.err("scheduler: Uncaught exception in timer task (%s)", err.what());
+    }
+
+    guard.lock();
+
+    t.running = false;
+
+    if (t.cancelled || t.interval == clock::duration::zero()) {
+      m_timers.erase(it);
+      m_finished.notify_all();
+      continue;
+    }
+
+    // Skip the deadlines that were missed while the task was running
+    auto now = clock::now();
+    t.deadline += t.interval;
+    if (t.deadline < now)
+      t.deadline += ((now - t.deadline) / t.interval + 1) * t.interval;
+
+    m_wheel.insert(it->first, to_tick(t.deadline, true));
+    arm();
+  }
+}
+
+// }}}
+
+LEMONBUDDY_NS_END
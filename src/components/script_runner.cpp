@@ -0,0 +1,268 @@
+#include "components/script_runner.hpp"
+#include "utils/string.hpp"
+
+LEMONBUDDY_NS
+
+/**
+ * Construct runner
+ *
+ * @param cache Keep the last result of the commands without subscribers
+ */
+script_runner::script_runner(
+    const logger& logger, scheduler& scheduler, executor& executor, bool cache)
+    : m_log(logger), m_scheduler(scheduler), m_executor(executor), m_cache(cache) {}
+
+/**
+ * Stop the timers and the commands still running
+ */
+script_runner::~script_runner() {
+  vector<scheduler::timer_id> timers;
+  vector<executor::job_id> jobs;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stopped = true;
+    for (auto&& e : m_entries) {
+      timers.emplace_back(e.second.timer);
+      jobs.emplace_back(e.second.job);
+    }
+    for (auto&& s : m_subscriptions) {
+      timers.emplace_back(s.second.initial);
+    }
+  }
+
+  // The tasks and callbacks take the lock, so they are cancelled without holding it
+  for (auto&& id : timers) m_scheduler.cancel(id);
+  for (auto&& id : jobs) m_executor.cancel(id);
+
+  std::lock_guard<std::mutex> guard(m_mutex);
+  m_entries.clear();
+  m_subscriptions.clear();
+}
+
+/**
+ * Subscribe to the output of given command
+ *
+ * The command is started if nobody else is running it with the
+ * same interval. A result that is already known is passed to the
+ * new subscriber right away, from one of the scheduler's workers
+ */
+script_runner::subscription_id script_runner::subscribe(
+    const string& cmd, chrono::milliseconds interval, output_cb&& on_output) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto key = make_key(cmd, interval);
+  auto id = m_nextid++;
+  auto it = m_entries.find(key);
+
+  if (it == m_entries.end()) {
+    auto& e = m_entries[key];
+    e.cmd = cmd;
+    e.interval = interval;
+
+    auto cached = m_results.find(key);
+    if (cached != m_results.end()) {
+      e.last = move(cached->second);
+      m_results.erase(cached);
+    }
+
+    m_log.trace("script_runner: Starting '%s' (interval: %lims)", cmd, interval.count());
+
+    e.timer = m_scheduler.every(
+        chrono::duration_cast<scheduler::clock::duration>(interval), [this, key] { tick(key); });
+    it = m_entries.find(key);
+  } else {
+    m_log.trace("script_runner: Sharing '%s' (subscribers: %lu)", cmd,
+        it->second.subscribers.size() + 1);
+  }
+
+  auto& e = it->second;
+  auto& s = m_subscriptions[id];
+
+  e.subscribers.emplace(id, forward<output_cb>(on_output));
+  s.key = key;
+
+  if (e.last.valid)
+    s.initial = m_scheduler.once(0s, [this, key, id] { publish(key, id); });
+  if (!e.job)
+    tick_locked(e);
+
+  return id;
+}
+
+/**
+ * Remove subscription
+ *
+ * Once this returns the callback of the subscriber won't be called
+ * anymore. The command is stopped when its last subscriber leaves
+ */
+void script_runner::unsubscribe(subscription_id id) {
+  scheduler::timer_id initial{0};
+  scheduler::timer_id timer{0};
+  executor::job_id job{0};
+
+  {
+    std::unique_lock<std::mutex> guard(m_mutex);
+
+    auto sub = m_subscriptions.find(id);
+
+    if (sub == m_subscriptions.end())
+      return;
+
+    auto key = sub->second.key;
+    initial = sub->second.initial;
+    m_subscriptions.erase(sub);
+
+    auto it = m_entries.find(key);
+
+    if (it != m_entries.end()) {
+      it->second.subscribers.erase(id);
+
+      if (it->second.subscribers.empty()) {
+        m_log.trace("script_runner: Stopping '%s'", it->second.cmd);
+
+        timer = it->second.timer;
+        job = it->second.job;
+
+        if (m_cache && it->second.last.valid)
+          m_results[key] = move(it->second.last);
+
+        m_entries.erase(it);
+      }
+    }
+
+    // Wait for the output being passed to the subscriber from other threads
+    m_callbacks.wait(guard, id);
+  }
+
+  m_scheduler.cancel(initial);
+  m_scheduler.cancel(timer);
+  m_executor.cancel(job);
+}
+
+/**
+ * Get the amount of commands currently being run
+ */
+size_t script_runner::size() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_entries.size();
+}
+
+/**
+ * Commands are shared by their exact text and interval
+ */
+string script_runner::make_key(const string& cmd, chrono::milliseconds interval) {
+  return to_string(interval.count()) + ":" + cmd;
+}
+
+/**
+ * Scheduler task: run the command again
+ */
+void script_runner::tick(const string& key) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto it = m_entries.find(key);
+
+  if (it == m_entries.end() || m_stopped)
+    return;
+  else if (it->second.job && m_executor.running(it->second.job))
+    m_log.warn("script_runner: Previous shell command is still running...");
+  else
+    tick_locked(it->second);
+}
+
+/**
+ * Hand the command over to the executor
+ *
+ * Requires the lock to be held
+ */
+void script_runner::tick_locked(entry& e) {
+  auto key = make_key(e.cmd, e.interval);
+  auto exec = string_util::replace_all(e.cmd, "%counter%", to_string(e.last.counter + 1));
+  auto run = ++e.runs;
+
+  m_log.trace("script_runner: Executing '%s'", exec);
+
+  e.pending.clear();
+  e.job = m_executor.run(exec, [this, key, run](string line) { on_line(key, run, move(line)); },
+      [this, key, run](const supervisor::child_status& result) { on_exit(key, run, result); });
+}
+
+/**
+ * Executor callback: remember the last line of the output
+ */
+void script_runner::on_line(const string& key, size_t run, string line) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto it = m_entries.find(key);
+
+  if (it != m_entries.end() && it->second.runs == run)
+    it->second.pending = move(line);
+}
+
+/**
+ * Executor callback: store the result and pass it to the subscribers
+ */
+void script_runner::on_exit(
+    const string& key, size_t run, const supervisor::child_status& result) {
+  auto cpu = chrono::duration_cast<chrono::milliseconds>(result.utime + result.stime);
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto it = m_entries.find(key);
+
+    // Ignore the commands of a previous subscription to the same command
+    if (it == m_entries.end() || it->second.runs != run)
+      return;
+
+    auto& e = it->second;
+
+    m_log.trace("script_runner: '%s' exited with status %i (cpu: %lims, maxrss: %likB)", e.cmd,
+        result.status, cpu.count(), result.maxrss);
+
+    e.last.output = move(e.pending);
+    e.last.counter++;
+    e.last.valid = true;
+    e.pending.clear();
+  }
+
+  publish(key);
+}
+
+/**
+ * Pass the last result to all subscribers, or only to the given one
+ *
+ * The callbacks are called without holding the lock
+ */
+void script_runner::publish(const string& key, subscription_id only) {
+  vector<pair<subscription_id, output_cb>> subscribers;
+  result last;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    auto it = m_entries.find(key);
+
+    if (it == m_entries.end() || m_stopped)
+      return;
+
+    for (auto&& s : it->second.subscribers) {
+      if (only && s.first != only)
+        continue;
+      subscribers.emplace_back(s);
+      m_callbacks.enter(s.first);
+    }
+
+    last = it->second.last;
+  }
+
+  for (auto&& s : subscribers) {
+    m_callbacks.call(m_mutex, s.first, [&] {
+      if (s.second)
+        s.second(last.output, last.counter);
+    });
+  }
+}
+
+LEMONBUDDY_NS_END
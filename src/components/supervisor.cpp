@@ -0,0 +1,237 @@
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <csignal>
+
+#include "components/supervisor.hpp"
+
+LEMONBUDDY_NS
+
+namespace {
+  /**
+   * Get a descriptor that becomes readable once the process exits
+   */
+  int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    return syscall(434, pid, 0);
+#endif
+  }
+
+  chrono::microseconds to_duration(const timeval& tv) {
+    return chrono::seconds{tv.tv_sec} + chrono::microseconds{tv.tv_usec};
+  }
+}
+
+/**
+ * Construct supervisor
+ */
+supervisor::supervisor(const logger& logger, reactor& reactor)
+    : m_log(logger), m_reactor(reactor) {}
+
+/**
+ * Stop waiting for the children
+ *
+ * The children that are still running are left unreaped
+ */
+supervisor::~supervisor() {
+  vector<reactor::handler_id> handlers;
+  vector<int> fds;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for (auto&& c : m_children) {
+      handlers.emplace_back(c.second.handler);
+      fds.emplace_back(c.second.pidfd);
+    }
+    m_children.clear();
+  }
+
+  m_reactor.remove(m_sighandler);
+  m_reactor.remove(m_eventhandler);
+
+  for (auto&& handler : handlers) m_reactor.remove(handler);
+  for (auto&& fd : fds) {
+    if (fd != -1)
+      close(fd);
+  }
+
+  if (m_signalfd != -1)
+    close(m_signalfd);
+  if (m_eventfd != -1)
+    close(m_eventfd);
+}
+
+/**
+ * Call the handler once given child process exits
+ *
+ * The child gets reaped by the supervisor, so it must not be waited
+ * for elsewhere unless it is unwatched first
+ */
+void supervisor::watch(pid_t pid, exit_cb&& handler) {
+  std::lock_guard<std::mutex> guard(m_mutex);
+
+  auto& c = m_children[pid];
+  c.on_exit = forward<exit_cb>(handler);
+
+  if ((c.pidfd = open_pidfd(pid)) != -1) {
+    c.handler = m_reactor.add(c.pidfd, EPOLLIN, [this, pid](uint32_t) { on_pidfd(pid); });
+    return;
+  }
+
+  if (m_signalfd == -1) {
+    m_log.warn("supervisor: Failed to open pidfd, falling back to SIGCHLD (%s)", strerror(errno));
+    attach_sigchld();
+  }
+
+  // The child may have exited before the signal was blocked,
+  // so let the reactor check it once it has been registered
+  uint64_t value{1};
+  if (write(m_eventfd, &value, sizeof(value)) == -1)
+    m_log.err("supervisor: Failed to notify reactor (%s)", strerror(errno));
+}
+
+/**
+ * Stop waiting for given child process
+ *
+ * Once this returns the exit handler will no longer be called,
+ * unless called from within the handler itself
+ */
+void supervisor::unwatch(pid_t pid) {
+  child c;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto it = m_children.find(pid);
+    if (it == m_children.end())
+      return;
+    c = move(it->second);
+    m_children.erase(it);
+  }
+
+  m_reactor.remove(c.handler);
+
+  if (c.pidfd != -1)
+    close(c.pidfd);
+}
+
+/**
+ * Get the amount of supervised children
+ */
+size_t supervisor::size() const {
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_children.size();
+}
+
+/**
+ * Receive SIGCHLD through a signalfd
+ *
+ * Requires the lock to be held
+ */
+void supervisor::attach_sigchld() {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+
+  if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) == -1)
+    throw system_error("Failed to block SIGCHLD");
+  if ((m_signalfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1)
+    throw system_error("Failed to create signalfd");
+  if ((m_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+    throw system_error("Failed to create eventfd");
+
+  m_sighandler = m_reactor.add(m_signalfd, EPOLLIN, [this](uint32_t) { on_sigchld(); });
+  m_eventhandler = m_reactor.add(m_eventfd, EPOLLIN, [this](uint32_t) { on_sigchld(); });
+}
+
+/**
+ * Reactor handler: the pidfd of given child became readable
+ */
+void supervisor::on_pidfd(pid_t pid) {
+  std::unique_lock<std::mutex> guard(m_mutex);
+
+  auto it = m_children.find(pid);
+  child_status result;
+
+  if (it == m_children.end() || !collect(pid, result))
+    return;
+
+  auto c = move(it->second);
+  m_children.erase(it);
+
+  m_reactor.remove(c.handler);
+  close(c.pidfd);
+
+  guard.unlock();
+
+  if (c.on_exit)
+    c.on_exit(result);
+}
+
+/**
+ * Reactor handler: check the children without pidfd after SIGCHLD was received
+ *
+ * Signals of the same kind are coalesced, so all of them are checked
+ */
+void supervisor::on_sigchld() {
+  signalfd_siginfo info;
+  uint64_t value;
+
+  while (read(m_signalfd, &info, sizeof(info)) > 0) {
+  }
+  while (read(m_eventfd, &value, sizeof(value)) > 0) {
+  }
+
+  vector<pair<exit_cb, child_status>> exited;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    for (auto it = m_children.begin(); it != m_children.end();) {
+      child_status result;
+
+      if (it->second.pidfd != -1 || !collect(it->first, result)) {
+        it++;
+      } else {
+        exited.emplace_back(move(it->second.on_exit), result);
+        it = m_children.erase(it);
+      }
+    }
+  }
+
+  for (auto&& child : exited) {
+    if (child.first)
+      child.first(child.second);
+  }
+}
+
+/**
+ * Reap given child if it has exited
+ */
+bool supervisor::collect(pid_t pid, child_status& result) const {
+  int status{0};
+  rusage usage{};
+
+  if (wait4(pid, &status, WNOHANG, &usage) <= 0)
+    return false;
+
+  result.pid = pid;
+  result.utime = to_duration(usage.ru_utime);
+  result.stime = to_duration(usage.ru_stime);
+  result.maxrss = usage.ru_maxrss;
+
+  if (WIFEXITED(status))
+    result.status = WEXITSTATUS(status);
+  else if (WIFSIGNALED(status))
+    result.status = 128 + WTERMSIG(status);
+
+  m_log.trace("supervisor: Reaped pid %i (status: %i, cpu: %lius, maxrss: %likB)", pid,
+      result.status, (result.utime + result.stime).count(), result.maxrss);
+
+  return true;
+}
+
+LEMONBUDDY_NS_END
@@ -31,25 +31,36 @@ namespace drawtypes {
       m_colorstep = m_width / m_colors.size();
   }
 
-  string progressbar::output(float percentage) {
-    string output{m_format};
+  display_list progressbar::output(float percentage) {
+    display_list output;
 
     // Get fill/empty widths based on percentage
     unsigned int perc = math_util::cap(percentage, 0.0f, 100.0f);
     unsigned int fill_width = math_util::percentage_to_value(perc, m_width);
     unsigned int empty_width = m_width - fill_width;
 
-    // Output fill icons
-    fill(perc, fill_width);
-    output = string_util::replace_all(output, "%fill%", m_builder->flush());
-
-    // Output indicator icon
-    m_builder->node(m_indicator);
-    output = string_util::replace_all(output, "%indicator%", m_builder->flush());
+    // Build the parts in the order the tokens appear in the format,
+    // passing the surrounding markup through untouched
+    string::size_type pos = 0;
+
+    while (pos < m_format.length()) {
+      if (m_format.compare(pos, 6, "%fill%") == 0) {
+        fill(perc, fill_width);
+        pos += 6;
+      } else if (m_format.compare(pos, 11, "%indicator%") == 0) {
+        m_builder->node(m_indicator);
+        pos += 11;
+      } else if (m_format.compare(pos, 7, "%empty%") == 0) {
+        for (auto i = empty_width; i > 0; i--) m_builder->node(m_empty);
+        pos += 7;
+      } else {
+        auto next = std::min(m_format.find('%', pos + 1), m_format.length());
+        m_builder->append(m_format.substr(pos, next - pos));
+        pos = next;
+      }
 
-    // Output empty icons
-    while (empty_width--) m_builder->node(m_empty);
-    output = string_util::replace_all(output, "%empty%", m_builder->flush());
+      output.append(m_builder->flush());
+    }
 
     return output;
   }
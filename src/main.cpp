@@ -1,4 +1,5 @@
 #include <X11/Xlib-xcb.h>
+#include <csignal>
 #include <thread>
 
 #include "common.hpp"
@@ -15,6 +16,13 @@ using namespace lemonbuddy;
 int main(int argc, char** argv) {
   XInitThreads();
 
+  // Block SIGCHLD before any thread gets created, the supervisor
+  // falls back to receiving it through a signalfd without pidfd support
+  sigset_t sigchld;
+  sigemptyset(&sigchld);
+  sigaddset(&sigchld, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &sigchld, nullptr);
+
   logger& logger{configure_logger<decltype(logger)>(loglevel::WARNING).create<decltype(logger)>()};
 
   //==================================================
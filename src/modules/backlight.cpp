@@ -7,11 +7,14 @@ namespace modules {
   void brightness_handle::filepath(string path) {
     if (!file_util::exists(path))
       throw module_error("The file '" + path + "' does not exist");
-    m_path = path;
+    m_reader = make_unique<file_util::file_reader>(path);
   }
 
   float brightness_handle::read() const {
-    return std::strtof(file_util::get_contents(m_path).c_str(), 0);
+    unsigned long long value{0};
+    if (m_reader->read())
+      file_util::parse_uint(m_reader->begin(), m_reader->end(), value);
+    return value;
   }
 
   void backlight_module::setup() {
@@ -36,10 +39,6 @@ namespace modules {
     watch(string_util::replace(PATH_BACKLIGHT_VAL, "%card%", card));
   }
 
-  void backlight_module::idle() {
-    sleep(75ms);
-  }
-
   bool backlight_module::on_event(inotify_event* event) {
     if (event != nullptr)
       m_log.trace("%s: %s", name(), event->filename);
@@ -1,32 +1,95 @@
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
 #include "modules/battery.hpp"
 #include "utils/math.hpp"
+#include "utils/netlink.hpp"
 
 LEMONBUDDY_NS
 
 namespace modules {
+  /**
+   * Path of the uevent file next to given sysfs attribute
+   */
+  static string uevent_path(const string& attribute) {
+    return attribute.substr(0, attribute.rfind('/') + 1) + "uevent";
+  }
+
+  battery_module::~battery_module() {
+    if (m_socketfd != -1)
+      close(m_socketfd);
+  }
+
   void battery_module::setup() {
     // Load configuration values {{{
 
-    m_battery = m_conf.get<string>(name(), "battery", "BAT0");
+    auto batteries = m_conf.get<string>(name(), "battery", "BAT0");
+
+    for (auto&& battery : string_util::split(batteries, ',')) {
+      if (!(battery = string_util::trim(battery, ' ')).empty())
+        m_batteries.emplace_back(battery);
+    }
+
     m_adapter = m_conf.get<string>(name(), "adapter", "ADP1");
     m_fullat = m_conf.get<int>(name(), "full-at", 100);
+    m_pollinterval = interval_t{m_conf.get<float>(name(), "poll-interval", 60.0f)};
 
-    m_path_capacity = string_util::replace(PATH_BATTERY_CAPACITY, "%battery%", m_battery);
-    m_path_adapter = string_util::replace(PATH_ADAPTER_STATUS, "%adapter%", m_adapter);
+    if (m_batteries.empty())
+      throw module_error("No battery defined");
 
     // }}}
     // Validate paths {{{
 
-    if (!file_util::exists(m_path_capacity))
-      throw module_error("The file '" + m_path_capacity + "' does not exist");
-    if (!file_util::exists(m_path_adapter))
-      throw module_error("The file '" + m_path_adapter + "' does not exist");
+    vector<pair<string, string>> supplies;
+
+    for (auto&& battery : m_batteries) {
+      supplies.emplace_back(
+          battery, string_util::replace(PATH_BATTERY_CAPACITY, "%battery%", battery));
+    }
+    supplies.emplace_back(
+        m_adapter, string_util::replace(PATH_ADAPTER_STATUS, "%adapter%", m_adapter));
+
+    for (auto&& supply : supplies) {
+      if (!file_util::exists(supply.second))
+        throw module_error("The file '" + supply.second + "' does not exist");
+
+      m_supplies.emplace(supply.first, power_supply{});
+      m_files.emplace_back(make_unique<file_util::file_reader>(uevent_path(supply.second), 1024));
+    }
+
+    // }}}
+    // Subscribe to the uevents {{{
+
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1;
+
+    const int type{SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC};
+
+    if ((m_socketfd = socket(AF_NETLINK, type, NETLINK_KOBJECT_UEVENT)) == -1 ||
+        bind(m_socketfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+      m_log.warn("%s: Failed to listen for uevents, polling instead (%s)", name(), strerror(errno));
+
+      if (m_socketfd != -1)
+        close(m_socketfd);
+      m_socketfd = -1;
+
+      if (m_pollinterval.count() <= 0)
+        m_pollinterval = 5s;
+    }
+
+    m_eventbuf.resize(8192);
 
     // }}}
     // Load state and capacity level {{{
 
-    m_percentage = current_percentage();
-    m_state = current_state();
+    for (auto&& file : m_files) {
+      if (file->read())
+        apply(file->begin(), file->size(), false);
+    }
 
     // }}}
     // Add formats and elements {{{
@@ -55,56 +118,94 @@ namespace modules {
       m_label_full = load_optional_label(m_conf, name(), TAG_LABEL_FULL, "%percentage%");
     }
 
-    // }}}
-    // Create inotify watches {{{
-
-    watch(m_path_capacity, IN_ACCESS);
-    watch(m_path_adapter, IN_ACCESS);
-
     // }}}
   }
 
   void battery_module::start() {
-    inotify_module::start();
-    m_threads.emplace_back(thread(&battery_module::subthread, this));
+    event_module::start();
+
+    if (m_animation_charging) {
+      auto interval = chrono::duration_cast<scheduler::clock::duration>(
+          chrono::milliseconds{m_animation_charging->framerate()});
+      add_timer(m_scheduler.every(interval, [this] { animate(); }));
+    }
+
+    if (m_pollinterval.count() > 0) {
+      auto interval = chrono::duration_cast<scheduler::clock::duration>(m_pollinterval);
+      add_timer(m_scheduler.every(interval, [this] { poll(); }));
+    }
   }
 
-  void battery_module::teardown() {
-    wakeup();
+  void battery_module::attach() {
+    if (m_socketfd != -1)
+      watch_fd(m_socketfd, EPOLLIN, [this](uint32_t events) { on_ready(events); });
   }
 
-  bool battery_module::on_event(inotify_event* event) {
-    if (event != nullptr) {
-      m_log.trace("%s: %s", name(), event->filename);
-      m_notified.store(true, std::memory_order_relaxed);
-    }
+  /**
+   * Read the pending uevents and apply those
+   * reporting a change of the monitored supplies
+   */
+  bool battery_module::has_event() {
+    bool changed{false};
 
-    auto state = current_state();
-    int percentage = m_percentage;
+    while (true) {
+      sockaddr_nl sender{};
+      socklen_t senderlen{sizeof(sender)};
 
-    if (state != battery_state::FULL) {
-      percentage = current_percentage();
+      auto len = recvfrom(m_socketfd, m_eventbuf.data(), m_eventbuf.size(), 0,
+          reinterpret_cast<sockaddr*>(&sender), &senderlen);
+
+      if (len == -1 && errno == EINTR) {
+        continue;
+      } else if (len == -1 && errno == ENOBUFS) {
+        // Uevents got dropped, so read the current state from sysfs
+        for (auto&& file : m_files) {
+          if (file->read())
+            changed |= apply(file->begin(), file->size(), false);
+        }
+        continue;
+      } else if (len <= 0) {
+        break;
+      }
+
+      // Only trust the uevents sent by the kernel
+      if (sender.nl_pid == 0)
+        changed |= apply(m_eventbuf.data(), len, true);
     }
 
-    // Ignore unchanged state
-    if (event != nullptr && m_state == state && m_percentage == percentage) {
+    return changed;
+  }
+
+  /**
+   * Update the labels if the capacity, state or time left changed
+   */
+  bool battery_module::update() {
+    auto percentage = current_percentage();
+    auto state = current_state(percentage);
+    auto time = current_time(state);
+
+    if (m_state == state && m_percentage == percentage && m_time == time)
       return false;
-    }
 
     m_percentage = percentage;
     m_state = state;
+    m_time = time;
 
-    if (m_label_charging) {
-      m_label_charging->reset_tokens();
-      m_label_charging->replace_token("%percentage%", to_string(m_percentage) + "%");
-    }
-    if (m_label_discharging) {
-      m_label_discharging->reset_tokens();
-      m_label_discharging->replace_token("%percentage%", to_string(m_percentage) + "%");
+    string time_left;
+
+    if (m_time.count() > 0) {
+      char buffer[32];
+      auto minutes = static_cast<unsigned long>(m_time.count() / 60);
+      snprintf(buffer, sizeof(buffer), "%lu:%02lu", minutes / 60, minutes % 60);
+      time_left = buffer;
     }
-    if (m_label_full) {
-      m_label_full->reset_tokens();
-      m_label_full->replace_token("%percentage%", to_string(m_percentage) + "%");
+
+    for (auto&& label : {m_label_charging, m_label_discharging, m_label_full}) {
+      if (!label)
+        continue;
+      label->reset_tokens();
+      label->replace_token("%percentage%", to_string(m_percentage) + "%");
+      label->replace_token("%time%", time_left);
     }
 
     return true;
@@ -137,28 +238,160 @@ namespace modules {
     return true;
   }
 
-  battery_state battery_module::current_state() {
-    auto adapter_status = file_util::get_contents(m_path_adapter);
+  /**
+   * Store the properties of a power supply uevent
+   *
+   * Drivers report either energy (µWh, µW) or charge (µAh, µA),
+   * both are fine for computing ratios as long as they aren't mixed
+   *
+   * @param from_uevent The payload was received from the socket, as
+   *                    opposed to being read from the sysfs uevent file
+   * @return true if the uevent belongs to one of the monitored supplies
+   */
+  bool battery_module::apply(const char* data, size_t len, bool from_uevent) {
+    map<string, string> properties;
 
-    if (adapter_status.empty()) {
-      return battery_state::UNKNOWN;
-    } else if (adapter_status[0] == '0') {
-      return battery_state::DISCHARGING;
-    } else if (adapter_status[0] != '1') {
-      return battery_state::UNKNOWN;
-    } else if (m_percentage < m_fullat) {
-      return battery_state::CHARGING;
+    netlink_util::for_each_property(data, len, [&](const string& key, const string& value) {
+      if (key == "SUBSYSTEM" || key.compare(0, 13, "POWER_SUPPLY_") == 0)
+        properties.emplace(key, value);
+    });
+
+    if (from_uevent && properties["SUBSYSTEM"] != "power_supply")
+      return false;
+
+    auto supply = m_supplies.find(properties["POWER_SUPPLY_NAME"]);
+
+    if (supply == m_supplies.end())
+      return false;
+
+    // Some drivers report the current as negative while discharging
+    auto number = [&](const char* key, unsigned long long& value) {
+      auto it = properties.find(key);
+      if (it != properties.end())
+        value = std::llabs(std::strtoll(it->second.c_str(), nullptr, 10));
+    };
+
+    auto& state = supply->second;
+    auto it = properties.find("POWER_SUPPLY_STATUS");
+
+    // Uevents without any level leave the unit as it was
+    bool energy{properties.count("POWER_SUPPLY_ENERGY_NOW") > 0};
+    bool charge{!energy && properties.count("POWER_SUPPLY_CHARGE_NOW") > 0};
+
+    if ((energy && state.charge) || (charge && !state.charge)) {
+      state.charge = charge;
+      state.energy_now = state.energy_full = state.power_now = 0;
+    }
+
+    if (it != properties.end())
+      state.status = it->second;
+    if ((it = properties.find("POWER_SUPPLY_ONLINE")) != properties.end())
+      state.online = std::atoi(it->second.c_str());
+    if ((it = properties.find("POWER_SUPPLY_CAPACITY")) != properties.end())
+      state.capacity = math_util::cap<int>(std::atoi(it->second.c_str()), 0, 100);
+
+    if (state.charge) {
+      number("POWER_SUPPLY_CHARGE_NOW", state.energy_now);
+      number("POWER_SUPPLY_CHARGE_FULL", state.energy_full);
+      number("POWER_SUPPLY_CURRENT_NOW", state.power_now);
     } else {
-      return battery_state::FULL;
+      number("POWER_SUPPLY_ENERGY_NOW", state.energy_now);
+      number("POWER_SUPPLY_ENERGY_FULL", state.energy_full);
+      number("POWER_SUPPLY_POWER_NOW", state.power_now);
+    }
+
+    m_log.trace("%s: %s %s %i%%", name(), supply->first, state.status, state.capacity);
+
+    return true;
+  }
+
+  /**
+   * Timer callback re-reading the sysfs uevent files, as fallback for
+   * drivers that don't emit a uevent when the capacity changes
+   */
+  void battery_module::poll() {
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+
+    if (!running())
+      return;
+
+    for (auto&& file : m_files) {
+      if (file->read())
+        apply(file->begin(), file->size(), false);
+    }
+
+    if (update())
+      broadcast();
+  }
+
+  /**
+   * Timer callback that emit update events
+   * to refresh <animation-charging> while charging
+   */
+  void battery_module::animate() {
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+
+    if (running() && m_state == battery_state::CHARGING)
+      broadcast();
+  }
+
+  /**
+   * Get the state of the batteries, based on the adapter
+   * or, if it doesn't tell, the status of the batteries
+   */
+  battery_state battery_module::current_state(int percentage) const {
+    auto& adapter = m_supplies.at(m_adapter);
+
+    if (adapter.online == 0) {
+      return battery_state::DISCHARGING;
+    } else if (adapter.online == 1) {
+      return percentage < m_fullat ? battery_state::CHARGING : battery_state::FULL;
+    }
+
+    size_t full{0};
+
+    for (auto&& battery : m_batteries) {
+      auto& status = m_supplies.at(battery).status;
+
+      if (status == "Charging")
+        return battery_state::CHARGING;
+      else if (status == "Discharging")
+        return battery_state::DISCHARGING;
+      else if (status == "Full")
+        full++;
     }
+
+    return full == m_batteries.size() ? battery_state::FULL : battery_state::UNKNOWN;
   }
 
   /**
-   * Get the current capacity level
+   * Get the combined capacity level, weighted by the size of
+   * the batteries when all of them report it in the same unit
    */
-  int battery_module::current_percentage() {
-    auto capacity = file_util::get_contents(m_path_capacity);
-    auto value = math_util::cap<int>(std::atof(capacity.c_str()), 0, 100);
+  int battery_module::current_percentage() const {
+    unsigned long long now{0}, full{0};
+    int capacity{0}, batteries{0};
+    bool weighted{same_unit()};
+
+    for (auto&& battery : m_batteries) {
+      auto& supply = m_supplies.at(battery);
+
+      now += supply.energy_now;
+      full += supply.energy_full;
+      weighted = weighted && supply.energy_full > 0;
+
+      if (supply.capacity != -1) {
+        capacity += supply.capacity;
+        batteries++;
+      }
+    }
+
+    int value{0};
+
+    if (weighted)
+      value = math_util::cap<int>(now * 100 / full, 0, 100);
+    else if (batteries > 0)
+      value = capacity / batteries;
 
     if (value >= m_fullat) {
       return 100;
@@ -168,39 +401,47 @@ namespace modules {
   }
 
   /**
-   * Subthread runner that emit update events
-   * to refresh <animation-charging> in case it is used.
+   * Estimate the time until the batteries are empty or
+   * fully charged from the energy level and power draw
    *
-   * Will also poll for events as fallback for systems that
-   * doesn't report inotify events for files on sysfs
+   * No estimate is made if the batteries use different units
    */
-  void battery_module::subthread() {
-    chrono::duration<double> dur = 1s;
+  chrono::seconds battery_module::current_time(battery_state state) const {
+    unsigned long long now{0}, full{0}, power{0};
 
-    if (m_animation_charging) {
-      dur = chrono::duration<double>(float(m_animation_charging->framerate()) / 1000.0f);
-    }
+    if (!same_unit())
+      return 0s;
 
-    const int interval = m_conf.get<float>(name(), "poll-interval", 3.0f) / dur.count();
+    for (auto&& battery : m_batteries) {
+      auto& supply = m_supplies.at(battery);
+      now += supply.energy_now;
+      full += supply.energy_full;
+      power += supply.power_now;
+    }
 
-    while (running()) {
-      for (int i = 0; running() && i < interval; ++i) {
-        if (m_state == battery_state::CHARGING) {
-          broadcast();
-        }
-        sleep(dur);
-      }
+    if (power == 0 || now == 0) {
+      return 0s;
+    } else if (state == battery_state::DISCHARGING) {
+      return chrono::seconds{now * 3600 / power};
+    } else if (state == battery_state::CHARGING && full > now) {
+      return chrono::seconds{(full - now) * 3600 / power};
+    } else {
+      return 0s;
+    }
+  }
 
-      if (!running() || m_state == battery_state::CHARGING) {
-        continue;
-      }
+  /**
+   * Check if all batteries report either energy or charge
+   */
+  bool battery_module::same_unit() const {
+    auto charge = m_supplies.at(m_batteries.front()).charge;
 
-      if (!m_notified.load(std::memory_order_relaxed)) {
-        file_util::get_contents(m_path_capacity);
-      }
+    for (auto&& battery : m_batteries) {
+      if (m_supplies.at(battery).charge != charge)
+        return false;
     }
 
-    m_log.trace("%s: End of subthread", name());
+    return true;
   }
 }
 
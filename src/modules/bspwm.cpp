@@ -63,46 +63,55 @@ namespace modules {
   }
 
   void bspwm_module::stop() {
+    event_module::stop();
+
     if (m_subscriber) {
       m_log.info("%s: Disconnecting from socket", name());
       m_subscriber->disconnect();
     }
-    event_module::stop();
+  }
+
+  void bspwm_module::attach() {
+    m_handler = watch_fd(m_subscriber->get_file_descriptor(), EPOLLIN,
+        [this](uint32_t events) { on_ready(events); });
   }
 
   bool bspwm_module::has_event() {
-    if (m_subscriber->poll(POLLHUP, 0)) {
+    string status;
+
+    // Only the latest status is of interest when several are pending
+    auto on_line = [&](const char* line, size_t len) {
+      if (len > 0)
+        status.assign(line, len);
+    };
+
+    // The socket only becomes readable without data once it has been closed
+    if (!m_reader.read(m_subscriber->get_file_descriptor(), on_line)) {
       m_log.warn("%s: Reconnecting to socket...", name());
+      unwatch_fd(m_handler);
+      m_reader.reset();
       m_subscriber = bspwm_util::make_subscriber();
+      attach();
+      return false;
     }
 
-    ssize_t bytes = 0;
-    m_subscriber->receive(1, bytes, MSG_PEEK);
-    return bytes > 0;
+    if (status.empty())
+      return false;
+
+    m_status = move(status);
+
+    return true;
   }
 
   bool bspwm_module::update() {
-    ssize_t bytes = 0;
-    string data = m_subscriber->receive(BUFSIZ - 1, bytes, 0);
-
-    if (bytes == 0)
+    if (m_status.empty())
       return false;
 
-    data = string_util::strip_trailing_newline(data);
-
+    string data{m_status};
     unsigned long pos;
-    while ((pos = data.find("\n")) != string::npos) data.erase(pos);
-
-    if (data.empty())
-      return false;
 
     const auto prefix = string{BSPWM_STATUS_PREFIX};
 
-    // If there were more than 1 row available in the channel
-    // we'll strip out the old updates
-    if ((pos = data.find_last_of(prefix)) > 0)
-      data = data.substr(pos);
-
     if (data.compare(0, prefix.length(), prefix) != 0) {
       m_log.err("%s: Unknown status '%s'", name(), data);
       return false;
@@ -19,9 +19,11 @@ namespace modules {
     if (m_formatter->has(TAG_LABEL))
       m_label = load_optional_label(m_conf, name(), TAG_LABEL, "%percentage%");
 
+    m_source = m_providers.subscribe<providers::cpu_sample>(
+        "cpu", m_interval, providers::cpu_times_reader());
+
     // warmup
     read_values();
-    read_values();
   }
 
   bool cpu_module::update() {
@@ -31,7 +33,7 @@ namespace modules {
     m_total = 0.0f;
     m_load.clear();
 
-    auto cores_n = m_cputimes.size();
+    auto cores_n = m_cputimes->cores.size();
 
     if (!cores_n)
       return false;
@@ -73,48 +75,32 @@ namespace modules {
   }
 
   bool cpu_module::read_values() {
-    m_cputimes_prev.swap(m_cputimes);
-    m_cputimes.clear();
-
-    try {
-      std::ifstream in(PATH_CPU_INFO);
-      string str;
-
-      while (std::getline(in, str) && str.compare(0, 3, "cpu") == 0) {
-        // skip line with accumulated value
-        if (str.compare(0, 4, "cpu ") == 0)
-          continue;
-
-        auto values = string_util::split(str, ' ');
-
-        m_cputimes.emplace_back(new cpu_time);
-        m_cputimes.back()->user = std::stoull(values[1].c_str(), 0, 10);
-        m_cputimes.back()->nice = std::stoull(values[2].c_str(), 0, 10);
-        m_cputimes.back()->system = std::stoull(values[3].c_str(), 0, 10);
-        m_cputimes.back()->idle = std::stoull(values[4].c_str(), 0, 10);
-        m_cputimes.back()->total = m_cputimes.back()->user + m_cputimes.back()->nice +
-                                   m_cputimes.back()->system + m_cputimes.back()->idle;
-      }
-    } catch (const std::ios_base::failure& e) {
-      m_log.err("Failed to read CPU values (what: %s)", e.what());
+    auto sample = m_source.sample();
+
+    if (!sample) {
+      m_log.err("%s: Failed to read CPU values", name());
+      return false;
     }
 
-    return !m_cputimes.empty();
+    m_cputimes_prev.swap(m_cputimes);
+    m_cputimes = move(sample);
+
+    return true;
   }
 
   float cpu_module::get_load(size_t core) const {
-    if (m_cputimes.empty() || m_cputimes_prev.empty())
+    if (!m_cputimes || !m_cputimes_prev)
       return 0;
-    else if (core >= m_cputimes.size() || core >= m_cputimes_prev.size())
+    else if (core >= m_cputimes->cores.size() || core >= m_cputimes_prev->cores.size())
       return 0;
 
-    auto& last = m_cputimes[core];
-    auto& prev = m_cputimes_prev[core];
+    auto& last = m_cputimes->cores[core];
+    auto& prev = m_cputimes_prev->cores[core];
 
-    auto last_idle = last->idle;
-    auto prev_idle = prev->idle;
+    auto last_idle = last.idle;
+    auto prev_idle = prev.idle;
 
-    auto diff = last->total - prev->total;
+    auto diff = last.total - prev.total;
 
     if (diff == 0)
       return 0;
@@ -60,17 +60,21 @@ namespace modules {
   void i3_module::stop() {
     // Shutdown ipc connection when stopping the module {{{
 
+    event_module::stop();
+
     try {
       shutdown(m_ipc.get_event_socket_fd(), SHUT_RD);
       shutdown(m_ipc.get_main_socket_fd(), SHUT_RD);
     } catch (...) {
     }
 
-    event_module::stop();
-
     // }}}
   }
 
+  void i3_module::attach() {
+    watch_fd(m_ipc.get_event_socket_fd(), EPOLLIN, [this](uint32_t events) { on_ready(events); });
+  }
+
   bool i3_module::has_event() {
     if (!m_ipc.handle_event())
       throw module_error("Socket connection closed...");
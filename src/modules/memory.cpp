@@ -14,38 +14,20 @@ namespace modules {
       m_bars[memtype::FREE] = load_progressbar(m_bar, m_conf, name(), TAG_BAR_FREE);
     if (m_formatter->has(TAG_LABEL))
       m_label = load_optional_label(m_conf, name(), TAG_LABEL, "%percentage_used%");
+
+    m_source = m_providers.subscribe<providers::meminfo_sample>(
+        "meminfo", m_interval, providers::meminfo_reader());
   }
 
   bool memory_module::update() {
-    float kb_total;
-    float kb_avail;
-    // long kb_free;
-
-    try {
-      std::ifstream in(PATH_MEMORY_INFO);
-      std::stringstream buffer;
-      string str, rdbuf;
-      int i = 0;
-
-      in.exceptions(in.failbit);
-
-      buffer.imbue(std::locale::classic());
-
-      while (std::getline(in, str) && i++ < 3) {
-        size_t off = str.find_first_of("1234567890", str.find(':'));
-        buffer << std::strtol(&str[off], 0, 10) << std::endl;
-      }
-
-      buffer >> rdbuf;
-      kb_total = std::atol(rdbuf.c_str());
-      buffer >> rdbuf;  // kb_free = std::atol(rdbuf.c_str());
-      buffer >> rdbuf;
-      kb_avail = std::atol(rdbuf.c_str());
-    } catch (const std::ios_base::failure& e) {
-      kb_total = 0;
-      // kb_free = 0;
-      kb_avail = 0;
-      m_log.err("Failed to read memory values (what: %s)", e.what());
+    float kb_total{0};
+    float kb_avail{0};
+
+    if (auto sample = m_source.sample()) {
+      kb_total = sample->total;
+      kb_avail = sample->available;
+    } else {
+      m_log.err("%s: Failed to read memory values", name());
     }
 
     if (kb_total > 0)
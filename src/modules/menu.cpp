@@ -74,16 +74,13 @@ namespace modules {
 
     // broadcast update when leaving leaving the function
     auto exit_handler = scope_util::make_exit_handler<>([this]() {
-      if (!m_threads.empty()) {
-        m_log.trace("%s: Cleaning up previous broadcast threads", name());
-        for (auto&& thread : m_threads)
-          if (thread.joinable())
-            thread.join();
-        m_threads.clear();
+      for (auto&& timer : m_timers) {
+        m_scheduler.cancel(timer);
       }
+      m_timers.clear();
 
-      m_log.trace("%s: Dispatching broadcast thread", name());
-      m_threads.emplace_back(thread(&menu_module::broadcast, this));
+      m_log.trace("%s: Dispatching broadcast", name());
+      m_timers.emplace_back(m_scheduler.once(0s, bind(&menu_module::broadcast, this)));
     });
 
     if (cmd.compare(0, strlen(EVENT_MENU_OPEN), EVENT_MENU_OPEN) == 0) {
@@ -79,11 +79,49 @@ namespace modules {
     return m_mpd && m_mpd->connected();
   }
 
-  void mpd_module::idle() {
-    if (connected())
-      sleep(80ms);
-    else {
-      sleep(2s);
+  void mpd_module::attach() {
+    // The timer takes care of reconnecting and refreshing the elapsed time
+    auto interval = chrono::duration_cast<scheduler::clock::duration>(interval_t{m_synctime});
+    add_timer(m_scheduler.every(interval, [this] {
+      {
+        // The timer may fire within the slack window, so don't
+        // let the elapsed time check skip this refresh
+        std::lock_guard<threading_util::futex_lock> guard(m_lock);
+        m_lastsync = {};
+      }
+      on_wakeup(0);
+    }));
+
+    rewatch();
+  }
+
+  void mpd_module::on_wakeup(uint32_t events) {
+    on_ready(events);
+
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+    {
+      rewatch();
+    }
+  }
+
+  /**
+   * Put the connection back in idle mode and let the reactor wait
+   * for the response, which mpd sends as soon as something changes
+   */
+  void mpd_module::rewatch() {
+    try {
+      if (!running() || !connected())
+        return;
+      m_mpd->idle();
+    } catch (const mpd_exception& err) {
+      m_log.err("%s: %s", name(), err.what());
+      m_mpd.reset();
+      return;
+    }
+
+    if (!m_handler) {
+      m_handler =
+          watch_fd(m_mpd->get_fd(), EPOLLIN, [this](uint32_t events) { on_wakeup(events); });
     }
   }
 
@@ -99,8 +137,11 @@ namespace modules {
     try {
       if (!m_mpd)
         m_mpd = make_unique<mpdconnection>(m_log, m_host, m_port, m_pass);
-      if (!connected())
+      if (!connected()) {
         m_mpd->connect();
+        // The previous handler went away together with the old descriptor
+        m_handler = 0;
+      }
     } catch (const mpd_exception& err) {
       m_log.trace("%s: %s", name(), err.what());
       m_mpd.reset();
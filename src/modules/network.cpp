@@ -7,6 +7,7 @@ namespace modules {
     // Load configuration values
     REQ_CONFIG_VALUE(name(), m_interface, "interface");
     GET_CONFIG_VALUE(name(), m_ping_nth_update, "ping-interval");
+    GET_CONFIG_VALUE(name(), m_ping_window, "ping-window");
     GET_CONFIG_VALUE(name(), m_udspeed_minwidth, "udspeed-minwidth");
 
     m_interval = chrono::duration<double>(m_conf.get<float>(name(), "interval", 1));
@@ -53,21 +54,84 @@ namespace modules {
     else
       m_wired = net::wired_t{new net::wired_t::element_type(m_interface)};
 
-    // We only need to start the subthread if the packetloss animation is used
-    if (m_animation_packetloss)
-      m_threads.emplace_back(thread(&network_module::subthread_routine, this));
+    // Probe the connectivity through the interface in the background
+    if (m_ping_nth_update > 0) {
+      try {
+        m_prober = make_unique<net::icmp_prober>(
+            m_log, m_scheduler, m_reactor, CONNECTION_TEST_IP, m_interface);
+      } catch (const application_error& err) {
+        m_log.warn("%s: Disabling connectivity test (%s)", name(), err.what());
+      }
+    }
+
+    // We only need to refresh the output between updates if the packetloss animation is used
+    if (m_animation_packetloss) {
+      auto framerate = chrono::milliseconds{m_animation_packetloss->framerate()};
+      m_timers.emplace_back(m_scheduler.every(framerate, bind(&network_module::animate, this)));
+    }
+  }
+
+  /**
+   * Poll the traffic counters once per interval and
+   * update right away when the link changes state
+   */
+  void network_module::start() {
+    timer_module::start();
+
+    if (!running())
+      return;
+
+    auto index = m_wireless ? m_wireless->index() : m_wired->index();
+    auto watch = m_netlink.watch(index, [this](const rtnetlink::link_state&) { on_link_change(); });
+
+    {
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
+      m_watch = watch;
+    }
+
+    // Send one probe every `ping-interval` updates
+    if (m_prober) {
+      auto interval = chrono::duration_cast<chrono::milliseconds>(m_interval * m_ping_nth_update);
+      m_prober->start(interval, 2s, m_ping_window > 0 ? m_ping_window : 1,
+          [this](const net::probe_stats& stats) { on_probe(stats); });
+    }
+  }
+
+  void network_module::stop() {
+    if (!running())
+      return;
+
+    rtnetlink::watch_id watch{0};
+    {
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
+      std::swap(watch, m_watch);
+    }
+
+    // The callbacks take the module lock
+    if (watch)
+      m_netlink.unwatch(watch);
+    if (m_prober)
+      m_prober->stop();
+
+    timer_module::stop();
   }
 
   void network_module::teardown() {
+    m_prober.reset();
     m_wireless.reset();
     m_wired.reset();
   }
 
-  bool network_module::update() {
+  /**
+   * Query the interface and update the labels
+   *
+   * @param accumulate Poll the traffic counters
+   */
+  bool network_module::update(bool accumulate) {
     net::network* network = m_wireless ? dynamic_cast<net::network*>(m_wireless.get())
                                        : dynamic_cast<net::network*>(m_wired.get());
 
-    if (!network->query()) {
+    if (!network->query(accumulate)) {
       m_log.warn("%s: Failed to query interface '%s'", name(), m_interface);
       return false;
     }
@@ -81,16 +145,17 @@ namespace modules {
       m_log.warn("%s: Error getting interface data (%s)", name(), err.what());
     }
 
-    m_connected = network->connected();
+    auto connected = network->connected();
 
-    // Ignore the first run
-    if (m_counter == -1) {
-      m_counter = 0;
-    } else if (m_ping_nth_update > 0 && m_connected && (++m_counter % m_ping_nth_update) == 0) {
-      m_packetloss = !network->ping();
-      m_counter = 0;
+    // Probes sent while the link was down would report packetloss
+    if (m_prober && connected && !m_connected) {
+      m_prober->reset();
+      m_probe = {};
+      m_packetloss = false;
     }
 
+    m_connected = connected;
+
     auto upspeed = network->upspeed(m_udspeed_minwidth);
     auto downspeed = network->downspeed(m_udspeed_minwidth);
 
@@ -101,10 +166,13 @@ namespace modules {
       label->replace_token("%local_ip%", network->ip());
       label->replace_token("%upspeed%", upspeed);
       label->replace_token("%downspeed%", downspeed);
+      label->replace_token("%latency%", to_string(m_probe.latency.count() / 1000) + " ms");
+      label->replace_token("%loss%", to_string(m_probe.loss()) + "%");
 
       if (m_wired) {
         label->replace_token("%linkspeed%", m_wired->linkspeed());
       } else if (m_wireless) {
+        label->replace_token("%linkspeed%", m_wireless->linkspeed());
         label->replace_token("%essid%", m_wireless->essid());
         label->replace_token("%signal%", to_string(m_signal) + "%");
         label->replace_token("%quality%", to_string(m_quality) + "%");
@@ -119,6 +187,32 @@ namespace modules {
     return true;
   }
 
+  /**
+   * Prober callback: a probe got a reply or was considered lost
+   */
+  void network_module::on_probe(const net::probe_stats& stats) {
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+
+    if (!running())
+      return;
+
+    m_probe = stats;
+    m_packetloss = stats.lost > 0;
+
+    if (update(false))
+      broadcast();
+  }
+
+  /**
+   * Netlink callback: the link changed state or address
+   */
+  void network_module::on_link_change() {
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+
+    if (running() && update(false))
+      broadcast();
+  }
+
   string network_module::get_format() const {
     if (!m_connected)
       return FORMAT_DISCONNECTED;
@@ -146,17 +240,15 @@ namespace modules {
     return true;
   }
 
-  void network_module::subthread_routine() {
-    const chrono::milliseconds framerate{m_animation_packetloss->framerate()};
-    const auto dur = chrono::duration<double>(framerate);
-
-    while (running()) {
-      if (m_connected && m_packetloss)
-        broadcast();
-      sleep(dur);
-    }
+  /**
+   * Timer callback that emit update events
+   * to refresh <animation-packetloss>
+   */
+  void network_module::animate() {
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
 
-    m_log.trace("%s: Reached end of network subthread", name());
+    if (running() && m_connected && m_packetloss)
+      broadcast();
   }
 }
 
@@ -10,6 +10,7 @@ namespace modules {
 
     REQ_CONFIG_VALUE(name(), m_exec, "exec");
     GET_CONFIG_VALUE(name(), m_tail, "tail");
+    GET_CONFIG_VALUE(name(), m_coprocess, "coprocess");
     GET_CONFIG_VALUE(name(), m_maxlen, "maxlen");
     GET_CONFIG_VALUE(name(), m_ellipsis, "ellipsis");
 
@@ -20,85 +21,183 @@ namespace modules {
     m_actions[mousebtn::SCROLL_DOWN] = m_conf.get<string>(name(), "scroll-down", "");
 
     m_interval = interval_t{m_conf.get<float>(name(), "interval", m_tail ? 0.0f : 2.0f)};
+
+    if (m_tail && m_coprocess)
+      throw module_error("The tail and coprocess options can't be combined");
   }
 
   void script_module::stop() {
-    if (m_command && m_command->is_running()) {
-      m_log.warn("%s: Stopping shell command", name());
-      m_command->terminate();
-    }
-    wakeup();
     event_module::stop();
+
+    executor::job_id job{0};
+    script_runner::subscription_id subscription{0};
+    {
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
+      std::swap(job, m_job);
+      std::swap(subscription, m_subscription);
+    }
+
+    // The callbacks take the module lock, so the command is cancelled without holding it
+    if (job) {
+      if (m_executor.running(job))
+        m_log.warn("%s: Stopping shell command", name());
+      m_executor.cancel(job);
+    }
+    if (subscription)
+      m_runner.unsubscribe(subscription);
   }
 
-  void script_module::idle() {
-    if (!m_tail)
-      sleep(m_interval);
-    else if (!m_command || !m_command->is_running())
-      sleep(m_interval);
+  /**
+   * Start running the command, either once for tail commands or
+   * through the shared runner for the ones run on every interval
+   *
+   * A co-process is started once and asked for new output on every
+   * interval by writing the counter as a line to its input
+   */
+  void script_module::attach() {
+    if (!m_tail && !m_coprocess) {
+      auto on_output = [this](const string& output, int counter) { on_result(output, counter); };
+      auto interval = chrono::duration_cast<chrono::milliseconds>(m_interval);
+      m_subscription = m_runner.subscribe(m_exec, interval, on_output);
+      return;
+    }
+
+    run();
+
+    if (m_coprocess) {
+      trigger();
+      add_timer(m_scheduler.every(interval(), [this] { tick(); }));
+    }
   }
 
-  bool script_module::has_event() {
-    // Non tail commands should always run
-    if (!m_tail)
-      return true;
+  /**
+   * The output is received asynchronously from the executor
+   */
+  bool script_module::update() {
+    return true;
+  }
 
-    try {
-      if (!m_command || !m_command->is_running()) {
-        auto exec = string_util::replace_all(m_exec, "%counter%", to_string(++m_counter));
-        m_log.trace("%s: Executing '%s'", name(), exec);
+  /**
+   * Start the tail command or co-process
+   *
+   * Requires the module lock to be held
+   */
+  void script_module::run() {
+    if (m_job && m_executor.running(m_job)) {
+      m_log.warn("%s: Previous shell command is still running...", name());
+      return;
+    }
+
+    auto exec = string_util::replace_all(m_exec, "%counter%", to_string(++m_counter));
+    m_log.trace("%s: Executing '%s'", name(), exec);
+
+    auto on_line = [this](string line) { this->on_line(move(line)); };
+    auto on_exit = [this](const supervisor::child_status& result) { this->on_exit(result); };
 
-        m_command = command_util::make_command(exec);
-        m_command->exec(false);
-      }
+    try {
+      m_job = m_executor.run_persistent(exec, on_line, on_exit, m_coprocess);
     } catch (const std::exception& err) {
       m_log.err("%s: %s", name(), err.what());
-      throw module_error("Failed to execute tail command, stopping module...");
+      throw module_error("Failed to execute command, stopping module...");
     }
+  }
 
-    if (!m_command)
-      return false;
+  /**
+   * Get the interval in the resolution used by the scheduler
+   */
+  scheduler::clock::duration script_module::interval() const {
+    return chrono::duration_cast<scheduler::clock::duration>(m_interval);
+  }
 
-    if ((m_output = m_command->readline()) == m_prev)
-      return false;
+  /**
+   * Ask the co-process for new output
+   *
+   * Requires the module lock to be held
+   */
+  void script_module::trigger() {
+    if (!m_executor.running(m_job))
+      return;
+    if (!m_executor.write(m_job, to_string(++m_counter)))
+      m_log.warn("%s: Co-process isn't reading its input, skipping update...", name());
+  }
 
-    m_prev = m_output;
+  /**
+   * Scheduler task: ask the co-process for new output once per interval
+   */
+  void script_module::tick() {
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+    if (running())
+      trigger();
+  }
 
-    return true;
+  /**
+   * Scheduler task: run the command again
+   */
+  void script_module::rerun() {
+    try {
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
+      if (running())
+        run();
+    } catch (const module_error& err) {
+      halt(err.what());
+    }
   }
 
-  bool script_module::update() {
-    // Tailing commands always update
-    if (m_tail)
-      return true;
+  /**
+   * Executor callback: tail commands and co-processes
+   * update the output on every line
+   */
+  void script_module::on_line(string line) {
+    {
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
 
-    try {
-      if (m_command && m_command->is_running()) {
-        m_log.warn("%s: Previous shell command is still running...", name());
-        return false;
-      }
+      m_output = move(line);
 
-      auto exec = string_util::replace_all(m_exec, "%counter%", to_string(++m_counter));
-      m_log.trace("%s: Executing '%s'", name(), exec);
+      if (m_output == m_prev)
+        return;
 
-      m_command = command_util::make_command(exec);
-      m_command->exec();
-      m_command->tail([&](string output) { m_output = output; });
-    } catch (const std::exception& err) {
-      m_log.err("%s: %s", name(), err.what());
-      throw module_error("Failed to execute command, stopping module...");
+      m_prev = m_output;
     }
 
-    if (m_output == m_prev)
-      return false;
+    broadcast();
+  }
 
-    m_prev = m_output;
-    return true;
+  /**
+   * Executor callback: restart tail commands and co-processes after the interval
+   */
+  void script_module::on_exit(const supervisor::child_status& result) {
+    auto cpu = chrono::duration_cast<chrono::milliseconds>(result.utime + result.stime);
+    m_log.trace("%s: Shell command exited with status %i (cpu: %lims, maxrss: %likB)", name(),
+        result.status, cpu.count(), result.maxrss);
+
+    if (running())
+      add_timer(m_scheduler.once(interval(), [this] { rerun(); }));
   }
 
-  string script_module::get_output() {
-    if (m_output.empty())
-      return " ";
+  /**
+   * Runner callback: publish the last line of the output
+   */
+  void script_module::on_result(const string& output, int counter) {
+    {
+      std::lock_guard<threading_util::futex_lock> guard(m_lock);
+
+      m_output = output;
+      m_counter = counter;
+
+      if (!running() || m_output == m_prev)
+        return;
+
+      m_prev = m_output;
+    }
+
+    broadcast();
+  }
+
+  display_list script_module::get_output() {
+    if (m_output.empty()) {
+      m_builder->node(" ");
+      return m_builder->flush();
+    }
 
     // Truncate output to the defined max length
     if (m_maxlen > 0 && m_output.length() > m_maxlen) {
@@ -17,7 +17,7 @@ namespace modules {
     return "content";
   }
 
-  string text_module::get_output() {
+  display_list text_module::get_output() {
     auto click_left = m_conf.get<string>(name(), "click-left", "");
     auto click_middle = m_conf.get<string>(name(), "click-middle", "");
     auto click_right = m_conf.get<string>(name(), "click-right", "");
@@ -27,14 +27,16 @@ namespace modules {
     // Setup mixers {{{
 
     try {
+      auto& card = configure_alsa_card().create<alsa_card&>();
+
       if (!master_mixer_name.empty())
-        m_mixers[mixer::MASTER].reset(new mixer_t::element_type{master_mixer_name});
+        m_mixers[mixer::MASTER].reset(new mixer_t::element_type{card, master_mixer_name});
       if (!speaker_mixer_name.empty())
-        m_mixers[mixer::SPEAKER].reset(new mixer_t::element_type{speaker_mixer_name});
+        m_mixers[mixer::SPEAKER].reset(new mixer_t::element_type{card, speaker_mixer_name});
       if (!headphone_mixer_name.empty())
-        m_mixers[mixer::HEADPHONE].reset(new mixer_t::element_type{headphone_mixer_name});
+        m_mixers[mixer::HEADPHONE].reset(new mixer_t::element_type{card, headphone_mixer_name});
       if (m_mixers[mixer::HEADPHONE])
-        m_controls[control::HEADPHONE].reset(new control_t::element_type{m_headphoneid});
+        m_controls[control::HEADPHONE].reset(new control_t::element_type{card, m_headphoneid});
       if (m_mixers.empty())
         throw module_error("No configured mixers");
     } catch (const alsa_mixer_error& err) {
@@ -65,44 +67,57 @@ namespace modules {
     // }}}
   }
 
-  void volume_module::teardown() {
-    m_mixers.clear();
+  /**
+   * Stop watching the elements once the module is disabled,
+   * as removing the watches waits for the callbacks that take the lock
+   */
+  void volume_module::stop() {
+    event_module::stop();
+
+    for (auto&& mixer : m_mixers) {
+      if (mixer.second)
+        mixer.second->unwatch();
+    }
+    for (auto&& control : m_controls) {
+      if (control.second)
+        control.second->unwatch();
+    }
+
+    std::lock_guard<threading_util::futex_lock> guard(m_lock);
+    {
+      m_mixers.clear();
+      m_controls.clear();
+    }
   }
 
-  bool volume_module::has_event() {
-    // Poll for mixer and control events {{{
+  void volume_module::attach() {
+    // Get notified by the shared card when one of the elements changes {{{
 
     try {
-      if (m_mixers[mixer::MASTER] && m_mixers[mixer::MASTER]->wait(25))
-        return true;
-      if (m_mixers[mixer::SPEAKER] && m_mixers[mixer::SPEAKER]->wait(25))
-        return true;
-      if (m_mixers[mixer::HEADPHONE] && m_mixers[mixer::HEADPHONE]->wait(25))
-        return true;
-      if (m_controls[control::HEADPHONE] && m_controls[control::HEADPHONE]->wait(25))
-        return true;
-    } catch (const alsa_exception& e) {
-      m_log.err("%s: %s", name(), e.what());
+      for (auto&& mixer : m_mixers) {
+        if (mixer.second)
+          mixer.second->watch([this] { on_ready(0); });
+      }
+      for (auto&& control : m_controls) {
+        if (control.second)
+          control.second->watch([this] { on_ready(0); });
+      }
+    } catch (const alsa_exception& err) {
+      throw module_error(err.what());
     }
 
-    return false;
-
     // }}}
   }
 
-  bool volume_module::update() {
-    // Consume pending events {{{
-
-    if (m_mixers[mixer::MASTER])
-      m_mixers[mixer::MASTER]->process_events();
-    if (m_mixers[mixer::SPEAKER])
-      m_mixers[mixer::SPEAKER]->process_events();
-    if (m_mixers[mixer::HEADPHONE])
-      m_mixers[mixer::HEADPHONE]->process_events();
-    if (m_controls[control::HEADPHONE])
-      m_controls[control::HEADPHONE]->process_events();
+  /**
+   * Only called when an element changed, the mixers
+   * themselves keep track of which ones to read again
+   */
+  bool volume_module::has_event() {
+    return true;
+  }
 
-    // }}}
+  bool volume_module::update() {
     // Get volume, mute and headphone state {{{
 
     m_volume = 100;
@@ -145,7 +160,7 @@ namespace modules {
     return m_muted ? FORMAT_MUTED : FORMAT_VOLUME;
   }
 
-  string volume_module::get_output() {
+  display_list volume_module::get_output() {
     m_builder->cmd(mousebtn::LEFT, EVENT_TOGGLE_MUTE);
 
     if (!m_muted && m_volume < 100)
@@ -183,11 +198,11 @@ namespace modules {
     vector<mixer_t> mixers;
 
     if (m_mixers[mixer::MASTER])
-      mixers.emplace_back(new mixer_t::element_type(m_mixers[mixer::MASTER]->get_name()));
+      mixers.emplace_back(m_mixers[mixer::MASTER]);
     if (m_mixers[mixer::HEADPHONE] && m_headphones)
-      mixers.emplace_back(new mixer_t::element_type(m_mixers[mixer::HEADPHONE]->get_name()));
+      mixers.emplace_back(m_mixers[mixer::HEADPHONE]);
     if (m_mixers[mixer::SPEAKER] && !m_headphones)
-      mixers.emplace_back(new mixer_t::element_type(m_mixers[mixer::SPEAKER]->get_name()));
+      mixers.emplace_back(m_mixers[mixer::SPEAKER]);
 
     try {
       if (cmd.compare(0, strlen(EVENT_TOGGLE_MUTE), EVENT_TOGGLE_MUTE) == 0) {
@@ -1,3 +1,4 @@
+#include <fcntl.h>
 #include <csignal>
 
 #include "utils/command.hpp"
@@ -7,11 +8,18 @@
 LEMONBUDDY_NS
 
 namespace command_util {
-  command::command(const logger& logger, string cmd)
-      : m_log(logger), m_cmd("/usr/bin/env\nsh\n-c\n" + cmd) {
-    if (pipe(m_stdin) != 0)
+  /**
+   * Construct command
+   *
+   * @param direct Execute the command without `sh -c` if it contains no shell syntax
+   */
+  command::command(const logger& logger, string cmd, bool direct)
+      : m_log(logger), m_cmd(move(cmd)), m_direct(direct) {
+    // The ends used by the child are duplicated onto its standard streams,
+    // the others must not leak into it
+    if (pipe2(m_stdin, O_CLOEXEC) != 0)
       throw command_strerror("Failed to allocate input stream");
-    if (pipe(m_stdout) != 0)
+    if (pipe2(m_stdout, O_CLOEXEC) != 0)
       throw command_strerror("Failed to allocate output stream");
   }
 
@@ -33,46 +41,22 @@ namespace command_util {
    * Execute the command
    */
   int command::exec(bool wait_for_completion) {
-    if ((m_forkpid = fork()) == -1)
-      throw system_error("Failed to fork process");
-
-    if (process_util::in_forked_process(m_forkpid)) {
-      if (dup2(m_stdin[PIPE_READ], STDIN_FILENO) == -1)
-        throw command_strerror("Failed to redirect stdin in child process");
-      if (dup2(m_stdout[PIPE_WRITE], STDOUT_FILENO) == -1)
-        throw command_strerror("Failed to redirect stdout in child process");
-      if (dup2(m_stdout[PIPE_WRITE], STDERR_FILENO) == -1)
-        throw command_strerror("Failed to redirect stderr in child process");
-
-      // Close file descriptors that won't be used by the child
-      if ((m_stdin[PIPE_READ] = close(m_stdin[PIPE_READ])) == -1)
-        throw command_strerror("Failed to close fd");
-      if ((m_stdin[PIPE_WRITE] = close(m_stdin[PIPE_WRITE])) == -1)
-        throw command_strerror("Failed to close fd");
-      if ((m_stdout[PIPE_READ] = close(m_stdout[PIPE_READ])) == -1)
-        throw command_strerror("Failed to close fd");
-      if ((m_stdout[PIPE_WRITE] = close(m_stdout[PIPE_WRITE])) == -1)
-        throw command_strerror("Failed to close fd");
-
-      // Make sure SIGTERM is raised
-      process_util::unblock_signal(SIGTERM);
-
-      setpgid(m_forkpid, 0);
-      process_util::exec(m_cmd);
-
-      throw command_error("Exec failed");
-    } else {
-      // Close file descriptors that won't be used by the parent
-      if ((m_stdin[PIPE_READ] = close(m_stdin[PIPE_READ])) == -1)
-        throw command_strerror("Failed to close fd");
-      if ((m_stdout[PIPE_WRITE] = close(m_stdout[PIPE_WRITE])) == -1)
-        throw command_strerror("Failed to close fd");
-
-      if (wait_for_completion) {
-        auto status = wait();
-        m_forkpid = -1;
-        return status;
-      }
+    m_forkpid = process_util::spawn(
+        m_cmd, m_stdin[PIPE_READ], m_stdout[PIPE_WRITE], m_stdout[PIPE_WRITE], m_direct);
+
+    if (m_forkpid == -1)
+      throw command_strerror("Failed to spawn process");
+
+    // Close file descriptors that won't be used by the parent
+    if ((m_stdin[PIPE_READ] = close(m_stdin[PIPE_READ])) == -1)
+      throw command_strerror("Failed to close fd");
+    if ((m_stdout[PIPE_WRITE] = close(m_stdout[PIPE_WRITE])) == -1)
+      throw command_strerror("Failed to close fd");
+
+    if (wait_for_completion) {
+      auto status = wait();
+      m_forkpid = -1;
+      return status;
     }
 
     return EXIT_SUCCESS;
@@ -134,7 +118,20 @@ namespace command_util {
    * end until the stream is closed
    */
   void command::tail(callback<string> callback) {
-    io_util::tail(m_stdout[PIPE_READ], callback);
+    auto on_line = [&](const char* line, size_t len) { callback(string{line, len}); };
+
+    std::unique_lock<threading_util::spin_lock> lck(m_pipelock);
+    while (!m_lines.empty()) {
+      auto line = move(m_lines.front());
+      m_lines.pop_front();
+      callback(move(line));
+    }
+    lck.unlock();
+
+    while (m_reader.read(m_stdout[PIPE_READ], on_line)) {
+    }
+
+    m_reader.flush(on_line);
   }
 
   /**
@@ -150,7 +147,20 @@ namespace command_util {
    */
   string command::readline() {
     std::lock_guard<threading_util::spin_lock> lck(m_pipelock);
-    return io_util::readline(m_stdout[PIPE_READ]);
+
+    auto on_line = [&](const char* line, size_t len) { m_lines.emplace_back(line, len); };
+
+    while (m_lines.empty() && m_reader.read(m_stdout[PIPE_READ], on_line)) {
+    }
+
+    if (m_lines.empty())
+      m_reader.flush(on_line);
+    if (m_lines.empty())
+      return "";
+
+    auto line = move(m_lines.front());
+    m_lines.pop_front();
+    return line;
   }
 
   /**
@@ -3,6 +3,7 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <fstream>
 #include "utils/scope.hpp"
 
@@ -31,6 +32,89 @@ namespace file_util {
     return m_ptr;
   }
 
+  /**
+   * Construct reader, the file is opened on the first read
+   *
+   * @param capacity Initial size of the buffer, it grows to fit the whole file
+   */
+  file_reader::file_reader(string path, size_t capacity)
+      : m_path(move(path)), m_buffer(capacity > 0 ? capacity : 1) {}
+
+  /**
+   * Destructor: close the file descriptor
+   */
+  file_reader::~file_reader() {
+    close();
+  }
+
+  /**
+   * Read the whole file from the start
+   *
+   * The file is reopened on the next call if reading
+   * fails, i.e. when the device behind it got removed
+   */
+  bool file_reader::read() {
+    if (m_fd == -1 && (m_fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC)) == -1)
+      return false;
+
+    m_size = 0;
+
+    while (true) {
+      if (m_size == m_buffer.size())
+        m_buffer.resize(m_buffer.size() * 2);
+
+      auto bytes = pread(m_fd, m_buffer.data() + m_size, m_buffer.size() - m_size, m_size);
+
+      if (bytes == -1 && errno == EINTR) {
+        continue;
+      } else if (bytes == -1) {
+        m_size = 0;
+        close();
+        return false;
+      }
+
+      m_size += bytes;
+
+      // Files on procfs and sysfs only return less than requested at the end
+      if (m_size < m_buffer.size())
+        return true;
+    }
+  }
+
+  /**
+   * Get the start of the contents
+   */
+  const char* file_reader::begin() const {
+    return m_buffer.data();
+  }
+
+  /**
+   * Get the end of the contents
+   */
+  const char* file_reader::end() const {
+    return m_buffer.data() + m_size;
+  }
+
+  /**
+   * Get the size of the contents
+   */
+  size_t file_reader::size() const {
+    return m_size;
+  }
+
+  /**
+   * Get the path of the file
+   */
+  const string& file_reader::path() const {
+    return m_path;
+  }
+
+  void file_reader::close() {
+    if (m_fd != -1)
+      ::close(m_fd);
+    m_fd = -1;
+  }
+
   /**
    * Checks if the given file exist
    */
@@ -82,6 +166,24 @@ namespace file_util {
     fstat(fd, &statbuf);
     return S_ISFIFO(statbuf.st_mode);
   }
+
+  /**
+   * Parse the unsigned number at given position, skipping leading blanks
+   *
+   * Returns the position following the number, or nullptr if there is no number
+   */
+  const char* parse_uint(const char* pos, const char* end, unsigned long long& value) {
+    while (pos < end && (*pos == ' ' || *pos == '\t')) pos++;
+
+    if (pos == end || *pos < '0' || *pos > '9')
+      return nullptr;
+
+    value = 0;
+
+    while (pos < end && *pos >= '0' && *pos <= '9') value = value * 10 + (*pos++ - '0');
+
+    return pos;
+  }
 }
 
 LEMONBUDDY_NS_END
@@ -53,6 +53,8 @@ namespace inotify_util {
 
   /**
    * Get the latest inotify event
+   *
+   * All events read at once are merged into one
    */
   unique_ptr<event_t> inotify_watch::get_event() {
     auto event = make_unique<event_t>();
@@ -60,21 +62,19 @@ namespace inotify_util {
     if (m_fd == -1 || m_wd == -1)
       return event;
 
-    char buffer[1024];
-    size_t bytes = read(m_fd, buffer, 1024);
-    size_t len = 0;
+    alignas(::inotify_event) char buffer[EVENT_BUFFER_SIZE];
+    auto bytes = read(m_fd, buffer, sizeof(buffer));
 
-    while (len < bytes) {
-      auto* e = reinterpret_cast<::inotify_event*>(&buffer[len]);
+    if (bytes <= 0)
+      return event;
 
+    for_each_event(buffer, bytes, [&](const ::inotify_event* e) {
       event->filename = e->len ? e->name : m_path;
       event->wd = e->wd;
       event->cookie = e->cookie;
       event->is_dir = e->mask & IN_ISDIR;
       event->mask |= e->mask;
-
-      len += sizeof(event_t) + e->len;
-    }
+    });
 
     return event;
   }
@@ -86,10 +86,38 @@ namespace inotify_util {
     return m_path;
   }
 
+  /**
+   * Get the inotify file descriptor
+   */
+  int inotify_watch::get_file_descriptor() const {
+    return m_fd;
+  }
+
   watch_t make_watch(string path) {
     di::injector<watch_t> injector = di::make_injector(di::bind<>().to(path));
     return injector.create<watch_t>();
   }
+
+  /**
+   * Visit the events of a buffer filled by reading an inotify fd
+   *
+   * Each event is followed by its name, padded to the alignment
+   * of the next event
+   */
+  void for_each_event(const char* buffer, size_t len, const callback<const ::inotify_event*>& cb) {
+    size_t offset{0};
+
+    while (offset + sizeof(::inotify_event) <= len) {
+      auto e = reinterpret_cast<const ::inotify_event*>(buffer + offset);
+
+      if (offset + sizeof(::inotify_event) + e->len > len)
+        break;
+
+      cb(e);
+
+      offset += sizeof(::inotify_event) + e->len;
+    }
+  }
 }
 
 LEMONBUDDY_NS_END
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "utils/io.hpp"
@@ -113,6 +114,150 @@ namespace io_util {
     char end[1] = {'\n'};
     ::write(write_fd, end, 1);
   }
+
+  // class : line_reader {{{
+
+  /**
+   * Construct line reader
+   *
+   * @param max_length Size of the buffer and therefore the longest line
+   */
+  line_reader::line_reader(size_t max_length) : m_capacity(max_length > 0 ? max_length : 1) {}
+
+  /**
+   * Read the available data and pass on the complete lines
+   *
+   * Works with both blocking and non-blocking descriptors, reading stops
+   * once a read returns less than requested or would block.
+   *
+   * @return False on EOF or error, with errno set for the latter
+   */
+  bool line_reader::read(int fd, const line_cb& on_line) {
+    // Allocated on first use since many readers never see any data
+    if (m_buffer.empty())
+      m_buffer.resize(m_capacity);
+
+    for (int i = 0; i < MAX_READS; i++) {
+      // The buffer is full and holds no newline
+      if (m_size == m_capacity) {
+        if (!m_discard) {
+          emit(m_size, on_line);
+          m_truncated++;
+        }
+        consume(m_size);
+        m_discard = true;
+      }
+
+      size_t available{m_capacity - m_size};
+      size_t tail{(m_head + m_size) % m_capacity};
+
+      iovec iov[2];
+      iov[0].iov_base = &m_buffer[tail];
+      iov[0].iov_len = std::min(available, m_capacity - tail);
+      iov[1].iov_base = &m_buffer[0];
+      iov[1].iov_len = available - iov[0].iov_len;
+
+      ssize_t bytes{readv(fd, iov, iov[1].iov_len > 0 ? 2 : 1)};
+
+      if (bytes == -1 && errno == EINTR) {
+        continue;
+      } else if (bytes == -1) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      } else if (bytes == 0) {
+        return false;
+      }
+
+      m_size += bytes;
+      split(on_line);
+
+      if (static_cast<size_t>(bytes) < available)
+        break;
+    }
+
+    return true;
+  }
+
+  /**
+   * Pass on the remaining incomplete line, i.e. once EOF is reached
+   */
+  void line_reader::flush(const line_cb& on_line) {
+    if (m_size > 0 && !m_discard)
+      emit(m_size, on_line);
+    consume(m_size);
+    m_discard = false;
+  }
+
+  /**
+   * Drop the buffered data
+   */
+  void line_reader::reset() {
+    consume(m_size);
+    m_discard = false;
+  }
+
+  /**
+   * Get the amount of buffered bytes
+   */
+  size_t line_reader::size() const {
+    return m_size;
+  }
+
+  /**
+   * Get the amount of lines that got truncated
+   */
+  size_t line_reader::truncated() const {
+    return m_truncated;
+  }
+
+  /**
+   * Find the newlines in the data that hasn't been scanned yet
+   */
+  void line_reader::split(const line_cb& on_line) {
+    while (m_scanned < m_size) {
+      size_t pos{(m_head + m_scanned) % m_capacity};
+      size_t segment{std::min(m_size - m_scanned, m_capacity - pos)};
+      auto newline = static_cast<const char*>(memchr(&m_buffer[pos], '\n', segment));
+
+      if (newline == nullptr) {
+        m_scanned += segment;
+        continue;
+      }
+
+      size_t length{m_scanned + (newline - &m_buffer[pos])};
+
+      if (m_discard)
+        m_discard = false;
+      else
+        emit(length, on_line);
+
+      consume(length + 1);
+    }
+  }
+
+  /**
+   * Pass on the line at the start of the buffer
+   */
+  void line_reader::emit(size_t length, const line_cb& on_line) {
+    if (m_head + length <= m_capacity) {
+      on_line(&m_buffer[m_head], length);
+    } else {
+      size_t first{m_capacity - m_head};
+      m_scratch.assign(&m_buffer[m_head], first);
+      m_scratch.append(&m_buffer[0], length - first);
+      on_line(m_scratch.data(), length);
+    }
+  }
+
+  /**
+   * Remove data from the start of the buffer
+   */
+  void line_reader::consume(size_t length) {
+    m_size -= length;
+    m_head = m_size > 0 ? (m_head + length) % m_capacity : 0;
+    m_scanned = 0;
+  }
+
+  // }}}
 }
 
 LEMONBUDDY_NS_END
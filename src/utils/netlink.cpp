@@ -0,0 +1,124 @@
+#include <sys/socket.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include "utils/netlink.hpp"
+
+LEMONBUDDY_NS
+
+namespace netlink_util {
+  /**
+   * Send request and pass the messages of the reply to given callback
+   *
+   * The socket may only be used by one request at a time. Replies to
+   * earlier requests that timed out are skipped. Returns false and sets
+   * errno if the request could not be sent, no reply was received or
+   * the kernel rejected it
+   */
+  bool request(int fd, nlmsghdr* req, vector<char>& buffer, const message_cb& on_message) {
+    static std::atomic<uint32_t> sequence{0};
+
+    auto seq = req->nlmsg_seq = ++sequence;
+
+    if (send(fd, req, req->nlmsg_len, 0) == -1)
+      return false;
+
+    while (true) {
+      auto len = recv(fd, buffer.data(), buffer.size(), 0);
+
+      if (len == -1 && errno == EINTR)
+        continue;
+      else if (len == -1)
+        return false;
+
+      if (len == 0) {
+        errno = ECONNRESET;
+        return false;
+      }
+
+      auto msg = reinterpret_cast<const nlmsghdr*>(buffer.data());
+
+      for (; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len)) {
+        if (msg->nlmsg_seq != seq)
+          continue;
+
+        if (msg->nlmsg_type == NLMSG_DONE) {
+          return true;
+        } else if (msg->nlmsg_type == NLMSG_ERROR) {
+          auto err = reinterpret_cast<const nlmsgerr*>(NLMSG_DATA(msg));
+          errno = -err->error;
+          return err->error == 0;
+        }
+
+        on_message(msg);
+
+        if (!(msg->nlmsg_flags & NLM_F_MULTI))
+          return true;
+      }
+    }
+  }
+
+  /**
+   * Append attribute to the message
+   *
+   * @param capacity Size of the buffer holding the message
+   */
+  void put_attribute(nlmsghdr* msg, size_t capacity, uint16_t type, const void* data, size_t len) {
+    auto offset = NLMSG_ALIGN(msg->nlmsg_len);
+    auto size = NLA_ALIGN(NLA_HDRLEN + len);
+
+    if (offset + size > capacity)
+      throw application_error("Netlink message exceeds its buffer");
+
+    auto attr = reinterpret_cast<nlattr*>(reinterpret_cast<char*>(msg) + offset);
+    attr->nla_type = type;
+    attr->nla_len = NLA_HDRLEN + len;
+    memcpy(reinterpret_cast<char*>(attr) + NLA_HDRLEN, data, len);
+
+    msg->nlmsg_len = offset + size;
+  }
+
+  /**
+   * Visit the attributes in given payload
+   */
+  void for_each_attribute(const void* data, size_t len, const attribute_cb& on_attribute) {
+    auto pos = static_cast<const char*>(data);
+    auto end = pos + len;
+
+    while (pos + NLA_HDRLEN <= end) {
+      auto attr = reinterpret_cast<const nlattr*>(pos);
+
+      if (attr->nla_len < NLA_HDRLEN || pos + attr->nla_len > end)
+        break;
+
+      on_attribute(attr);
+
+      pos += NLA_ALIGN(attr->nla_len);
+    }
+  }
+
+  /**
+   * Visit the KEY=VALUE pairs of a kobject uevent
+   *
+   * Accepts both the NUL separated payload broadcast on NETLINK_KOBJECT_UEVENT,
+   * whose header line ("action@devpath") is skipped, and the newline separated
+   * uevent files found in sysfs
+   */
+  void for_each_property(const char* data, size_t len, const property_cb& on_property) {
+    auto pos = data;
+    auto end = data + len;
+
+    while (pos < end) {
+      auto next = std::find_if(pos, end, [](char c) { return c == '\0' || c == '\n'; });
+      auto separator = std::find(pos, next, '=');
+
+      if (separator != next && separator != pos)
+        on_property(string{pos, separator}, string{separator + 1, next});
+
+      pos = next + 1;
+    }
+  }
+}
+
+LEMONBUDDY_NS_END
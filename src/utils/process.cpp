@@ -1,4 +1,6 @@
+#include <spawn.h>
 #include <sys/wait.h>
+#include <csignal>
 
 #include "utils/process.hpp"
 #include "utils/string.hpp"
@@ -40,6 +42,86 @@ namespace process_util {
     throw system_error("Failed to execute command");
   }
 
+  /**
+   * Check if the command uses any shell syntax and
+   * can therefore not be executed without `sh -c`
+   *
+   * Blank commands are left to the shell as well,
+   * since they don't name an executable
+   */
+  bool needs_shell(const string& cmd) {
+    return cmd.find_first_not_of(" \t") == string::npos ||
+           cmd.find_first_of("|&;<>()$`\\\"'*?[]#~={}!\n") != string::npos;
+  }
+
+  /**
+   * Spawn command in a new process group with the given standard streams
+   *
+   * Uses posix_spawn, which glibc implements with clone(CLONE_VM | CLONE_VFORK),
+   * so the page tables of the calling process don't get copied. Commands
+   * without shell syntax are executed directly when `direct` is set, falling
+   * back to the shell if no such executable exists (i.e: builtins).
+   *
+   * @return Pid of the child, or -1 with errno set
+   */
+  pid_t spawn(const string& cmd, int in, int out, int err, bool direct) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t mask;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err, STDERR_FILENO);
+
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(
+        &attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    // Don't pass on the signals blocked or ignored by the application
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigaddset(&mask, SIGPIPE);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGCHLD);
+    posix_spawnattr_setsigdefault(&attr, &mask);
+
+    pid_t pid{-1};
+    int result{ENOENT};
+
+    if (direct && !needs_shell(cmd)) {
+      vector<string> args;
+      vector<char*> argv;
+
+      for (auto&& arg : string_util::split(string_util::replace_all(cmd, "\t", " "), ' ')) {
+        if (!arg.empty())
+          args.emplace_back(arg);
+      }
+      for (auto&& arg : args) argv.emplace_back(const_cast<char*>(arg.c_str()));
+      argv.emplace_back(nullptr);
+
+      result = posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), environ);
+    }
+
+    if (result == ENOENT) {
+      const char* argv[]{"sh", "-c", cmd.c_str(), nullptr};
+      result = posix_spawn(
+          &pid, "/bin/sh", &actions, &attr, const_cast<char* const*>(argv), environ);
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (result != 0) {
+      errno = result;
+      return -1;
+    }
+
+    return pid;
+  }
+
   /**
    * Wait for child process
    */
@@ -0,0 +1,120 @@
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+#include "utils/threading.hpp"
+
+LEMONBUDDY_NS
+
+namespace threading_util {
+  constexpr int futex_lock::SPIN_LIMIT;
+
+  /**
+   * Acquire the lock, sleeping until it's released if spinning doesn't help
+   */
+  void futex_lock::lock() noexcept {
+    int state{0};
+
+    if (m_state.compare_exchange_strong(state, 1, std::memory_order_acquire))
+      return;
+
+    m_contentions.fetch_add(1, std::memory_order_relaxed);
+
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+      state = 0;
+      if (m_state.load(std::memory_order_relaxed) == 0 &&
+          m_state.compare_exchange_weak(state, 1, std::memory_order_acquire))
+        return;
+    }
+
+    // Flag the lock as contended so that unlock wakes up a waiter
+    state = m_state.exchange(2, std::memory_order_acquire);
+
+    while (state != 0) {
+      m_sleeps.fetch_add(1, std::memory_order_relaxed);
+      syscall(SYS_futex, reinterpret_cast<int*>(&m_state), FUTEX_WAIT_PRIVATE, 2, nullptr,
+          nullptr, 0);
+      state = m_state.exchange(2, std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * Acquire the lock if it's free
+   */
+  bool futex_lock::try_lock() noexcept {
+    int state{0};
+    return m_state.compare_exchange_strong(state, 1, std::memory_order_acquire);
+  }
+
+  /**
+   * Release the lock and wake up one of the waiters
+   */
+  void futex_lock::unlock() noexcept {
+    if (m_state.exchange(0, std::memory_order_release) == 2)
+      syscall(SYS_futex, reinterpret_cast<int*>(&m_state), FUTEX_WAKE_PRIVATE, 1, nullptr,
+          nullptr, 0);
+  }
+
+  /**
+   * Get the amount of lock calls that found the lock taken
+   */
+  size_t futex_lock::contentions() const {
+    return m_contentions.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Get the amount of times a caller went to sleep waiting for the lock
+   */
+  size_t futex_lock::sleeps() const {
+    return m_sleeps.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Construct callback_tracker
+   *
+   * @param owner Name of the object used when logging
+   */
+  callback_tracker::callback_tracker(const logger& logger, string owner)
+      : m_log(logger), m_owner(move(owner)) {}
+
+  /**
+   * Mark a call of the callback as in progress on this thread
+   *
+   * Requires the lock of the object to be held
+   */
+  void callback_tracker::enter(id_type id) {
+    m_calls.emplace_back(id, this_thread::get_id());
+  }
+
+  /**
+   * Wait for the calls of the removed callback made on other threads
+   *
+   * Calls made by this thread are in the call stack of the caller and
+   * therefore aren't waited for. Once this returns the callback won't be
+   * called anymore, so the caller must not hold a lock the callback takes
+   * other than the one of the object
+   */
+  void callback_tracker::wait(std::unique_lock<std::mutex>& guard, id_type id) {
+    m_left.wait(guard, [&] {
+      return std::find_if(m_calls.begin(), m_calls.end(), [&](const pair<id_type, thread::id>& c) {
+        return c.first == id && c.second != this_thread::get_id();
+      }) == m_calls.end();
+    });
+  }
+
+  /**
+   * Mark the call as finished and wake up the threads waiting for it
+   *
+   * Requires the lock of the object to be held
+   */
+  void callback_tracker::leave(id_type id) {
+    auto call = std::find(m_calls.begin(), m_calls.end(), make_pair(id, this_thread::get_id()));
+
+    if (call != m_calls.end())
+      m_calls.erase(call);
+
+    m_left.notify_all();
+  }
+}
+
+LEMONBUDDY_NS_END
@@ -1,4 +1,5 @@
 #include <xcb/xcbext.h>
+#include <algorithm>
 
 #include "utils/string.hpp"
 #include "x11/color.hpp"
@@ -53,6 +54,59 @@ namespace draw_util {
     xcb_ret.sequence = xcb_send_request(conn, 0, xcb_parts + 2, &xcb_req);
     return xcb_ret;
   }
+
+  /**
+   * Compose one PolyText16 request for the whole string
+   *
+   * The characters are given in host byte order and are split
+   * into as many text items as needed (254 characters each)
+   */
+  xcb_void_cookie_t xcb_poly_text_16_patched(xcb_connection_t* conn, xcb_drawable_t d,
+      xcb_gcontext_t gc, int16_t x, int16_t y, const vector<uint16_t>& str) {
+    static const xcb_protocol_request_t xcb_req = {
+        4,                 // count
+        0,                 // ext
+        XCB_POLY_TEXT_16,  // opcode
+        1                  // isvoid
+    };
+    static const size_t max_item_len = 254;
+
+    xcb_void_cookie_t xcb_ret{0};
+
+    if (str.empty())
+      return xcb_ret;
+
+    vector<uint8_t> items;
+    items.reserve(str.size() * 2 + (str.size() / max_item_len + 1) * 2);
+
+    for (size_t n = 0; n < str.size(); n += max_item_len) {
+      auto len = std::min(max_item_len, str.size() - n);
+      items.emplace_back(len);
+      items.emplace_back(0);
+      for (size_t i = n; i < n + len; i++) {
+        items.emplace_back(str[i] >> 8);
+        items.emplace_back(str[i] & 0xff);
+      }
+    }
+
+    struct iovec xcb_parts[6];
+    xcb_poly_text_16_request_t xcb_out;
+    xcb_out.pad0 = 0;
+    xcb_out.drawable = d;
+    xcb_out.gc = gc;
+    xcb_out.x = x;
+    xcb_out.y = y;
+    xcb_parts[2].iov_base = reinterpret_cast<char*>(&xcb_out);
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    xcb_parts[4].iov_base = items.data();
+    xcb_parts[4].iov_len = items.size();
+    xcb_parts[5].iov_base = 0;
+    xcb_parts[5].iov_len = -xcb_parts[4].iov_len & 3;
+    xcb_ret.sequence = xcb_send_request(conn, 0, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+  }
 }
 
 LEMONBUDDY_NS_END
@@ -4,8 +4,13 @@
 
 LEMONBUDDY_NS
 
-array<char, XFT_MAXCHARS> xft_widths;
-array<wchar_t, XFT_MAXCHARS> xft_chars;
+namespace {
+  /**
+   * Markers used in the memoized fallback tables
+   */
+  constexpr int8_t FALLBACK_UNRESOLVED{-2};
+  constexpr int8_t FALLBACK_NOTFOUND{-1};
+}
 
 fontmanager::fontmanager(connection& conn, const logger& logger)
     : m_connection(conn), m_logger(logger) {
@@ -15,7 +20,8 @@ fontmanager::fontmanager(connection& conn, const logger& logger)
 }
 
 fontmanager::~fontmanager() {
-  XftColorFree(m_display, m_visual, m_colormap, &m_xftcolor);
+  if (m_xftallocated)
+    XftColorFree(m_display, m_visual, m_colormap, &m_xftcolor);
   XFreeColormap(m_display, m_colormap);
   m_fonts.clear();
 }
@@ -35,7 +41,14 @@ void fontmanager::set_preferred_font(int index) {
 }
 
 bool fontmanager::load(string name, int fontindex, int offset_y) {
-  if (fontindex != -1 && m_fonts.find(fontindex) != m_fonts.end()) {
+  auto existing = m_fonts.find(fontindex);
+
+  // Bars sharing the font manager load the same fonts
+  if (existing != m_fonts.end() && existing->second->name == name &&
+      existing->second->offset_y == offset_y) {
+    m_logger.trace("fontmanager: Font '%s' already loaded at index '%i'", name, fontindex);
+    return true;
+  } else if (existing != m_fonts.end()) {
     m_logger.warn("A font with index '%i' has already been loaded, skip...", fontindex);
     return false;
   } else if (fontindex == -1) {
@@ -46,6 +59,7 @@ bool fontmanager::load(string name, int fontindex, int offset_y) {
   }
 
   m_fonts.emplace(make_pair(fontindex, font_t{new fonttype(), fonttype_deleter{}}));
+  m_fonts[fontindex]->name = name;
   m_fonts[fontindex]->offset_y = offset_y;
   m_fonts[fontindex]->ptr = 0;
   m_fonts[fontindex]->xft = nullptr;
@@ -59,9 +73,15 @@ bool fontmanager::load(string name, int fontindex, int offset_y) {
     m_fonts[fontindex]->height = m_fonts[fontindex]->ascent + m_fonts[fontindex]->descent;
     m_logger.trace("fontmanager: Successfully loaded Freetype font '%s'", name);
   } else {
+    m_fonts.erase(fontindex);
     return false;
   }
 
+  build_coverage(m_fonts[fontindex]);
+
+  // Previous fallback decisions may no longer hold
+  m_fallback.clear();
+
   int max_height = 0;
 
   for (auto& iter : m_fonts)
@@ -77,18 +97,17 @@ bool fontmanager::load(string name, int fontindex, int offset_y) {
 
 font_t& fontmanager::match_char(uint16_t chr) {
   static font_t notfound;
-  if (!m_fonts.empty()) {
-    if (m_fontindex != -1 && size_t(m_fontindex) <= m_fonts.size()) {
-      auto iter = m_fonts.find(m_fontindex);
-      if (iter != m_fonts.end() && has_glyph(iter->second, chr))
-        return iter->second;
-    }
-    for (auto& font : m_fonts) {
-      if (has_glyph(font.second, chr))
-        return font.second;
-    }
-  }
-  return notfound;
+
+  auto& table = m_fallback[m_fontindex];
+  if (table.empty())
+    table.resize(XFT_MAXCHARS, FALLBACK_UNRESOLVED);
+
+  if (table[chr] == FALLBACK_UNRESOLVED)
+    table[chr] = resolve_char(chr);
+  if (table[chr] == FALLBACK_NOTFOUND)
+    return notfound;
+
+  return m_fonts[table[chr]];
 }
 
 int fontmanager::char_width(font_t& font, uint16_t chr) {
@@ -102,34 +121,34 @@ int fontmanager::char_width(font_t& font, uint16_t chr) {
       return font->width;
   }
 
-  auto index = chr % XFT_MAXCHARS;
-  while (xft_chars[index] != 0 && xft_chars[index] != chr) index = (index + 1) % XFT_MAXCHARS;
+  if (font->widths.empty())
+    font->widths.resize(XFT_MAXCHARS, -1);
 
-  if (!xft_chars[index]) {
+  if (font->widths[chr] == -1) {
     XGlyphInfo gi;
     FT_UInt glyph = XftCharIndex(m_display, font->xft, (FcChar32)chr);
-    XftFontLoadGlyphs(m_display, font->xft, FcFalse, &glyph, 1);
+    // The glyph is kept loaded since it will be needed when drawing the text
     XftGlyphExtents(m_display, font->xft, &glyph, 1, &gi);
-    XftFontUnloadGlyphs(m_display, font->xft, &glyph, 1);
-    xft_chars[index] = chr;
-    xft_widths[index] = gi.xOff;
-    return gi.xOff;
-  } else if (xft_chars[index] == chr) {
-    return xft_widths[index];
+    font->widths[chr] = gi.xOff;
   }
 
-  return 0;
+  return font->widths[chr];
 }
 
 XftColor fontmanager::xftcolor() {
   return m_xftcolor;
 }
 
-void fontmanager::allocate_color(XRenderColor color, bool initial_alloc) {
-  if (!initial_alloc)
+void fontmanager::allocate_color(XRenderColor color) {
+  if (m_xftallocated && m_xftcolor.color.red == color.red &&
+      m_xftcolor.color.green == color.green && m_xftcolor.color.blue == color.blue &&
+      m_xftcolor.color.alpha == color.alpha)
+    return;
+
+  if (m_xftallocated)
     XftColorFree(m_display, m_visual, m_colormap, &m_xftcolor);
 
-  if (!XftColorAllocValue(m_display, m_visual, m_colormap, &color, &m_xftcolor))
+  if (!(m_xftallocated = XftColorAllocValue(m_display, m_visual, m_colormap, &color, &m_xftcolor)))
     m_logger.err("Failed to allocate color");
 }
 
@@ -176,18 +195,48 @@ bool fontmanager::open_xcb_font(font_t& fontptr, string fontname) {
   return false;
 }
 
-bool fontmanager::has_glyph(font_t& font, uint16_t chr) {
+void fontmanager::build_coverage(font_t& font) {
+  font->coverage.assign(XFT_MAXCHARS, false);
+
   if (font->xft != nullptr) {
-    return XftCharExists(m_display, font->xft, (FcChar32)chr) == true;
+    FcChar32 page[FC_CHARSET_MAP_SIZE];
+    FcChar32 next;
+
+    // Walk the fontconfig charset one page (256 chars) at a time
+    for (FcChar32 base = FcCharSetFirstPage(font->xft->charset, page, &next);
+         base != FC_CHARSET_DONE && base < XFT_MAXCHARS;
+         base = FcCharSetNextPage(font->xft->charset, page, &next)) {
+      for (FcChar32 i = 0; i < FC_CHARSET_MAP_SIZE; i++) {
+        for (FcChar32 bit = 0; page[i] != 0 && bit < 32; bit++) {
+          if (page[i] & (1U << bit))
+            font->coverage[base + i * 32 + bit] = true;
+        }
+      }
+    }
   } else {
-     if (chr < font->char_min || chr > font->char_max)
-      return false;
-    if (static_cast<size_t>(chr - font->char_min) >= font->width_lut.size())
-      return false;
-    if (font->width_lut[chr - font->char_min].character_width == 0)
-      return false;
-    return true;
+    for (size_t i = 0; i < font->width_lut.size(); i++) {
+      size_t chr = font->char_min + i;
+      if (chr < XFT_MAXCHARS && chr <= font->char_max && font->width_lut[i].character_width != 0)
+        font->coverage[chr] = true;
+    }
+  }
+}
+
+bool fontmanager::has_glyph(font_t& font, uint16_t chr) {
+  return font->coverage[chr];
+}
+
+int fontmanager::resolve_char(uint16_t chr) {
+  if (m_fontindex != -1) {
+    auto iter = m_fonts.find(m_fontindex);
+    if (iter != m_fonts.end() && has_glyph(iter->second, chr))
+      return iter->first;
+  }
+  for (auto& font : m_fonts) {
+    if (has_glyph(font.second, chr))
+      return font.first;
   }
+  return FALLBACK_NOTFOUND;
 }
 
 LEMONBUDDY_NS_END
@@ -0,0 +1,102 @@
+#include <X11/Xlib-xcb.h>
+#include <fstream>
+#include <iomanip>
+
+#include "components/bar.hpp"
+#include "x11/xutils.hpp"
+
+/**
+ * Measures the amount of X requests and the wall time spent in
+ * bar::render when rendering long labels in each alignment block
+ *
+ * Requires a running X server (e.g, Xvfb). Only the public bar api
+ * is used so that the results can be compared between revisions.
+ *
+ * Usage: benchmark.components_bar [frames] [font]
+ */
+int main(int argc, char** argv) {
+  using namespace lemonbuddy;
+
+  XInitThreads();
+
+  xcb_connection_t* conn;
+
+  if ((conn = xutils::get_connection()) == nullptr) {
+    std::cerr << "A connection to X could not be established" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int frames{argc > 1 ? std::atoi(argv[1]) : 500};
+  string font{argc > 2 ? argv[2] : "fixed"};
+  string path{"/tmp/lemonbuddy-benchmark.ini"};
+
+  std::ofstream(path) << "[bar/benchmark]\n"
+                      << "width = 100%\n"
+                      << "height = 24\n"
+                      << "lineheight = 2\n"
+                      << "font-0 = " << font << "\n";
+
+  config& conf{configure_config<decltype(conf)>().create<decltype(conf)>()};
+  conf.load(path, "benchmark");
+
+  auto renderer = configure_bar().create<unique_ptr<bar>>();
+  renderer->bootstrap();
+
+  string label;
+  while (label.length() < 200) label += "lorem ipsum dolor sit amet ";
+
+  // Inputs consisting of a single frame are repainted in full on each
+  // iteration, otherwise the frames are cycled through as regular updates
+  // clang-format off
+  vector<pair<string, vector<string>>> markup{
+    {"left", {"%{l}" + label}},
+    {"center", {"%{c}" + label}},
+    {"right", {"%{r}" + label}},
+    {"attributes", {"%{l}%{F#f00 +u}" + label + "%{F- -u}%{c}%{B#00f +o}" + label + "%{B- -o}%{r}%{A1:foo:}" + label + "%{A}"}},
+    {"clock", {"%{l}" + label + "%{r}12:00:01", "%{l}" + label + "%{r}12:00:02"}},
+  };
+  // clang-format on
+
+  // The display lists are built up front, the same way as the controller
+  // splices them together, so that only the rendering is measured
+  vector<pair<string, vector<display_list>>> inputs;
+  bar_settings settings{renderer->settings()};
+
+  for (auto&& input : markup) {
+    inputs.emplace_back(input.first, vector<display_list>{});
+
+    for (auto&& frame : input.second) {
+      inputs.back().second.emplace_back();
+      parser<display_list> recorder(settings, inputs.back().second.back());
+      recorder(frame);
+    }
+  }
+
+  std::cout << std::setw(12) << std::left << "input" << std::setw(16) << std::right
+            << "requests/frame" << std::setw(16) << "us/frame" << std::endl;
+
+  for (auto&& input : inputs) {
+    // The sequence number of a no-op request tells how many requests have been sent
+    // on the connection, including the ones sent through Xlib/Xft
+    auto first = xcb_no_operation(conn).sequence;
+    auto start = chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < frames; i++) {
+      renderer->render(input.second[i % input.second.size()], input.second.size() == 1);
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    auto last = xcb_no_operation(conn).sequence;
+
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+
+    std::cout << std::setw(12) << std::left << input.first << std::setw(16) << std::right
+              << std::fixed << std::setprecision(1) << (last - first - 1) / double(frames)
+              << std::setw(16) << elapsed / double(frames) << std::endl;
+  }
+
+  renderer.reset();
+  unlink(path.c_str());
+
+  return EXIT_SUCCESS;
+}
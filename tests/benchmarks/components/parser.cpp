@@ -0,0 +1,108 @@
+#include <iomanip>
+#include <iostream>
+
+#include "components/parser.hpp"
+
+/**
+ * Measures the throughput of the markup parser using
+ * a sink that only counts the reported tokens
+ *
+ * Usage: benchmark.components_parser [iterations]
+ */
+int main(int argc, char** argv) {
+  using namespace lemonbuddy;
+
+  struct counting_sink {
+    size_t tags{0};
+    size_t chars{0};
+    size_t strings{0};
+
+    void on_alignment_change(alignment) {
+      tags++;
+    }
+    void on_attribute_set(attribute) {
+      tags++;
+    }
+    void on_attribute_unset(attribute) {
+      tags++;
+    }
+    void on_attribute_toggle(attribute) {
+      tags++;
+    }
+    void on_action_block_open(mousebtn, string) {
+      tags++;
+    }
+    void on_action_block_close(mousebtn) {
+      tags++;
+    }
+    void on_color_change(gc, color) {
+      tags++;
+    }
+    void on_color_reset(gc) {
+      tags++;
+    }
+    void on_font_change(int) {
+      tags++;
+    }
+    void on_pixel_offset(int) {
+      tags++;
+    }
+    void on_character_write(uint16_t) {
+      chars++;
+    }
+    void on_string_write(const char*, size_t len) {
+      chars += len;
+      strings++;
+    }
+  };
+
+  int iterations{argc > 1 ? std::atoi(argv[1]) : 10000};
+
+  string label;
+  while (label.length() < 200) label += "lorem ipsum dolor sit amet ";
+
+  string glyphs;
+  while (glyphs.length() < 600) glyphs += "\xe2\x96\x88\xc3\xa5";
+
+  string modules;
+  for (int i = 0; i < 20; i++) {
+    modules += "%{A1:cmd" + to_string(i) + ":}%{F#f00 +u} \xe2\x86\x91 " + label.substr(0, 40) +
+               "%{F- -u}%{A}%{O5}";
+  }
+
+  // clang-format off
+  vector<pair<string, string>> inputs{
+    {"text", "%{l}" + label + label + label},
+    {"unicode", "%{c}" + glyphs},
+    {"modules", "%{l}" + modules + "%{c}" + modules + "%{r}" + modules},
+  };
+  // clang-format on
+
+  bar_settings bar;
+
+  std::cout << std::setw(12) << std::left << "input" << std::setw(12) << std::right << "bytes"
+            << std::setw(12) << "tokens" << std::setw(16) << "ns/iteration" << std::setw(12)
+            << "MB/s" << std::endl;
+
+  for (auto&& input : inputs) {
+    counting_sink sink;
+    parser<counting_sink> markup(bar, sink);
+
+    auto start = chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+      markup(input.second);
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(finish - start).count();
+    auto tokens = (sink.tags + sink.chars) / iterations;
+
+    std::cout << std::setw(12) << std::left << input.first << std::setw(12) << std::right
+              << input.second.length() << std::setw(12) << tokens << std::setw(16)
+              << elapsed / iterations << std::setw(12) << std::fixed << std::setprecision(1)
+              << input.second.length() * iterations * 1e3 / elapsed << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
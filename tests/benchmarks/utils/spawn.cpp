@@ -0,0 +1,76 @@
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <iomanip>
+#include <iostream>
+
+#include "utils/process.hpp"
+
+/**
+ * Measures the amount of commands spawned per second using fork and
+ * posix_spawn, with and without the shell wrapper. The heap is
+ * populated first since fork has to copy the page tables covering it
+ *
+ * Usage: benchmark.utils_spawn [iterations] [heap-mb]
+ */
+int main(int argc, char** argv) {
+  using namespace lemonbuddy;
+
+  int iterations{argc > 1 ? std::atoi(argv[1]) : 500};
+  size_t heap{argc > 2 ? size_t(std::atoi(argv[2])) : 256};
+
+  vector<char> ballast(heap * 1024 * 1024, 1);
+  for (size_t i = 0; i < ballast.size(); i += 4096) ballast[i] = char(i);
+
+  int devnull{open("/dev/null", O_RDWR | O_CLOEXEC)};
+  string cmd{"true"};
+
+  // The previous implementation of command_util::command::exec
+  auto forked = [&] {
+    pid_t pid{fork()};
+    if (pid == 0) {
+      dup2(devnull, STDIN_FILENO);
+      dup2(devnull, STDOUT_FILENO);
+      dup2(devnull, STDERR_FILENO);
+      setpgid(0, 0);
+      execlp("/usr/bin/env", "/usr/bin/env", "sh", "-c", cmd.c_str(), nullptr);
+      _exit(127);
+    }
+    return pid;
+  };
+
+  // clang-format off
+  vector<pair<string, function<pid_t()>>> methods{
+    {"fork+sh", forked},
+    {"spawn+sh", [&] { return process_util::spawn(cmd, devnull, devnull, devnull, false); }},
+    {"spawn", [&] { return process_util::spawn(cmd, devnull, devnull, devnull, true); }},
+  };
+  // clang-format on
+
+  std::cout << "heap: " << heap << " MB" << std::endl;
+  std::cout << std::setw(12) << std::left << "method" << std::setw(16) << std::right
+            << "us/spawn" << std::setw(16) << "spawns/s" << std::endl;
+
+  for (auto&& method : methods) {
+    auto start = chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+      pid_t pid{method.second()};
+      if (pid == -1) {
+        std::cerr << method.first << ": spawn failed" << std::endl;
+        return EXIT_FAILURE;
+      }
+      waitpid(pid, nullptr, 0);
+    }
+
+    auto finish = chrono::high_resolution_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(finish - start).count();
+
+    std::cout << std::setw(12) << std::left << method.first << std::setw(16) << std::right
+              << elapsed / iterations << std::setw(16) << std::fixed << std::setprecision(1)
+              << iterations * 1e6 / elapsed << std::endl;
+  }
+
+  close(devnull);
+
+  return EXIT_SUCCESS;
+}
@@ -7,8 +7,11 @@
 //
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <thread>
 
 #define expect(...) \
   (void)((__VA_ARGS__) || (expect_fail__(#__VA_ARGS__, __FILE__, __LINE__), 0))
@@ -36,3 +39,27 @@ template <class T, T... Chars>
 constexpr auto operator""_test() {
   return test<Chars...>{};
 }
+
+/**
+ * Poll until the condition holds, for tests waiting on other threads
+ *
+ * The timeout is generous so that tests don't fail on a loaded machine,
+ * passing tests return as soon as the condition holds
+ */
+template <class Condition>
+bool wait_until(
+    const Condition& condition, std::chrono::milliseconds timeout = std::chrono::seconds{5}) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() >= deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+
+  return true;
+}
+
+inline bool wait_for(const std::atomic_int& value, int expected) {
+  return wait_until([&] { return value == expected; });
+}
@@ -0,0 +1,66 @@
+#include "adapters/icmp.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+  scheduler sched{log, 2, 0ms};
+  reactor r{log};
+
+  "loopback"_test = [&] {
+    net::icmp_prober prober{log, sched, r, "127.0.0.1"};
+    std::atomic_int results{0};
+
+    prober.start(10ms, 500ms, 3, [&](const net::probe_stats&) { results++; });
+
+    expect(wait_until([&] { return results >= 5; }));
+    prober.stop();
+
+    auto stats = prober.stats();
+    expect(stats.sent == size_t{3});
+    expect(stats.lost == size_t{0});
+    expect(stats.loss() == 0);
+    expect(stats.latency < 500ms);
+
+    // No results are passed on once stopped
+    auto count = results.load();
+    this_thread::sleep_for(30ms);
+    expect(results == count);
+  };
+
+  "loss"_test = [&] {
+    net::icmp_prober prober{log, sched, r, "127.0.0.1"};
+    std::atomic_int results{0};
+
+    // Keep the reactor busy so that the replies arrive too late
+    int fds[2];
+    expect(pipe(fds) == 0);
+    auto blocker = r.add(fds[0], EPOLLIN, [&](uint32_t) { this_thread::sleep_for(200ms); });
+    expect(write(fds[1], "x", 1) == 1);
+    this_thread::sleep_for(10ms);
+
+    prober.start(10ms, 20ms, 4, [&](const net::probe_stats&) { results++; });
+
+    expect(wait_until([&] { return results >= 4; }));
+    prober.stop();
+
+    auto stats = prober.stats();
+    expect(stats.sent == size_t{4});
+    expect(stats.lost == size_t{4});
+    expect(stats.loss() == 100);
+
+    r.remove(blocker);
+    close(fds[0]);
+    close(fds[1]);
+  };
+
+  "address"_test = [&] {
+    bool thrown{false};
+    try {
+      net::icmp_prober prober{log, sched, r, "not an address"};
+    } catch (const application_error&) {
+      thrown = true;
+    }
+    expect(thrown);
+  };
+}
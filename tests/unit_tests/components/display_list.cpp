@@ -0,0 +1,56 @@
+#include "components/display_list.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  bar_settings bar;
+
+  auto record = [&](string input) {
+    display_list contents;
+    parser<display_list> markup(bar, contents);
+    markup(input);
+    return contents;
+  };
+
+  "text"_test = [&] {
+    display_list contents;
+    contents.text("foo", 3);
+    contents.text(" bar", 4);
+    expect(contents.size() == 1);
+    expect(contents.markup() == "foo bar");
+  };
+
+  "roundtrip"_test = [&] {
+    string input{"%{l}%{F#ffff0000}a\xc3\xa5%{F-}%{c}%{+u}%{T2}b%{T-}%{-u}"};
+    input += "%{r}%{O10}%{A3:x\\:y:}c%{A}";
+    expect(record(input).markup() == input);
+    expect(record(record(input).markup()) == record(input));
+  };
+
+  "merge_colors"_test = [&] {
+    expect(record("%{F#f00}%{F#0f0}").size() == 1);
+    expect(record("%{F-}%{B#f00}%{F#0f0}").markup() == "%{F#FF00ff00}%{B#FFff0000}");
+    expect(record("%{U#f00}%{U-}").size() == 2);
+    expect(record("%{F#f00}a%{F-}").size() == 3);
+  };
+
+  "merge_fonts"_test = [&] {
+    expect(record("%{T-}%{T3}").markup() == "%{T3}");
+  };
+
+  "remove_trailing"_test = [&] {
+    auto contents = record("%{F#f00}a  ");
+    expect(contents.remove_trailing(' ', 2));
+    expect(contents.markup() == "%{F#FFff0000}a");
+    expect(!contents.remove_trailing(' ', 1));
+    expect(contents.remove_trailing('a', 1));
+    expect(contents.size() == 1);
+  };
+
+  "replay"_test = [&] {
+    auto contents = record("%{B#f00}a%{A:b:}c%{A}");
+    display_list copy;
+    contents.replay(copy);
+    expect(copy == contents);
+  };
+}
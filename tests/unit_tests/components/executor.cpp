@@ -0,0 +1,152 @@
+#include <csignal>
+
+#include "components/executor.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+  scheduler sched{log, 2, 0ms};
+  reactor r{log};
+  supervisor sv{log, r};
+
+  auto store = [](std::atomic_int& status) {
+    return [&status](const supervisor::child_status& child) { status = child.status; };
+  };
+
+  "output"_test = [&] {
+    executor e{log, sched, r, sv, 2, 1s};
+
+    vector<string> lines;
+    std::atomic_int status{-1};
+
+    auto on_line = [&](string line) { lines.emplace_back(line); };
+    e.run("printf 'foo\\nbar\\nbaz'", on_line, store(status));
+
+    expect(wait_for(status, 0));
+    expect(lines.size() == size_t{3});
+    expect(lines[0] == "foo");
+    expect(lines[1] == "bar");
+    expect(lines[2] == "baz");
+  };
+
+  "direct"_test = [&] {
+    executor e{log, sched, r, sv, 2, 1s, true};
+
+    vector<string> lines;
+    std::atomic_int status{-1};
+
+    e.run("echo  foo\tbar", [&](string line) { lines.emplace_back(line); }, store(status));
+
+    expect(wait_for(status, 0));
+    expect(lines.size() == size_t{1});
+    expect(lines[0] == "foo bar");
+
+    // Blank commands don't name an executable and are left to the shell
+    status = -1;
+    e.run(" \t ", nullptr, store(status));
+    expect(wait_for(status, 0));
+  };
+
+  "exit_status"_test = [&] {
+    executor e{log, sched, r, sv, 2, 1s};
+
+    std::atomic_int status{-1};
+    e.run("exit 3", nullptr, store(status));
+    expect(wait_for(status, 3));
+
+    status = -1;
+    e.run("/nonexistent/command", nullptr, store(status));
+    expect(wait_for(status, 127));
+  };
+
+  "deadline"_test = [&] {
+    executor e{log, sched, r, sv, 2, 1s};
+
+    std::atomic_int status{-1};
+    e.run("sleep 5", 50ms, nullptr, store(status));
+    expect(wait_for(status, 128 + SIGTERM));
+  };
+
+  "queue"_test = [&] {
+    executor e{log, sched, r, sv, 1, 1s};
+
+    std::atomic_int done{0};
+    e.run("sleep 0.05", nullptr, [&](const supervisor::child_status&) { done++; });
+    e.run("true", nullptr, [&](const supervisor::child_status&) { done++; });
+
+    expect(e.queued() == size_t{1});
+    expect(wait_for(done, 2));
+    expect(e.active() == size_t{0});
+    expect(e.queued() == size_t{0});
+  };
+
+  "coprocess"_test = [&] {
+    executor e{log, sched, r, sv, 1, 1s};
+
+    std::atomic_int replies{0};
+    std::atomic_int status{-1};
+    vector<string> lines;
+
+    auto id = e.run_persistent("while read -r n; do echo \"reply $n\"; done",
+        [&](string line) {
+          lines.emplace_back(line);
+          replies++;
+        },
+        store(status), true);
+
+    // Persistent commands don't take a job slot
+    expect(e.active() == size_t{0});
+
+    // Lines written before the command got spawned are sent once it runs
+    expect(e.write(id, "1"));
+    expect(wait_for(replies, 1));
+    expect(e.write(id, "2"));
+    expect(wait_for(replies, 2));
+    expect(lines[0] == "reply 1");
+    expect(lines[1] == "reply 2");
+
+    e.cancel(id);
+    expect(!e.running(id));
+  };
+
+  "large_input"_test = [&] {
+    executor e{log, sched, r, sv, 1, 1s};
+
+    std::atomic_int replies{0};
+    vector<string> lines;
+
+    auto id = e.run_persistent("while read -r n; do echo ${#n}; done",
+        [&](string line) {
+          lines.emplace_back(line);
+          replies++;
+        },
+        nullptr, true);
+
+    // The line exceeds the socket buffer, so the rest is sent once it's writable
+    expect(e.write(id, string(256 * 1024, 'x')));
+    expect(wait_for(replies, 1));
+    expect(e.write(id, "x"));
+    expect(wait_for(replies, 2));
+    expect(lines[0] == "262144");
+    expect(lines[1] == "1");
+
+    e.cancel(id);
+  };
+
+  "cancel"_test = [&] {
+    executor e{log, sched, r, sv, 1, 1s};
+
+    std::atomic_int done{0};
+    auto first = e.run("sleep 5", nullptr, [&](const supervisor::child_status&) { done++; });
+    auto second = e.run("true", nullptr, [&](const supervisor::child_status&) { done++; });
+
+    e.cancel(second);
+    expect(e.queued() == size_t{0});
+    e.cancel(first);
+    expect(!e.running(first));
+
+    expect(wait_until([&] { return e.active() == 0; }));
+    expect(done == 0);
+  };
+}
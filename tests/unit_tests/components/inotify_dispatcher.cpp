@@ -0,0 +1,104 @@
+#include <fcntl.h>
+#include <cstdlib>
+
+#include "components/inotify_dispatcher.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+  reactor r{log};
+
+  char path[] = "/tmp/lemonbuddy_inotify_XXXXXX";
+  int fd = mkstemp(path);
+
+  "dispatch"_test = [&] {
+    inotify_dispatcher inotify{log, r};
+    std::atomic_int modified{0};
+    std::atomic_int mask{0};
+
+    auto id = inotify.add(path, IN_MODIFY, [&](const inotify_util::event_t& event) {
+      expect(event.filename == path);
+      mask = event.mask;
+      modified++;
+    });
+
+    expect(inotify.size() == size_t{1});
+
+    expect(write(fd, "x", 1) == 1);
+    expect(wait_for(modified, 1));
+    expect((mask & IN_MODIFY) == IN_MODIFY);
+
+    // Reading the file isn't reported to watchers of modifications
+    char buf[1];
+    expect(pread(fd, buf, sizeof(buf), 0) == 1);
+    this_thread::sleep_for(10ms);
+    expect(modified == 1);
+
+    inotify.remove(id);
+    expect(inotify.size() == size_t{0});
+    expect(write(fd, "x", 1) == 1);
+    this_thread::sleep_for(10ms);
+    expect(modified == 1);
+  };
+
+  "shared"_test = [&] {
+    inotify_dispatcher inotify{log, r};
+    std::atomic_int modified{0};
+    std::atomic_int accessed{0};
+
+    auto a = inotify.add(path, IN_MODIFY, [&](const inotify_util::event_t&) { modified++; });
+    auto b = inotify.add(path, IN_ACCESS, [&](const inotify_util::event_t&) { accessed++; });
+
+    char buf[1];
+    expect(pread(fd, buf, sizeof(buf), 0) == 1);
+    expect(wait_for(accessed, 1));
+    expect(modified == 0);
+
+    // The remaining watcher keeps receiving its events
+    inotify.remove(b);
+    expect(write(fd, "x", 1) == 1);
+    expect(wait_for(modified, 1));
+    expect(pread(fd, buf, sizeof(buf), 0) == 1);
+    this_thread::sleep_for(10ms);
+    expect(accessed == 1);
+
+    inotify.remove(a);
+  };
+
+  "ignored"_test = [&] {
+    inotify_dispatcher inotify{log, r};
+    std::atomic_int ignored{0};
+
+    char removed[] = "/tmp/lemonbuddy_inotify_XXXXXX";
+    close(mkstemp(removed));
+
+    // Watchers learn about removed watches, so they can add the path again
+    auto id = inotify.add(removed, IN_MODIFY, [&](const inotify_util::event_t& event) {
+      if (event.mask & IN_IGNORED)
+        ignored++;
+    });
+
+    unlink(removed);
+    expect(wait_for(ignored, 1));
+
+    inotify.remove(id);
+  };
+
+  "invalid"_test = [&] {
+    inotify_dispatcher inotify{log, r};
+    bool thrown{false};
+
+    try {
+      inotify.add("/nonexistent/lemonbuddy", IN_MODIFY, nullptr);
+    } catch (const system_error&) {
+      thrown = true;
+    }
+
+    expect(thrown);
+    expect(inotify.size() == size_t{0});
+  };
+
+  close(fd);
+  unlink(path);
+}
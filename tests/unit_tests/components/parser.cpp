@@ -0,0 +1,115 @@
+#include "components/parser.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  struct recording_sink {
+    string output;
+
+    void on_alignment_change(alignment align) {
+      output += "[align " + to_string(static_cast<int>(align)) + "]";
+    }
+    void on_attribute_set(attribute attr) {
+      output += "[+" + to_string(static_cast<int>(attr)) + "]";
+    }
+    void on_attribute_unset(attribute attr) {
+      output += "[-" + to_string(static_cast<int>(attr)) + "]";
+    }
+    void on_attribute_toggle(attribute attr) {
+      output += "[!" + to_string(static_cast<int>(attr)) + "]";
+    }
+    void on_action_block_open(mousebtn btn, string cmd) {
+      output += "[A" + to_string(static_cast<int>(btn)) + " " + cmd + "]";
+    }
+    void on_action_block_close(mousebtn btn) {
+      output += "[/A" + to_string(static_cast<int>(btn)) + "]";
+    }
+    void on_color_change(gc gc_, color color_) {
+      output += "[color " + to_string(static_cast<int>(gc_)) + " ";
+      output += to_string(uint32_t{color_}) + "]";
+    }
+    void on_color_reset(gc gc_) {
+      output += "[reset " + to_string(static_cast<int>(gc_)) + "]";
+    }
+    void on_font_change(int index) {
+      output += "[font " + to_string(index) + "]";
+    }
+    void on_pixel_offset(int px) {
+      output += "[offset " + to_string(px) + "]";
+    }
+    void on_character_write(uint16_t character) {
+      output += "[char " + to_string(character) + "]";
+    }
+    void on_string_write(const char* text, size_t len) {
+      output += "[text " + string{text, len} + "]";
+    }
+  };
+
+  bar_settings bar;
+
+  auto parse = [&](string input) {
+    recording_sink sink;
+    parser<recording_sink> markup(bar, sink);
+    markup(input);
+    return sink.output;
+  };
+
+  "text"_test = [&] {
+    expect(parse("foo bar") == "[text foo bar]");
+    expect(parse("foo%{r}bar") == "[text foo][align 3][text bar]");
+    expect(parse("a\xc3\xa5") == "[text a][char 229]");
+    expect(parse("\xe2\x82\xac") == "[char 8364]");
+    expect(parse("\xf0\x9f\x98\x80") == "[char 65533]");
+    expect(parse("a\xe2\x82") == "[text a][char 65533]");
+  };
+
+  "unclosed_tag"_test = [&] { expect(parse("%{l") == "[text %{l]"); };
+
+  "alignment"_test = [&] {
+    expect(parse("%{l}%{c}%{r}") == "[align 1][align 2][align 3]");
+    expect(parse("%{l c}") == "[align 1][align 2]");
+  };
+
+  "attributes"_test = [&] {
+    expect(parse("%{+u}%{-o}%{!u}") == "[+4][-2][!4]");
+    expect(parse("%{+u +o}") == "[+4][+2]");
+  };
+
+  "colors"_test = [&] {
+    auto red = to_string(0xffff0000);
+    auto green = to_string(0xff00ff00);
+    auto faded = to_string(uint32_t{color{"#80000000"}});
+    expect(parse("%{F#ff0000}") == "[color 2 " + red + "]");
+    expect(parse("%{B#f00 F-}") == "[color 1 " + red + "][reset 2]");
+    expect(parse("%{F#f00 F#0f0}") == "[color 2 " + green + "]");
+    expect(parse("%{F#80}") == "[color 2 " + faded + "]");
+    expect(parse("%{U-}") == "[reset 4][reset 3]");
+  };
+
+  "font"_test = [&] {
+    expect(parse("%{T2}") == "[font 2]");
+    expect(parse("%{T-}") == "[font -1]");
+  };
+
+  "offset"_test = [&] {
+    expect(parse("%{O10}") == "[offset 10]");
+    expect(parse("%{O-5}") == "[offset -5]");
+  };
+
+  "actions"_test = [&] {
+    expect(parse("%{A1:foo bar:}x%{A}") == "[A1 foo bar][text x][/A1]");
+    expect(parse("%{A:foo:}%{A3:bar:}x%{A}%{A}") == "[A1 foo][A3 bar][text x][/A3][/A1]");
+    expect(parse("%{A}") == "");
+    expect(parse("%{A1:a\\:b\\}:}x%{A}") == "[A1 a:b}][text x][/A1]");
+  };
+
+  "unrecognized"_test = [&] {
+    bool thrown{false};
+    try {
+      parse("%{Z}");
+    } catch (const unrecognized_token&) {
+      thrown = true;
+    }
+    expect(thrown);
+  };
+}
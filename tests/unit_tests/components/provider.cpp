@@ -0,0 +1,78 @@
+#include "components/provider.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+
+  struct counter_sample {
+    int value;
+  };
+
+  int reads{0};
+  auto reader = [&reads](counter_sample& sample) {
+    sample.value = ++reads;
+    return true;
+  };
+
+  "shared"_test = [&] {
+    provider_registry registry{log};
+    reads = 0;
+
+    auto a = registry.subscribe<counter_sample>("counter", 1s, reader);
+    auto b = registry.subscribe<counter_sample>("counter", 2s, reader);
+
+    expect(registry.size() == size_t{1});
+
+    // Both subscribers get the same sample within the interval
+    auto first = a.sample();
+    auto second = b.sample();
+    expect(first == second);
+    expect(first->value == 1);
+    expect(a.source().reads() == size_t{1});
+  };
+
+  "interval"_test = [&] {
+    provider_registry registry{log};
+    reads = 0;
+
+    auto slow = registry.subscribe<counter_sample>("counter", 1s, reader);
+    expect(slow.sample()->value == 1);
+
+    // The fastest subscriber decides how long a sample is reused
+    auto fast = registry.subscribe<counter_sample>("counter", 20ms, reader);
+    this_thread::sleep_for(15ms);
+    expect(slow.sample()->value == 2);
+    expect(fast.sample()->value == 2);
+
+    fast = {};
+    this_thread::sleep_for(15ms);
+    expect(slow.sample()->value == 2);
+  };
+
+  "refcount"_test = [&] {
+    provider_registry registry{log};
+    reads = 0;
+
+    {
+      auto a = registry.subscribe<counter_sample>("counter", 1s, reader);
+      auto other = registry.subscribe<counter_sample>("other", 1s, reader);
+      expect(registry.size() == size_t{2});
+      a.sample();
+    }
+
+    expect(registry.size() == size_t{0});
+
+    // A new provider is created once the previous one lost its subscribers
+    auto b = registry.subscribe<counter_sample>("counter", 1s, reader);
+    expect(b.sample()->value == 2);
+  };
+
+  "failure"_test = [&] {
+    provider_registry registry{log};
+
+    auto fail = [](counter_sample&) { return false; };
+    auto s = registry.subscribe<counter_sample>("failing", 1s, fail);
+    expect(s.sample() == nullptr);
+  };
+}
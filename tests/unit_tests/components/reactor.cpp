@@ -0,0 +1,88 @@
+#include "components/reactor.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+
+  "readable"_test = [&] {
+    reactor r{log};
+    int fds[2];
+    expect(pipe(fds) == 0);
+
+    std::atomic_int count{0};
+    auto id = r.add(fds[0], EPOLLIN, [&](uint32_t events) {
+      char buf[16];
+      expect((events & EPOLLIN) == EPOLLIN);
+      expect(read(fds[0], buf, sizeof(buf)) > 0);
+      count++;
+    });
+
+    this_thread::sleep_for(10ms);
+    expect(count == 0);
+    expect(write(fds[1], "x", 1) == 1);
+    expect(wait_for(count, 1));
+    expect(write(fds[1], "x", 1) == 1);
+    expect(wait_for(count, 2));
+
+    r.remove(id);
+    expect(r.size() == size_t{0});
+    expect(write(fds[1], "x", 1) == 1);
+    this_thread::sleep_for(10ms);
+    expect(count == 2);
+
+    close(fds[0]);
+    close(fds[1]);
+  };
+
+  "remove_from_handler"_test = [&] {
+    reactor r{log};
+    int fds[2];
+    expect(pipe(fds) == 0);
+
+    std::atomic_int count{0};
+    reactor::handler_id id{0};
+    id = r.add(fds[0], EPOLLIN, [&](uint32_t) {
+      count++;
+      r.remove(id);
+    });
+
+    expect(write(fds[1], "x", 1) == 1);
+    expect(wait_for(count, 1));
+    this_thread::sleep_for(10ms);
+    expect(count == 1);
+    expect(r.size() == size_t{0});
+
+    close(fds[0]);
+    close(fds[1]);
+  };
+
+  "reused_descriptor"_test = [&] {
+    reactor r{log};
+    int fds[2];
+    expect(pipe(fds) == 0);
+
+    std::atomic_int count{0};
+    auto stale = r.add(fds[0], EPOLLIN, [&](uint32_t) { count += 10; });
+    close(fds[0]);
+
+    int reused[2];
+    expect(pipe(reused) == 0);
+    expect(reused[0] == fds[0]);
+
+    r.add(reused[0], EPOLLIN, [&](uint32_t) {
+      char buf[16];
+      expect(read(reused[0], buf, sizeof(buf)) > 0);
+      count++;
+    });
+
+    // Removing the stale handler must not affect the new registration
+    r.remove(stale);
+    expect(write(reused[1], "x", 1) == 1);
+    expect(wait_for(count, 1));
+
+    close(fds[1]);
+    close(reused[0]);
+    close(reused[1]);
+  };
+}
@@ -0,0 +1,52 @@
+#include <net/if.h>
+
+#include "components/rtnetlink.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+  reactor r{log};
+
+  auto lo = static_cast<int>(if_nametoindex("lo"));
+
+  "state"_test = [&] {
+    rtnetlink netlink{log, r};
+
+    expect(lo > 0);
+    expect(!netlink.state(lo).valid);
+
+    auto id = netlink.watch(lo);
+    auto state = netlink.state(lo);
+
+    expect(netlink.size() == size_t{1});
+    expect(state.valid);
+    expect((state.flags & IFF_UP) == IFF_UP);
+    expect(state.ip == "127.0.0.1");
+
+    netlink.unwatch(id);
+    expect(netlink.size() == size_t{0});
+    expect(!netlink.state(lo).valid);
+  };
+
+  "counters"_test = [&] {
+    rtnetlink netlink{log, r};
+    rtnetlink::link_counters counters;
+
+    expect(netlink.counters(lo, counters));
+    expect(!netlink.counters(0x7fffffff, counters));
+  };
+
+  "shared"_test = [&] {
+    rtnetlink netlink{log, r};
+
+    auto a = netlink.watch(lo, [](const rtnetlink::link_state&) {});
+    auto b = netlink.watch(lo);
+
+    netlink.unwatch(a);
+    expect(netlink.state(lo).valid);
+    netlink.unwatch(b);
+    expect(!netlink.state(lo).valid);
+    netlink.unwatch(b);
+  };
+}
@@ -0,0 +1,69 @@
+#include "components/scheduler.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  auto advance = [](timer_wheel& wheel, uint64_t tick) {
+    vector<size_t> expired;
+    wheel.advance(tick, expired);
+    return expired;
+  };
+
+  "wheel_expire"_test = [&] {
+    timer_wheel wheel;
+    wheel.insert(1, 10);
+    wheel.insert(2, 100);
+    wheel.insert(3, 5000);
+    wheel.insert(4, 300000);
+    expect(wheel.size() == size_t{4});
+    expect(advance(wheel, 9).empty());
+    expect(advance(wheel, 10) == vector<size_t>{1});
+    expect(advance(wheel, 4999) == vector<size_t>{2});
+    expect(advance(wheel, 5000) == vector<size_t>{3});
+    expect(advance(wheel, 20000000) == vector<size_t>{4});
+    expect(wheel.size() == size_t{0});
+  };
+
+  "wheel_past_deadline"_test = [&] {
+    timer_wheel wheel{100};
+    wheel.insert(1, 50);
+    expect(advance(wheel, 100) == vector<size_t>{1});
+  };
+
+  "wheel_next_expiry"_test = [&] {
+    timer_wheel wheel;
+    uint64_t tick{0};
+    expect(!wheel.next_expiry(tick));
+    wheel.insert(1, 1000);
+    expect(wheel.next_expiry(tick));
+    expect(tick <= 1000);
+    while (advance(wheel, tick).empty()) wheel.next_expiry(tick);
+    expect(tick == 1000);
+  };
+
+  logger log{loglevel::NONE};
+
+  "every"_test = [&] {
+    scheduler sched{log, 2, 0ms};
+    std::atomic_int count{0};
+    auto id = sched.every(20ms, [&] { count++; });
+    this_thread::sleep_for(110ms);
+    sched.cancel(id);
+    auto runs = count.load();
+    expect(runs >= 4 && runs <= 7);
+    this_thread::sleep_for(50ms);
+    expect(count == runs);
+    expect(sched.thread_count() == size_t{3});
+  };
+
+  "once"_test = [&] {
+    scheduler sched{log, 1, 10ms};
+    std::atomic_int count{0};
+    sched.once(10ms, [&] { count++; });
+    sched.once(0ms, [&] { count++; });
+    auto cancelled = sched.once(50ms, [&] { count += 10; });
+    sched.cancel(cancelled);
+    this_thread::sleep_for(100ms);
+    expect(count == 2);
+  };
+}
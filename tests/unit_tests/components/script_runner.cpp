@@ -0,0 +1,78 @@
+#include "components/script_runner.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+  scheduler sched{log, 2, 0ms};
+  reactor r{log};
+  supervisor sv{log, r};
+  executor e{log, sched, r, sv, 2, 1s};
+
+  "shared"_test = [&] {
+    script_runner runner{log, sched, e, false};
+
+    std::atomic_int first{0};
+    std::atomic_int second{0};
+
+    auto a = runner.subscribe("echo %counter%", 50ms, [&](const string& output, int counter) {
+      expect(output == to_string(counter));
+      first = counter;
+    });
+    auto b = runner.subscribe("echo %counter%", 50ms, [&](const string& output, int counter) {
+      expect(output == to_string(counter));
+      second = counter;
+    });
+
+    expect(runner.size() == size_t{1});
+    expect(wait_until([&] { return first >= 3; }));
+    expect(wait_until([&] { return second >= 3; }));
+
+    // Both subscribers see the same run, so the counter doesn't advance twice as fast
+    runner.unsubscribe(a);
+    expect(abs(first - second) <= 1);
+
+    runner.unsubscribe(b);
+    expect(runner.size() == size_t{0});
+  };
+
+  "intervals"_test = [&] {
+    script_runner runner{log, sched, e, false};
+
+    auto a = runner.subscribe("true", 50ms, nullptr);
+    auto b = runner.subscribe("true", 100ms, nullptr);
+    auto c = runner.subscribe("false", 50ms, nullptr);
+
+    expect(runner.size() == size_t{3});
+
+    runner.unsubscribe(a);
+    runner.unsubscribe(b);
+    runner.unsubscribe(c);
+
+    expect(runner.size() == size_t{0});
+  };
+
+  "cache"_test = [&] {
+    script_runner runner{log, sched, e, true};
+
+    std::atomic_int done{0};
+    auto a = runner.subscribe("echo foo", 1s, [&](const string& output, int) {
+      expect(output == "foo");
+      done++;
+    });
+
+    expect(wait_until([&] { return done >= 1; }));
+    runner.unsubscribe(a);
+
+    // The cached result is passed on before the command is run again
+    std::atomic_int cached{0};
+    auto b = runner.subscribe("echo foo", 1s, [&](const string& output, int counter) {
+      expect(output == "foo");
+      if (counter == 1)
+        cached++;
+    });
+
+    expect(wait_until([&] { return cached >= 1; }));
+    runner.unsubscribe(b);
+  };
+}
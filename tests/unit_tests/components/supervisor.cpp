@@ -0,0 +1,67 @@
+#include <sys/wait.h>
+#include <csignal>
+
+#include "components/supervisor.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  logger log{loglevel::NONE};
+  reactor r{log};
+
+  "exit"_test = [&] {
+    supervisor sv{log, r};
+
+    pid_t pid{fork()};
+    if (pid == 0)
+      _exit(7);
+
+    std::atomic_int status{-1};
+    sv.watch(pid, [&](const supervisor::child_status& child) {
+      expect(child.pid == pid);
+      expect(child.maxrss > 0);
+      status = child.status;
+    });
+
+    expect(wait_until([&] { return status != -1; }));
+    expect(status == 7);
+    expect(sv.size() == size_t{0});
+  };
+
+  "signal"_test = [&] {
+    supervisor sv{log, r};
+
+    pid_t pid{fork()};
+    if (pid == 0) {
+      pause();
+      _exit(0);
+    }
+
+    std::atomic_int status{-1};
+    sv.watch(pid, [&](const supervisor::child_status& child) { status = child.status; });
+
+    this_thread::sleep_for(10ms);
+    expect(status == -1);
+    kill(pid, SIGKILL);
+
+    expect(wait_until([&] { return status != -1; }));
+    expect(status == 128 + SIGKILL);
+  };
+
+  "unwatch"_test = [&] {
+    supervisor sv{log, r};
+
+    pid_t pid{fork()};
+    if (pid == 0)
+      _exit(0);
+
+    std::atomic_int calls{0};
+    sv.watch(pid, [&](const supervisor::child_status&) { calls++; });
+    sv.unwatch(pid);
+    expect(sv.size() == size_t{0});
+
+    waitpid(pid, nullptr, 0);
+    this_thread::sleep_for(10ms);
+    expect(calls == 0);
+  };
+}
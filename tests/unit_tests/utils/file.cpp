@@ -0,0 +1,48 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "utils/file.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  "parse_uint"_test = [] {
+    string input{"  42\t7 x"};
+    auto end = input.data() + input.size();
+    unsigned long long value{0};
+
+    auto pos = file_util::parse_uint(input.data(), end, value);
+    expect(pos != nullptr);
+    expect(value == 42);
+
+    pos = file_util::parse_uint(pos, end, value);
+    expect(pos != nullptr);
+    expect(value == 7);
+
+    expect(file_util::parse_uint(pos, end, value) == nullptr);
+    expect(file_util::parse_uint(end, end, value) == nullptr);
+  };
+
+  "file_reader"_test = [] {
+    char path[] = "/tmp/lemonbuddy_file_reader_XXXXXX";
+    int fd = mkstemp(path);
+    expect(fd != -1);
+    expect(write(fd, "12345", 5) == 5);
+
+    file_util::file_reader reader{path, 2};
+    expect(reader.read());
+    expect(string(reader.begin(), reader.end()) == "12345");
+
+    // The file is read from the start on every call
+    expect(pwrite(fd, "678", 3, 0) == 3);
+    expect(reader.read());
+    expect(string(reader.begin(), reader.size()) == "67845");
+
+    close(fd);
+    unlink(path);
+
+    file_util::file_reader missing{"/nonexistent/file"};
+    expect(!missing.read());
+    expect(missing.size() == size_t{0});
+  };
+}
@@ -0,0 +1,64 @@
+#include <fcntl.h>
+
+#include "utils/io.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  "line_reader"_test = [] {
+    int fds[2];
+    expect(pipe2(fds, O_NONBLOCK) == 0);
+
+    io_util::line_reader reader{8};
+    vector<string> lines;
+    auto on_line = [&](const char* line, size_t len) { lines.emplace_back(line, len); };
+
+    expect(reader.read(fds[0], on_line));
+    expect(lines.empty());
+
+    expect(write(fds[1], "foo\nba", 6) == 6);
+    expect(reader.read(fds[0], on_line));
+    expect(lines.size() == size_t{1});
+    expect(lines[0] == "foo");
+    expect(reader.size() == size_t{2});
+
+    // The line wraps around the end of the buffer
+    expect(write(fds[1], "rbaz\n\n", 6) == 6);
+    expect(reader.read(fds[0], on_line));
+    expect(lines.size() == size_t{3});
+    expect(lines[1] == "barbaz");
+    expect(lines[2] == "");
+
+    expect(write(fds[1], "end", 3) == 3);
+    close(fds[1]);
+    expect(reader.read(fds[0], on_line));
+    expect(!reader.read(fds[0], on_line));
+    expect(lines.size() == size_t{3});
+
+    reader.flush(on_line);
+    expect(lines.size() == size_t{4});
+    expect(lines[3] == "end");
+    expect(reader.size() == size_t{0});
+
+    close(fds[0]);
+  };
+
+  "line_reader_truncate"_test = [] {
+    int fds[2];
+    expect(pipe2(fds, O_NONBLOCK) == 0);
+
+    io_util::line_reader reader{4};
+    vector<string> lines;
+    auto on_line = [&](const char* line, size_t len) { lines.emplace_back(line, len); };
+
+    expect(write(fds[1], "0123456789\nab\n", 14) == 14);
+    expect(reader.read(fds[0], on_line));
+    expect(lines.size() == size_t{2});
+    expect(lines[0] == "0123");
+    expect(lines[1] == "ab");
+    expect(reader.truncated() == size_t{1});
+
+    close(fds[0]);
+    close(fds[1]);
+  };
+}
@@ -0,0 +1,103 @@
+#include <linux/genetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utils/netlink.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  struct {
+    nlmsghdr hdr;
+    genlmsghdr genl;
+    char attributes[64];
+  } req{};
+
+  "attributes"_test = [&] {
+    req.hdr.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+
+    uint32_t value{42};
+    netlink_util::put_attribute(&req.hdr, sizeof(req), 1, &value, sizeof(value));
+    netlink_util::put_attribute(&req.hdr, sizeof(req), 2, "abc", 3);
+    expect(req.hdr.nlmsg_len == NLMSG_LENGTH(GENL_HDRLEN) + 8 + 8);
+
+    vector<uint16_t> types;
+    netlink_util::for_each_attribute(req.attributes, req.hdr.nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN),
+        [&](const nlattr* attr) {
+          types.emplace_back(netlink_util::attribute_type(attr));
+          if (types.size() == 1)
+            expect(netlink_util::attribute_value<uint32_t>(attr) == 42);
+          else
+            expect(netlink_util::attribute_length(attr) == size_t{3});
+        });
+
+    expect(types.size() == size_t{2});
+
+    bool thrown{false};
+    try {
+      char large[64]{};
+      netlink_util::put_attribute(&req.hdr, sizeof(req), 3, large, sizeof(large));
+    } catch (const application_error&) {
+      thrown = true;
+    }
+    expect(thrown);
+  };
+
+  "properties"_test = [] {
+    const char event[] =
+        "change@/devices/LNXSYSTM:00/PNP0C0A:00/power_supply/BAT0\0ACTION=change\0"
+        "SUBSYSTEM=power_supply\0POWER_SUPPLY_NAME=BAT0\0POWER_SUPPLY_CAPACITY=87";
+    const char file[] = "POWER_SUPPLY_NAME=AC\nPOWER_SUPPLY_ONLINE=1\n";
+
+    map<string, string> properties;
+    auto store = [&](const string& key, const string& value) { properties[key] = value; };
+
+    netlink_util::for_each_property(event, sizeof(event) - 1, store);
+    expect(properties.size() == size_t{4});
+    expect(properties["SUBSYSTEM"] == "power_supply");
+    expect(properties["POWER_SUPPLY_CAPACITY"] == "87");
+
+    properties.clear();
+    netlink_util::for_each_property(file, sizeof(file) - 1, store);
+    expect(properties.size() == size_t{2});
+    expect(properties["POWER_SUPPLY_ONLINE"] == "1");
+  };
+
+  "request"_test = [&] {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    expect(fd != -1);
+
+    vector<char> buffer(8192);
+
+    // The generic netlink controller knows about itself
+    req = {};
+    req.hdr.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    req.hdr.nlmsg_type = GENL_ID_CTRL;
+    req.hdr.nlmsg_flags = NLM_F_REQUEST;
+    req.genl.cmd = CTRL_CMD_GETFAMILY;
+    req.genl.version = 1;
+    netlink_util::put_attribute(&req.hdr, sizeof(req), CTRL_ATTR_FAMILY_NAME, "nlctrl", 7);
+
+    uint16_t family{0};
+
+    expect(netlink_util::request(fd, &req.hdr, buffer, [&](const nlmsghdr* msg) {
+      auto payload = reinterpret_cast<const char*>(NLMSG_DATA(msg)) + GENL_HDRLEN;
+      auto len = msg->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+      netlink_util::for_each_attribute(payload, len, [&](const nlattr* attr) {
+        if (netlink_util::attribute_type(attr) == CTRL_ATTR_FAMILY_ID)
+          family = netlink_util::attribute_value<uint16_t>(attr);
+      });
+    }));
+
+    expect(family == GENL_ID_CTRL);
+
+    // Unknown families are rejected by the kernel
+    req.hdr.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    netlink_util::put_attribute(&req.hdr, sizeof(req), CTRL_ATTR_FAMILY_NAME, "lemonbuddy", 11);
+
+    expect(!netlink_util::request(fd, &req.hdr, buffer, [](const nlmsghdr*) {}));
+    expect(errno == ENOENT);
+
+    close(fd);
+  };
+}
@@ -0,0 +1,88 @@
+#include "utils/threading.hpp"
+
+int main() {
+  using namespace lemonbuddy;
+
+  "futex_lock"_test = [] {
+    threading_util::futex_lock lock;
+    expect(lock.try_lock());
+    expect(!lock.try_lock());
+    lock.unlock();
+    expect(lock.contentions() == size_t{0});
+  };
+
+  "futex_lock_contended"_test = [] {
+    threading_util::futex_lock lock;
+    size_t counter{0};
+    vector<thread> threads;
+
+    for (int i = 0; i < 4; i++) {
+      threads.emplace_back([&] {
+        for (int n = 0; n < 20000; n++) {
+          std::lock_guard<threading_util::futex_lock> guard(lock);
+          counter++;
+        }
+      });
+    }
+
+    for (auto&& t : threads) {
+      t.join();
+    }
+
+    expect(counter == size_t{80000});
+  };
+
+  "futex_lock_sleep"_test = [] {
+    threading_util::futex_lock lock;
+    lock.lock();
+
+    thread waiter([&] {
+      std::lock_guard<threading_util::futex_lock> guard(lock);
+    });
+
+    this_thread::sleep_for(20ms);
+    lock.unlock();
+    waiter.join();
+
+    expect(lock.contentions() == size_t{1});
+    expect(lock.sleeps() >= size_t{1});
+  };
+  "callback_tracker"_test = [] {
+    logger log{loglevel::NONE};
+    threading_util::callback_tracker callbacks{log, "test"};
+    std::mutex mutex;
+    std::atomic_bool entered{false};
+    std::atomic_bool called{false};
+
+    thread caller([&] {
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        callbacks.enter(1);
+        entered = true;
+      }
+      callbacks.call(mutex, 1, [&] {
+        this_thread::sleep_for(20ms);
+        called = true;
+      });
+    });
+
+    // Removing the callback waits for the call on the other thread
+    {
+      expect(wait_until([&] { return entered.load(); }));
+      std::unique_lock<std::mutex> guard(mutex);
+      callbacks.wait(guard, 1);
+      expect(called);
+    }
+
+    caller.join();
+
+    // Calls made by the waiting thread itself aren't waited for
+    std::unique_lock<std::mutex> guard(mutex);
+    callbacks.enter(2);
+    callbacks.wait(guard, 2);
+    guard.unlock();
+
+    // Exceptions thrown by the callback don't reach the caller
+    callbacks.call(mutex, 2, [] { throw std::runtime_error("callback"); });
+  };
+}